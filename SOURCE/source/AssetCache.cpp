@@ -0,0 +1,147 @@
+#include "AssetCache.h"
+#include "MeshFile.h"
+#include "Utils.h"
+
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace dae
+{
+	namespace AssetCache
+	{
+		//Whatever the arrays of an asset live in: the mapped file and/or the vectors of a parse and a BVH build
+		struct OwnedArrays
+		{
+			std::shared_ptr<const void> pMappedFile{};
+			std::vector<Vector3> positions{};
+			std::vector<Vector3> normals{};
+			std::vector<int> indices{};
+			std::vector<BVHNode> bvhNodes{};
+			std::vector<int> triIdx{};
+		};
+
+		//Weak references, an asset goes away with the last mesh using it and gets loaded again on the next request
+		static std::mutex g_CacheMutex{};
+		static std::unordered_map<std::string, std::weak_ptr<const MeshAsset>> g_Meshes{};
+
+		static bool EndsWith(const std::string& string, const std::string& suffix)
+		{
+			return string.size() >= suffix.size() && string.compare(string.size() - suffix.size(), suffix.size(), suffix) == 0;
+		}
+
+		//The mesh has its object space arrays and a BVH built over them under the identity transform, they move into the asset
+		static std::shared_ptr<const MeshAsset> CreateAsset(TriangleMesh& mesh)
+		{
+			const auto pOwned{ std::make_shared<OwnedArrays>() };
+			pOwned->pMappedFile = mesh.external.pOwner;
+			pOwned->positions = std::move(mesh.positions);
+			pOwned->normals = std::move(mesh.normals);
+			pOwned->indices = std::move(mesh.indices);
+
+			const auto pAsset{ std::make_shared<MeshAsset>() };
+			ExternalMeshArrays& arrays{ pAsset->arrays };
+			if (mesh.external.pOwner)
+			{
+				arrays.positions = mesh.external.positions;
+				arrays.normals = mesh.external.normals;
+				arrays.indices = mesh.external.indices;
+			}
+			else
+			{
+				arrays.positions = pOwned->positions;
+				arrays.normals = pOwned->normals;
+				arrays.indices = pOwned->indices;
+			}
+
+			if (!mesh.external.bvhNodes.empty())
+			{
+				arrays.bvhNodes = mesh.external.bvhNodes;
+				arrays.triIdx = mesh.external.triIdx;
+			}
+			else
+			{
+				//BuildBVH leaves unused nodes at the end of the pool
+				pOwned->bvhNodes.assign(mesh.bvhNodePool.begin(), mesh.bvhNodePool.begin() + mesh.nodesUsed);
+				pOwned->triIdx = std::move(mesh.triIdx);
+				arrays.bvhNodes = pOwned->bvhNodes;
+				arrays.triIdx = pOwned->triIdx;
+			}
+
+			arrays.pOwner = pOwned;
+			pAsset->minAABB = mesh.minAABB;
+			pAsset->maxAABB = mesh.maxAABB;
+			return pAsset;
+		}
+
+		static std::shared_ptr<const MeshAsset> Load(const std::string& filename)
+		{
+			TriangleMesh mesh{};
+			const bool isMeshFile{ EndsWith(filename, ".mesh") };
+			const bool isLoaded{ isMeshFile
+				? MeshFile::Load(filename, mesh)
+				: Utils::ParseOBJ(filename, mesh.positions, mesh.normals, mesh.indices) };
+			if (!isLoaded)
+				return nullptr;
+			if (mesh.GetNumTriangles() == 0)
+			{
+				std::cout << filename << ": no triangles\n";
+				return nullptr;
+			}
+
+			//A mesh file without a prebuilt BVH gets one like a parsed mesh
+			if (!isMeshFile)
+				mesh.UpdateAABB();
+			if (mesh.external.bvhNodes.empty())
+			{
+				mesh.UpdateTransforms();
+				mesh.FillTriangleList();
+				mesh.BuildBVH();
+			}
+			return CreateAsset(mesh);
+		}
+
+		std::shared_ptr<const MeshAsset> GetMesh(const std::string& filename)
+		{
+			//Loading under the lock, two threads asking for the same file get one asset
+			const std::lock_guard<std::mutex> lock{ g_CacheMutex };
+			std::weak_ptr<const MeshAsset>& pCached{ g_Meshes[filename] };
+			if (std::shared_ptr<const MeshAsset> pAsset{ pCached.lock() })
+				return pAsset;
+
+			std::shared_ptr<const MeshAsset> pAsset{ Load(filename) };
+			pCached = pAsset;
+			return pAsset;
+		}
+
+		void Attach(const std::shared_ptr<const MeshAsset>& pAsset, TriangleMesh& mesh)
+		{
+			ExternalMeshArrays arrays{ pAsset->arrays };
+			arrays.pOwner = pAsset;
+			mesh.SetExternalArrays(std::move(arrays), pAsset->minAABB, pAsset->maxAABB);
+		}
+
+		bool LoadMesh(const std::string& filename, TriangleMesh& mesh)
+		{
+			const std::shared_ptr<const MeshAsset> pAsset{ GetMesh(filename) };
+			if (!pAsset)
+				return false;
+
+			Attach(pAsset, mesh);
+			return true;
+		}
+
+		size_t GetNumLoadedMeshes()
+		{
+			const std::lock_guard<std::mutex> lock{ g_CacheMutex };
+			size_t numLoaded{};
+			for (const auto& [filename, pAsset] : g_Meshes)
+			{
+				if (!pAsset.expired())
+					++numLoaded;
+			}
+			return numLoaded;
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Object space geometry + BVH of one file, immutable once loaded. Every mesh made from it points at these arrays
+	//(TriangleMesh::external), only the world space triangles and a refit BVH of a transformed mesh are its own
+	struct MeshAsset
+	{
+		//pOwner keeps the parsed vectors or the mapped mesh file alive
+		ExternalMeshArrays arrays{};
+		Vector3 minAABB{};
+		Vector3 maxAABB{};
+	};
+
+	//Reference-counted meshes shared by every scene: a file is loaded once and stays loaded while a mesh or a caller holds it
+	namespace AssetCache
+	{
+		//The asset of an OBJ file (Utils::ParseOBJ) or a mesh file (MeshFile::Load, ".mesh"), loaded and given a BVH on the
+		//first request, the same asset afterwards. nullptr when the file can't be loaded, the reason gets printed then
+		std::shared_ptr<const MeshAsset> GetMesh(const std::string& filename);
+
+		//Points the mesh at the asset's arrays, the mesh keeps the asset alive (see TriangleMesh::SetExternalArrays)
+		void Attach(const std::shared_ptr<const MeshAsset>& pAsset, TriangleMesh& mesh);
+
+		//GetMesh + Attach, false when the file can't be loaded
+		bool LoadMesh(const std::string& filename, TriangleMesh& mesh);
+
+		//Assets still held by someone, the ones nobody uses anymore are already freed
+		size_t GetNumLoadedMeshes();
+	}
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <cassert>
 #include "Math.h"
+#include "FastMath.h"
 
 namespace dae
 {
@@ -38,7 +39,11 @@ namespace dae
 		{
 			const auto reflect = l - (2.f * (Vector3::Dot(n, l) * n));
 			const float cosAlpha = Vector3::Dot(reflect, v);
+#if defined(FAST_MATH)
+			const float specularPow{ ks * FastMath::Pow(cosAlpha, exp) };
+#else
 			const float specularPow{ ks * powf(cosAlpha,exp) };
+#endif
 			ColorRGB specular{ specularPow ,specularPow,specularPow };
 			//todo: W3
 			//assert(false && "Not Implemented Yet");
@@ -56,7 +61,21 @@ namespace dae
 		{
 			ColorRGB One{1.f,1.f,1.f};
 			//ColorRGB f0Complement{ 1.f - f0.r,1.f - f0.g,1.f - f0.b };
+#if defined(FAST_MATH)
+			return f0 + (One - f0) * FastMath::Pow5(1.f - Vector3::Dot(h, v));
+#else
 			return f0 + (One - f0) * powf((1.f - Vector3::Dot(h,v)),5);
+#endif
+		}
+
+		/**
+		 * \brief NormalDistribution_GGX with roughness^4 precomputed (MaterialData::alphaSquared)
+		 * \param nDotH Dot of the surface normal and the normalized half vector
+		 * \param alphaSquared roughness^4
+		 */
+		static float NormalDistribution_GGX(float nDotH, float alphaSquared)
+		{
+			return alphaSquared / (PI * Square(Square(nDotH) * (alphaSquared - 1.f) + 1.f));
 		}
 
 		/**
@@ -71,13 +90,22 @@ namespace dae
 			//todo: W3
 			const float a{Square(roughness)};
 			const float aSquared{ Square(a) };
-			const float nDotH{ Vector3::Dot(n,h) };
 
 			//assert(false && "Not Implemented Yet");
-			return aSquared / (PI * Square(Square(nDotH) * (aSquared - 1.f) + 1.f));
+			return NormalDistribution_GGX(Vector3::Dot(n, h), aSquared);
 		}
 
 
+		/**
+		 * \brief GeometryFunction_SchlickGGX with k precomputed (MaterialData::k)
+		 * \param nDotV Dot of the surface normal and the normalized view (or light) direction
+		 * \param k (roughness^2 + 1)^2 / 8
+		 */
+		static float GeometryFunction_SchlickGGX(float nDotV, float k)
+		{
+			return nDotV / (nDotV * (1.f - k) + k);
+		}
+
 		/**
 		 * \brief BRDF Geometry Function >> Schlick GGX (Direct Lighting + UE4 implementation - squared(roughness))
 		 * \param n Normal of the surface
@@ -87,10 +115,20 @@ namespace dae
 		 */
 		static float GeometryFunction_SchlickGGX(const Vector3& n, const Vector3& v, float roughness)
 		{
-			const float nDotV{ Vector3::Dot(n,v) };
 			const float k{ Square(Square(roughness) + 1.f) / 8.f };
 
-			return nDotV / (nDotV * (1.f - k) + k);
+			return GeometryFunction_SchlickGGX(Vector3::Dot(n, v), k);
+		}
+
+		/**
+		 * \brief GeometryFunction_Smith with k precomputed (MaterialData::k)
+		 * \param nDotV Dot of the surface normal and the normalized view direction
+		 * \param nDotL Dot of the surface normal and the normalized light direction
+		 * \param k (roughness^2 + 1)^2 / 8
+		 */
+		static float GeometryFunction_Smith(float nDotV, float nDotL, float k)
+		{
+			return GeometryFunction_SchlickGGX(nDotL, k) * GeometryFunction_SchlickGGX(nDotV, k);
 		}
 
 		/**
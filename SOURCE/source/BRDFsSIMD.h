@@ -0,0 +1,169 @@
+#pragma once
+#include "Math.h"
+#include "SIMD.h"
+#include "Material.h"
+
+namespace dae
+{
+	//FloatN::width vectors stored per component, lane i of x, y and z together form vector i
+	//Templated over the SIMD type so Kernels.h can compile the BRDFs for every instruction set
+	template<typename FloatN>
+	struct Vector3xN
+	{
+		FloatN x;
+		FloatN y;
+		FloatN z;
+
+		Vector3xN() = default;
+		Vector3xN(const FloatN& _x, const FloatN& _y, const FloatN& _z) : x(_x), y(_y), z(_z) {}
+		//Same vector in every lane
+		explicit Vector3xN(const Vector3& v) : x(v.x), y(v.y), z(v.z) {}
+
+		static Vector3xN Load(const float* pX, const float* pY, const float* pZ) { return { FloatN::Load(pX), FloatN::Load(pY), FloatN::Load(pZ) }; }
+	};
+
+	template<typename FloatN>
+	inline Vector3xN<FloatN> operator+(const Vector3xN<FloatN>& a, const Vector3xN<FloatN>& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	template<typename FloatN>
+	inline Vector3xN<FloatN> operator-(const Vector3xN<FloatN>& a, const Vector3xN<FloatN>& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	template<typename FloatN>
+	inline Vector3xN<FloatN> operator*(const Vector3xN<FloatN>& v, const FloatN& s) { return { v.x * s, v.y * s, v.z * s }; }
+	template<typename FloatN>
+	inline FloatN Dot(const Vector3xN<FloatN>& a, const Vector3xN<FloatN>& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	//FloatN::width colors stored per channel
+	template<typename FloatN>
+	struct ColorRGBxN
+	{
+		FloatN r;
+		FloatN g;
+		FloatN b;
+
+		ColorRGBxN() = default;
+		ColorRGBxN(const FloatN& _r, const FloatN& _g, const FloatN& _b) : r(_r), g(_g), b(_b) {}
+		//Same color in every lane
+		explicit ColorRGBxN(const ColorRGB& c) : r(c.r), g(c.g), b(c.b) {}
+
+		void Store(float* pR, float* pG, float* pB) const { r.Store(pR); g.Store(pG); b.Store(pB); }
+	};
+
+	template<typename FloatN>
+	inline ColorRGBxN<FloatN> operator+(const ColorRGBxN<FloatN>& a, const ColorRGBxN<FloatN>& b) { return { a.r + b.r, a.g + b.g, a.b + b.b }; }
+	template<typename FloatN>
+	inline ColorRGBxN<FloatN> operator-(const ColorRGBxN<FloatN>& a, const ColorRGBxN<FloatN>& b) { return { a.r - b.r, a.g - b.g, a.b - b.b }; }
+	template<typename FloatN>
+	inline ColorRGBxN<FloatN> operator*(const ColorRGBxN<FloatN>& a, const ColorRGBxN<FloatN>& b) { return { a.r * b.r, a.g * b.g, a.b * b.b }; }
+	template<typename FloatN>
+	inline ColorRGBxN<FloatN> operator*(const ColorRGBxN<FloatN>& c, const FloatN& s) { return { c.r * s, c.g * s, c.b * s }; }
+
+	using Vector3x8 = Vector3xN<Float8>;
+	using ColorRGBx8 = ColorRGBxN<Float8>;
+
+	//The BRDF terms of BRDFs.h for FloatN::width lanes at once, same parameters and conventions
+	//Error against the scalar versions: rounding only (relative < 1e-5), except Phong whose pow is a polynomial (relative < 2e-3 for exponents up to 200)
+	namespace BRDF
+	{
+		template<typename FloatN>
+		inline ColorRGBxN<FloatN> Lambert(const FloatN& kd, const ColorRGB& cd)
+		{
+			return ColorRGBxN<FloatN>{ cd } * (kd * FloatN{ 1.f / PI });
+		}
+
+		//Unlike powf, negative cosines (reflection pointing away from the viewer) give no highlight instead of a sign depending on the exponent
+		template<typename FloatN>
+		inline ColorRGBxN<FloatN> Phong(float ks, float exp, const Vector3xN<FloatN>& l, const Vector3xN<FloatN>& v, const Vector3xN<FloatN>& n)
+		{
+			const Vector3xN<FloatN> reflect{ l - n * (FloatN{ 2.f } * Dot(n, l)) };
+			const FloatN cosAlpha{ Max(Dot(reflect, v), FloatN{ 0.f }) };
+			const FloatN specular{ FloatN{ ks } * Pow(cosAlpha, FloatN{ exp }) };
+			return { specular, specular, specular };
+		}
+
+		//(1 - h.v)^5 with multiplications instead of powf
+		template<typename FloatN>
+		inline ColorRGBxN<FloatN> FresnelFunction_Schlick(const Vector3xN<FloatN>& h, const Vector3xN<FloatN>& v, const ColorRGB& f0)
+		{
+			const FloatN x{ FloatN{ 1.f } - Dot(h, v) };
+			const FloatN x2{ x * x };
+			const FloatN x5{ x2 * x2 * x };
+
+			const ColorRGBxN<FloatN> base{ f0 };
+			return base + (ColorRGBxN<FloatN>{ ColorRGB{ 1.f, 1.f, 1.f } } - base) * x5;
+		}
+
+		//alphaSquared: roughness^4 (MaterialData::alphaSquared)
+		template<typename FloatN>
+		inline FloatN NormalDistribution_GGX(const FloatN& nDotH, const FloatN& alphaSquared)
+		{
+			const FloatN denominator{ nDotH * nDotH * (alphaSquared - FloatN{ 1.f }) + FloatN{ 1.f } };
+			return alphaSquared / (FloatN{ PI } * denominator * denominator);
+		}
+
+		template<typename FloatN>
+		inline FloatN NormalDistribution_GGX(const Vector3xN<FloatN>& n, const Vector3xN<FloatN>& h, float roughness)
+		{
+			const float a{ Square(roughness) };
+			return NormalDistribution_GGX(Dot(n, h), FloatN{ Square(a) });
+		}
+
+		//k: (roughness^2 + 1)^2 / 8 (MaterialData::k)
+		template<typename FloatN>
+		inline FloatN GeometryFunction_SchlickGGX(const FloatN& nDotV, const FloatN& k)
+		{
+			return nDotV / (nDotV * (FloatN{ 1.f } - k) + k);
+		}
+
+		template<typename FloatN>
+		inline FloatN GeometryFunction_SchlickGGX(const Vector3xN<FloatN>& n, const Vector3xN<FloatN>& v, float roughness)
+		{
+			return GeometryFunction_SchlickGGX(Dot(n, v), FloatN{ Square(Square(roughness) + 1.f) / 8.f });
+		}
+
+		template<typename FloatN>
+		inline FloatN GeometryFunction_Smith(const FloatN& nDotV, const FloatN& nDotL, const FloatN& k)
+		{
+			return GeometryFunction_SchlickGGX(nDotL, k) * GeometryFunction_SchlickGGX(nDotV, k);
+		}
+
+		template<typename FloatN>
+		inline FloatN GeometryFunction_Smith(const Vector3xN<FloatN>& n, const Vector3xN<FloatN>& v, const Vector3xN<FloatN>& l, float roughness)
+		{
+			return GeometryFunction_SchlickGGX(n, l, roughness) * GeometryFunction_SchlickGGX(n, v, roughness);
+		}
+
+		//MaterialData::Shade for FloatN::width hits with the same material
+		template<typename FloatN>
+		inline ColorRGBxN<FloatN> Shade(const MaterialData& material, const Vector3xN<FloatN>& n, const Vector3xN<FloatN>& l, const Vector3xN<FloatN>& v)
+		{
+			switch (material.type)
+			{
+			case MaterialType::SolidColor:
+			case MaterialType::Lambert:
+				return ColorRGBxN<FloatN>{ material.diffuse };
+
+			case MaterialType::LambertPhong:
+				return ColorRGBxN<FloatN>{ material.diffuse } + Phong(material.specularReflectance, material.phongExponent, l, Vector3xN<FloatN>{ Vector3{} } - v, n);
+
+			case MaterialType::CookTorrence:
+			{
+				const Vector3xN<FloatN> sum{ v + l };
+				const Vector3xN<FloatN> halfVector{ sum * (FloatN{ 1.f } / Sqrt(Dot(sum, sum))) };
+
+				const ColorRGBxN<FloatN> F{ FresnelFunction_Schlick(halfVector, v, material.f0) };
+				const FloatN D{ NormalDistribution_GGX(Dot(n, halfVector), FloatN{ material.alphaSquared }) };
+				const FloatN nDotV{ Dot(n, v) };
+				const FloatN nDotL{ Dot(n, l) };
+				const FloatN G{ GeometryFunction_Smith(nDotV, nDotL, FloatN{ material.k }) };
+
+				const ColorRGBxN<FloatN> specular{ F * (D * G / (FloatN{ 4.f } * nDotV * nDotL)) };
+				if (material.isMetal)
+					return specular;
+
+				const ColorRGBxN<FloatN> kd{ ColorRGBxN<FloatN>{ ColorRGB{ 1.f, 1.f, 1.f } } - F };
+				return kd * kd * ColorRGBxN<FloatN>{ material.diffuse } + specular;
+			}
+			}
+			return ColorRGBxN<FloatN>{ ColorRGB{} };
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#include "CPUFeatures.h"
+#include "SIMD.h"
+
+#include <cctype>
+#include <string>
+
+#if defined(SIMD_SSE)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace dae
+{
+	namespace CPUFeatures
+	{
+#if defined(SIMD_SSE)
+		//eax, ebx, ecx and edx of a CPUID leaf
+		static void GetCPUID(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+		{
+#if defined(_MSC_VER)
+			int values[4]{};
+			__cpuidex(values, int(leaf), int(subleaf));
+			for (int i{}; i < 4; ++i)
+				registers[i] = unsigned(values[i]);
+#else
+			__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+		}
+
+		//XCR0, the register states the OS saves on a context switch
+		static uint64_t GetEnabledRegisterStates()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			unsigned int low{};
+			unsigned int high{};
+			__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return (uint64_t(high) << 32) | low;
+#endif
+		}
+
+		static bool IsBitSet(unsigned int value, int bit)
+		{
+			return (value >> bit) & 1;
+		}
+
+		static InstructionSet DetectInstructionSet()
+		{
+			unsigned int registers[4]{};
+			GetCPUID(0, 0, registers);
+			const unsigned int maxLeaf{ registers[0] };
+
+			GetCPUID(1, 0, registers);
+			const unsigned int features{ registers[2] };
+			//SSE4.2 + POPCNT
+			if (!IsBitSet(features, 20) || !IsBitSet(features, 23))
+				return InstructionSet::Baseline;
+
+			//OSXSAVE + AVX, with the XMM and YMM states enabled
+			if (!IsBitSet(features, 27) || !IsBitSet(features, 28) || maxLeaf < 7)
+				return InstructionSet::SSE42;
+			const uint64_t registerStates{ GetEnabledRegisterStates() };
+			if ((registerStates & 0x6) != 0x6)
+				return InstructionSet::SSE42;
+
+			GetCPUID(7, 0, registers);
+			const unsigned int extendedFeatures{ registers[1] };
+			//AVX2 + BMI1 + BMI2
+			if (!IsBitSet(extendedFeatures, 5) || !IsBitSet(extendedFeatures, 3) || !IsBitSet(extendedFeatures, 8))
+				return InstructionSet::SSE42;
+
+			//AVX-512 F + DQ + BW + VL, with the opmask and ZMM states enabled
+			if (!IsBitSet(extendedFeatures, 16) || !IsBitSet(extendedFeatures, 17) || !IsBitSet(extendedFeatures, 30) || !IsBitSet(extendedFeatures, 31)
+				|| (registerStates & 0xE0) != 0xE0)
+				return InstructionSet::AVX2;
+
+			return InstructionSet::AVX512;
+		}
+#else
+		//Nothing to pick from without SSE
+		static InstructionSet DetectInstructionSet()
+		{
+			return InstructionSet::Baseline;
+		}
+#endif
+
+		InstructionSet GetSupportedInstructionSet()
+		{
+			static const InstructionSet supportedInstructionSet{ DetectInstructionSet() };
+			return supportedInstructionSet;
+		}
+
+		const char* GetName(InstructionSet instructionSet)
+		{
+			switch (instructionSet)
+			{
+			case InstructionSet::Baseline:
+#if defined(SIMD_SSE)
+				return "SSE2";
+#elif defined(SIMD_NEON)
+				return "NEON";
+#else
+				return "scalar";
+#endif
+			case InstructionSet::SSE42:
+				return "SSE4.2";
+			case InstructionSet::AVX2:
+				return "AVX2";
+			case InstructionSet::AVX512:
+				return "AVX-512";
+			}
+			return "unknown";
+		}
+
+		//Lowercase without dots and dashes
+		static std::string GetNormalizedName(std::string_view name)
+		{
+			std::string normalizedName{};
+			for (const char character : name)
+			{
+				if (character != '.' && character != '-')
+					normalizedName += char(std::tolower(static_cast<unsigned char>(character)));
+			}
+			return normalizedName;
+		}
+
+		bool ParseInstructionSet(std::string_view name, InstructionSet& instructionSet)
+		{
+			const std::string normalizedName{ GetNormalizedName(name) };
+			for (const InstructionSet candidate : { InstructionSet::Baseline, InstructionSet::SSE42, InstructionSet::AVX2, InstructionSet::AVX512 })
+			{
+				if (normalizedName == GetNormalizedName(GetName(candidate)))
+				{
+					instructionSet = candidate;
+					return true;
+				}
+			}
+			if (normalizedName == "baseline")
+			{
+				instructionSet = InstructionSet::Baseline;
+				return true;
+			}
+			return false;
+		}
+	}
+}
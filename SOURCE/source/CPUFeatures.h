@@ -0,0 +1,30 @@
+#pragma once
+#include <string_view>
+
+namespace dae
+{
+	//Levels the hot kernels are compiled for (see Kernels.h), every level includes the ones before it
+	enum class InstructionSet
+	{
+		Baseline, //What the compiler targets: SSE2 on x86/x64, NEON or plain C++ elsewhere
+		SSE42,
+		AVX2,
+		AVX512 //F + VL + BW + DQ
+	};
+
+	namespace CPUFeatures
+	{
+		//Highest level the CPU and the OS support (the OS has to save the AVX registers), asks CPUID once
+		InstructionSet GetSupportedInstructionSet();
+
+		inline bool IsSupported(InstructionSet instructionSet)
+		{
+			return instructionSet <= GetSupportedInstructionSet();
+		}
+
+		const char* GetName(InstructionSet instructionSet);
+
+		//Accepts the names GetName returns and their lowercase versions without dots ("sse42", "avx512", ...), false for anything else
+		bool ParseInstructionSet(std::string_view name, InstructionSet& instructionSet);
+	}
+}
@@ -1,5 +1,10 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
 
 #include "Math.h"
 #include "vector"
@@ -35,6 +40,19 @@ namespace dae
 
 	};
 
+	//Read-only object space arrays of a mesh that live outside of it (a memory-mapped mesh file, see MeshFile.h, or a cached asset, see AssetCache.h)
+	//pOwner keeps that memory alive for every mesh sharing the arrays
+	struct ExternalMeshArrays
+	{
+		std::shared_ptr<const void> pOwner{};
+		std::span<const Vector3> positions{};
+		std::span<const Vector3> normals{};
+		std::span<const int> indices{};
+		//Prebuilt BVH over the object space triangles, empty when there is none
+		std::span<const BVHNode> bvhNodes{};
+		std::span<const int> triIdx{};
+	};
+
 	enum class TriangleCullMode
 	{
 		FrontFaceCulling,
@@ -73,11 +91,20 @@ namespace dae
 		unsigned char materialIndex{};
 	};
 
+	//Position of a quantized mesh: 16 bit steps inside its AABB (see TriangleMesh::Quantize)
+	struct QuantizedPosition
+	{
+		uint16_t x{};
+		uint16_t y{};
+		uint16_t z{};
+	};
+
 	struct TriangleMesh
 	{
 		TriangleMesh() = default;
-		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, TriangleCullMode _cullMode) :
-			positions(_positions), indices(_indices), cullMode(_cullMode)
+		//The arrays are taken by value, pass them with std::move to hand them over without a copy
+		TriangleMesh(std::vector<Vector3> _positions, std::vector<int> _indices, TriangleCullMode _cullMode) :
+			positions(std::move(_positions)), indices(std::move(_indices)), cullMode(_cullMode)
 		{
 
 			//Calculate Normals
@@ -91,8 +118,8 @@ namespace dae
 			FillTriangleList();
 		}
 
-		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, const std::vector<Vector3>& _normals, TriangleCullMode _cullMode) :
-			positions(_positions), indices(_indices), normals(_normals), cullMode(_cullMode)
+		TriangleMesh(std::vector<Vector3> _positions, std::vector<int> _indices, std::vector<Vector3> _normals, TriangleCullMode _cullMode) :
+			positions(std::move(_positions)), indices(std::move(_indices)), normals(std::move(_normals)), cullMode(_cullMode)
 		{
 
 			UpdateTransforms();
@@ -104,6 +131,8 @@ namespace dae
 		std::vector<Vector3> positions{};
 		std::vector<Vector3> normals{};
 		std::vector<int> indices{};
+		//Replaces the three vectors above (they stay empty) when the mesh comes from a mesh file
+		ExternalMeshArrays external{};
 
 		std::vector<Triangle> triangles{};
 		std::vector<int> triIdx{};
@@ -129,6 +158,124 @@ namespace dae
 		unsigned int rootNodeIdx{ 0 };
 		unsigned int nodesUsed{ 1 };
 
+		//Replace triangles, transformedPositions and transformedNormals once the mesh is quantized
+		std::vector<QuantizedPosition> quantizedPositions{};
+		//Octahedral, x in the low 16 bits and y in the high ones
+		std::vector<uint32_t> quantizedNormals{};
+		//Size of one step on each axis, the steps count from transformedMinAABB
+		Vector3 quantizationStep{};
+
+
+		std::span<const Vector3> GetPositions() const { return external.pOwner ? external.positions : std::span<const Vector3>{ positions }; }
+		std::span<const Vector3> GetNormals() const { return external.pOwner ? external.normals : std::span<const Vector3>{ normals }; }
+		std::span<const int> GetIndices() const { return external.pOwner ? external.indices : std::span<const int>{ indices }; }
+
+		//What the hit tests walk: the pool BuildBVH fills (or a refit copied to), else the prebuilt nodes of the mesh file in place
+		const BVHNode* GetBVHNodes() const { return bvhNodePool.empty() ? external.bvhNodes.data() : bvhNodePool.data(); }
+		const int* GetTriIdx() const { return external.triIdx.empty() ? triIdx.data() : external.triIdx.data(); }
+
+		//Points the mesh at arrays it doesn't own instead of its vectors, nothing gets copied. A prebuilt BVH in them is used
+		//by BuildBVH, the mesh then goes through UpdateTransforms, FillTriangleList and BuildBVH like any other
+		void SetExternalArrays(ExternalMeshArrays arrays, const Vector3& _minAABB, const Vector3& _maxAABB)
+		{
+			positions.clear();
+			normals.clear();
+			indices.clear();
+			triIdx.clear();
+			bvhNodePool.clear();
+			rootNodeIdx = 0;
+			nodesUsed = static_cast<unsigned int>(arrays.bvhNodes.size());
+			external = std::move(arrays);
+			minAABB = _minAABB;
+			maxAABB = _maxAABB;
+		}
+
+		size_t GetNumTriangles() const { return GetIndices().size() / 3; }
+
+		//The stored world space triangle, or for a quantized mesh the one decoded into decoded
+		const Triangle& GetTriangle(int triangleIdx, Triangle& decoded) const
+		{
+			if (quantizedPositions.empty())
+				return triangles[triangleIdx];
+
+			const int* pIndices{ GetIndices().data() + size_t(triangleIdx) * 3 };
+			decoded.v0 = DecodePosition(pIndices[0]);
+			decoded.v1 = DecodePosition(pIndices[1]);
+			decoded.v2 = DecodePosition(pIndices[2]);
+			decoded.normal = DecodeNormal(quantizedNormals[triangleIdx]);
+			decoded.cullMode = cullMode;
+			decoded.materialIndex = materialIndex;
+			return decoded;
+		}
+
+		Vector3 DecodePosition(int vertexIdx) const
+		{
+			const QuantizedPosition& position{ quantizedPositions[vertexIdx] };
+			return {
+				transformedMinAABB.x + float(position.x) * quantizationStep.x,
+				transformedMinAABB.y + float(position.y) * quantizationStep.y,
+				transformedMinAABB.z + float(position.z) * quantizationStep.z };
+		}
+
+		//Unit normal folded onto the octahedron |x| + |y| + |z| = 1, the lower half mirrored over its edges, x and y in 16 bits each
+		static uint32_t EncodeNormal(const Vector3& normal)
+		{
+			const float sumAbs{ fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z) };
+			if (!(sumAbs > 0.f && sumAbs <= FLT_MAX))
+				return EncodeNormal(Vector3::UnitZ);
+
+			float x{ normal.x / sumAbs };
+			float y{ normal.y / sumAbs };
+			if (normal.z < 0.f)
+			{
+				const float foldedX{ (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f) };
+				y = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+				x = foldedX;
+			}
+			const auto toUnorm16 = [](float value) { return uint32_t(std::clamp(value * 0.5f + 0.5f, 0.f, 1.f) * 65535.f + 0.5f); };
+			return toUnorm16(x) | toUnorm16(y) << 16;
+		}
+
+		static Vector3 DecodeNormal(uint32_t encoded)
+		{
+			float x{ float(encoded & 0xFFFF) * (2.f / 65535.f) - 1.f };
+			float y{ float(encoded >> 16) * (2.f / 65535.f) - 1.f };
+			const float z{ 1.f - fabsf(x) - fabsf(y) };
+			const float fold{ std::max(-z, 0.f) };
+			x += x >= 0.f ? -fold : fold;
+			y += y >= 0.f ? -fold : fold;
+			return Vector3{ x, y, z }.Normalized();
+		}
+
+		//Static meshes, after BuildBVH: the world space triangles shrink to 16 bit positions inside the transformed AABB (6 bytes a vertex)
+		//and octahedral normals (4 bytes a triangle) instead of the triangle list (68 bytes a triangle) and the transformed arrays, the hit
+		//tests decode them. The BVH gets refit around the decoded triangles, the mesh can't be transformed anymore
+		void Quantize()
+		{
+			const Vector3 extent{ transformedMaxAABB - transformedMinAABB };
+			quantizationStep = { extent.x / 65535.f, extent.y / 65535.f, extent.z / 65535.f };
+			const Vector3 stepsPerUnit{
+				extent.x > 0.f ? 65535.f / extent.x : 0.f,
+				extent.y > 0.f ? 65535.f / extent.y : 0.f,
+				extent.z > 0.f ? 65535.f / extent.z : 0.f };
+			//The AABB is the transformed corners of the object space one, rounding can put a vertex a hair outside
+			const auto toSteps = [](float value) { return uint16_t(std::clamp(value, 0.f, 65535.f) + 0.5f); };
+
+			quantizedPositions.resize(transformedPositions.size());
+			for (size_t vertexIdx{}; vertexIdx < transformedPositions.size(); ++vertexIdx)
+			{
+				const Vector3 offset{ transformedPositions[vertexIdx] - transformedMinAABB };
+				quantizedPositions[vertexIdx] = { toSteps(offset.x * stepsPerUnit.x), toSteps(offset.y * stepsPerUnit.y), toSteps(offset.z * stepsPerUnit.z) };
+			}
+			quantizedNormals.resize(transformedNormals.size());
+			for (size_t triangleIdx{}; triangleIdx < transformedNormals.size(); ++triangleIdx)
+				quantizedNormals[triangleIdx] = EncodeNormal(transformedNormals[triangleIdx]);
+
+			triangles = {};
+			transformedPositions = {};
+			transformedNormals = {};
+			RefitBVH();
+		}
 
 		void Translate(const Vector3& translation)
 		{
@@ -147,6 +294,7 @@ namespace dae
 
 		void AppendTriangle(const Triangle& triangle, bool ignoreTransformUpdate = false)
 		{
+			assert(!external.pOwner && "the arrays of a mesh file are read-only");
 			int startIndex = static_cast<int>(positions.size());
 
 			positions.push_back(triangle.v0);
@@ -185,40 +333,37 @@ namespace dae
 
 		void UpdateTransforms()
 		{
-			transformedPositions.clear();
-			transformedNormals.clear();
+			assert(quantizedPositions.empty() && "a quantized mesh is static");
+			const std::span<const Vector3> sourcePositions{ GetPositions() };
+			const std::span<const Vector3> sourceNormals{ GetNormals() };
+			transformedPositions.resize(sourcePositions.size());
+			transformedNormals.resize(sourceNormals.size());
 
 			//Calculate Final Transform 
 			const Matrix finalTransform = scaleTransform * rotationTransform * translationTransform;
 
 			//Transform Positions (positions > transformedPositions)
-			for (const auto& p : positions)
-			{
-				transformedPositions.emplace_back(finalTransform.TransformPoint(p));
-			}
+			finalTransform.TransformPoints(sourcePositions.data(), transformedPositions.data(), sourcePositions.size());
 			UpdateTransformedAABB(finalTransform);
 			//Transform Normals (normals > transformedNormals)
-			for (const auto& n : normals)
-			{
-				transformedNormals.emplace_back(finalTransform.TransformVector(n));
-
-			}
-
-
+			finalTransform.TransformVectors(sourceNormals.data(), transformedNormals.data(), sourceNormals.size());
 		}
 		void FillTriangleList()
 		{
-			triangles.resize(indices.size() / 3);
-			triIdx.resize(indices.size() / 3);
+			const std::span<const int> sourceIndices{ GetIndices() };
+			triangles.resize(sourceIndices.size() / 3);
+			//A prebuilt BVH brings its own triangle order
+			if (external.triIdx.empty())
+				triIdx.resize(sourceIndices.size() / 3);
 			int triCounter{};
 
-			for (size_t i{}; i < indices.size(); i += 3)
+			for (size_t i{}; i < sourceIndices.size(); i += 3)
 			{
 				//make triangle out of mesh indices
 				Triangle tri = {
-					transformedPositions[indices[i]],
-					transformedPositions[indices[i + 1]],
-					transformedPositions[indices[i + 2]],
+					transformedPositions[sourceIndices[i]],
+					transformedPositions[sourceIndices[i + 1]],
+					transformedPositions[sourceIndices[i + 2]],
 					transformedNormals[triCounter]
 				};
 
@@ -227,22 +372,24 @@ namespace dae
 
 
 				triangles[triCounter] = tri;
-				triIdx[triCounter] = triCounter;
+				if (external.triIdx.empty())
+					triIdx[triCounter] = triCounter;
 				++triCounter;
 			}
 		}
 
 		void UpdateTriangleList()
 		{
+			const std::span<const int> sourceIndices{ GetIndices() };
 
 			int triCounter{};
-			for (size_t i{}; i < indices.size(); i += 3)
+			for (size_t i{}; i < sourceIndices.size(); i += 3)
 			{
 				//make triangle out of mesh indices
 				Triangle tri = {
-					transformedPositions[indices[i]],
-					transformedPositions[indices[i + 1]],
-					transformedPositions[indices[i + 2]],
+					transformedPositions[sourceIndices[i]],
+					transformedPositions[sourceIndices[i + 1]],
+					transformedPositions[sourceIndices[i + 2]],
 					transformedNormals[triCounter]
 				};
 
@@ -251,16 +398,38 @@ namespace dae
 				triangles[i / 3] = tri;
 				++triCounter;
 			}
-			for (unsigned i{}; i < nodesUsed; ++i)
-				UpdateNodeBounds(i);
+		}
+
+		void RefitBVH()
+		{
+			//The first refit of a prebuilt BVH copies its nodes, the bounds depend on the transform
+			if (bvhNodePool.empty())
+				bvhNodePool.assign(external.bvhNodes.begin(), external.bvhNodes.end());
+
+			// Children are always allocated after their parent, so walking the pool backwards updates them first
+			for (int i{ static_cast<int>(nodesUsed) - 1 }; i >= 0; --i)
+			{
+				BVHNode& node = bvhNodePool[i];
+				if (node.IsLeaf())
+				{
+					UpdateNodeBounds(i);
+					continue;
+				}
+
+				const BVHNode& leftChild = bvhNodePool[node.leftNode];
+				const BVHNode& rightChild = bvhNodePool[node.leftNode + 1];
+				node.aabbMin = Vector3::Min(leftChild.aabbMin, rightChild.aabbMin);
+				node.aabbMax = Vector3::Max(leftChild.aabbMax, rightChild.aabbMax);
+			}
 		}
 		void UpdateAABB()
 		{
-			if (!positions.empty())
+			const std::span<const Vector3> sourcePositions{ GetPositions() };
+			if (!sourcePositions.empty())
 			{
-				minAABB = positions[0];
-				maxAABB = positions[0];
-				for (auto& p : positions)
+				minAABB = sourcePositions[0];
+				maxAABB = sourcePositions[0];
+				for (auto& p : sourcePositions)
 				{
 					minAABB = Vector3::Min(p, minAABB);
 					maxAABB = Vector3::Max(p, maxAABB);
@@ -308,7 +477,18 @@ namespace dae
 
 		void BuildBVH()
 		{
-			const size_t numberOfTriangles{ indices.size() / 3 };
+			//A prebuilt BVH is used in place while the triangles stay in object space (an identity transform gives the same floats),
+			//anything else only needs the bounds refit
+			if (!external.bvhNodes.empty())
+			{
+				bvhNodePool.clear();
+				nodesUsed = static_cast<unsigned int>(external.bvhNodes.size());
+				if (!(scaleTransform * rotationTransform * translationTransform).IsIdentity())
+					RefitBVH();
+				return;
+			}
+
+			const size_t numberOfTriangles{ GetIndices().size() / 3 };
 			bvhNodePool.resize(2 * numberOfTriangles - 1);
 
 
@@ -331,11 +511,13 @@ namespace dae
 			node.aabbMax = { -INFINITY, -INFINITY, -INFINITY };
 
 			// Loop over all the stored triangles in the node
+			const int* pTriIdx{ GetTriIdx() };
+			Triangle decoded{};
 			for (unsigned int first = node.firstTriIdx, i = 0; i < node.triCount; ++i)
 			{
 
-				unsigned leafTriIdx = triIdx[first + i];
-				Triangle& leafTri = triangles[leafTriIdx];
+				unsigned leafTriIdx = pTriIdx[first + i];
+				const Triangle& leafTri = GetTriangle(leafTriIdx, decoded);
 				// Find the bounding box around the stored triangles
 				node.aabbMin = Vector3::Min(node.aabbMin, leafTri.v0);
 				node.aabbMin = Vector3::Min(node.aabbMin, leafTri.v1);
@@ -421,6 +603,140 @@ namespace dae
 		float max{ FLT_MAX };
 	};
 
+	//Up to 8x8 rays sharing one origin (the primary rays of a block of pixels)
+	//Directions are stored per component (SoA) so the loops over the lanes vectorize
+	struct RayPacket
+	{
+		static constexpr int width{ 8 };
+		static constexpr int size{ width * width };
+		//Below this many rays hitting a node, the packet is split up into single rays
+		static constexpr int minCoherentRays{ 8 };
+
+		Vector3 origin{};
+		float directionX[size]{};
+		float directionY[size]{};
+		float directionZ[size]{};
+		float inverseDirectionX[size]{};
+		float inverseDirectionY[size]{};
+		float inverseDirectionZ[size]{};
+		//Lanes of a partial block (screen border) stay inactive
+		bool isActive[size]{};
+
+		float min{ 0.0001f };
+		float max{ FLT_MAX };
+
+		//Planes through the origin enclosing every ray of the packet, normals point inwards
+		Vector3 frustumNormals[4]{};
+
+		void SetDirection(int lane, const Vector3& direction)
+		{
+			directionX[lane] = direction.x;
+			directionY[lane] = direction.y;
+			directionZ[lane] = direction.z;
+			inverseDirectionX[lane] = 1.f / direction.x;
+			inverseDirectionY[lane] = 1.f / direction.y;
+			inverseDirectionZ[lane] = 1.f / direction.z;
+		}
+
+		Vector3 GetDirection(int lane) const
+		{
+			return { directionX[lane], directionY[lane], directionZ[lane] };
+		}
+
+		Ray GetRay(int lane) const
+		{
+			return { origin, GetDirection(lane), min, max };
+		}
+
+		//Spans the frustum with the corner rays of the numColumns x numRows block of active lanes
+		void UpdateFrustum(int numColumns, int numRows)
+		{
+			const Vector3 corners[4]
+			{
+				GetDirection(0),
+				GetDirection(numColumns - 1),
+				GetDirection((numRows - 1) * width + numColumns - 1),
+				GetDirection((numRows - 1) * width)
+			};
+			const Vector3 center{ corners[0] + corners[1] + corners[2] + corners[3] };
+
+			for (int i{}; i < 4; ++i)
+			{
+				frustumNormals[i] = Vector3::Cross(corners[i], corners[(i + 1) % 4]);
+				if (Vector3::Dot(frustumNormals[i], center) < 0.f)
+					frustumNormals[i] = -frustumNormals[i];
+			}
+		}
+	};
+
+	//Shadow rays of a RayPacket's hits towards one light, every lane has its own origin and length
+	struct ShadowRayPacket
+	{
+		static constexpr int size{ RayPacket::size };
+
+		float originX[size]{};
+		float originY[size]{};
+		float originZ[size]{};
+		float directionX[size]{};
+		float directionY[size]{};
+		float directionZ[size]{};
+		float inverseDirectionX[size]{};
+		float inverseDirectionY[size]{};
+		float inverseDirectionZ[size]{};
+		float max[size]{};
+		//Lanes without a hit to shade don't cast a shadow ray
+		bool isActive[size]{};
+
+		float min{ 0.0001f };
+
+		//Box around every ray segment, nodes outside of it are skipped by all lanes at once
+		Vector3 boundsMin{};
+		Vector3 boundsMax{};
+
+		void SetRay(int lane, const Ray& ray)
+		{
+			originX[lane] = ray.origin.x;
+			originY[lane] = ray.origin.y;
+			originZ[lane] = ray.origin.z;
+			directionX[lane] = ray.direction.x;
+			directionY[lane] = ray.direction.y;
+			directionZ[lane] = ray.direction.z;
+			inverseDirectionX[lane] = 1.f / ray.direction.x;
+			inverseDirectionY[lane] = 1.f / ray.direction.y;
+			inverseDirectionZ[lane] = 1.f / ray.direction.z;
+			max[lane] = ray.max;
+		}
+
+		Ray GetRay(int lane) const
+		{
+			return { { originX[lane], originY[lane], originZ[lane] }, { directionX[lane], directionY[lane], directionZ[lane] }, min, max[lane] };
+		}
+
+		void UpdateBounds()
+		{
+			boundsMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+			boundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+			for (int lane{}; lane < size; ++lane)
+			{
+				if (!isActive[lane]) continue;
+
+				const Ray ray{ GetRay(lane) };
+				const Vector3 end{ ray.origin + ray.direction * ray.max };
+
+				//Endless rays (directional lights) can't be bounded
+				if (!std::isfinite(end.x) || !std::isfinite(end.y) || !std::isfinite(end.z))
+				{
+					boundsMin = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+					boundsMax = { FLT_MAX, FLT_MAX, FLT_MAX };
+					return;
+				}
+				boundsMin = Vector3::Min(boundsMin, Vector3::Min(ray.origin, end));
+				boundsMax = Vector3::Max(boundsMax, Vector3::Max(ray.origin, end));
+			}
+		}
+	};
+
 	struct HitRecord
 	{
 		Vector3 origin{};
@@ -430,5 +746,189 @@ namespace dae
 		bool didHit{ false };
 		unsigned char materialIndex{ 0 };
 	};
+
+	//Work done to trace a single ray through the acceleration structures
+	struct TraversalCost
+	{
+		unsigned int nodesVisited{};
+		unsigned int triangleTests{};
+	};
+#pragma endregion
+#pragma region INSTANCES
+	//One placement of a shared mesh: the mesh stays in object space with its own BVH (the bottom level), the instance only
+	//stores the transform the rays go through, so a placement costs this record instead of transformed triangles
+	struct MeshInstance
+	{
+		//Inverse of the instance transform, rows + translation like Matrix (see Matrix::TransformPoint)
+		Vector3 worldToObject[4]{};
+		//Index into the meshes the instances are traced against
+		uint32_t meshIdx{};
+		unsigned char materialIndex{};
+		//False keeps the materials of the mesh's triangles
+		bool overridesMaterial{};
+
+		//The direction isn't normalized, so t is the same in both spaces and ray.min/max still apply
+		Ray ToObjectSpace(const Ray& ray) const
+		{
+			return {
+				worldToObject[0] * ray.origin.x + worldToObject[1] * ray.origin.y + worldToObject[2] * ray.origin.z + worldToObject[3],
+				worldToObject[0] * ray.direction.x + worldToObject[1] * ray.direction.y + worldToObject[2] * ray.direction.z,
+				ray.min,
+				ray.max };
+		}
+
+		//Normals go through the inverse transpose of the transform, the transpose of the worldToObject rows
+		Vector3 NormalToWorld(const Vector3& normal) const
+		{
+			return Vector3{ Vector3::Dot(normal, worldToObject[0]), Vector3::Dot(normal, worldToObject[1]), Vector3::Dot(normal, worldToObject[2]) }.Normalized();
+		}
+	};
+
+	//Top level BVH over the world bounds of mesh instances. Build stores the instances in leaf order,
+	//so the firstTriIdx/triCount of a leaf index the instances directly (no index array per instance)
+	struct InstanceBVH
+	{
+		static constexpr unsigned int maxLeafInstances{ 4 };
+		//Nodes this deep stay leaves whatever their count, keeps HitTest_Instances within its stack
+		static constexpr unsigned int maxDepth{ 64 };
+
+		std::vector<MeshInstance> instances{};
+		std::vector<BVHNode> bvhNodePool{};
+		unsigned int rootNodeIdx{ 0 };
+		unsigned int nodesUsed{ 0 };
+
+		//World bounds of every instance, only kept from AddInstance until Build
+		std::vector<Vector3> instanceMinAABB{};
+		std::vector<Vector3> instanceMaxAABB{};
+
+		//transform: object to world space of the mesh, built like TriangleMesh's (scale * rotation * translation) without projection
+		void AddInstance(uint32_t meshIdx, const TriangleMesh& mesh, const Matrix& transform)
+		{
+			MeshInstance instance{};
+			const Matrix worldToObject{ Matrix::InverseAffine(transform) };
+			instance.worldToObject[0] = worldToObject.GetAxisX();
+			instance.worldToObject[1] = worldToObject.GetAxisY();
+			instance.worldToObject[2] = worldToObject.GetAxisZ();
+			instance.worldToObject[3] = worldToObject.GetTranslation();
+			instance.meshIdx = meshIdx;
+			instance.materialIndex = mesh.materialIndex;
+			instances.push_back(instance);
+
+			//The 8 transformed corners of the object space AABB
+			Vector3 boundsMin{ INFINITY, INFINITY, INFINITY };
+			Vector3 boundsMax{ -INFINITY, -INFINITY, -INFINITY };
+			for (int corner{}; corner < 8; ++corner)
+			{
+				const Vector3 position{ transform.TransformPoint(
+					(corner & 1) ? mesh.maxAABB.x : mesh.minAABB.x,
+					(corner & 2) ? mesh.maxAABB.y : mesh.minAABB.y,
+					(corner & 4) ? mesh.maxAABB.z : mesh.minAABB.z) };
+				boundsMin = Vector3::Min(boundsMin, position);
+				boundsMax = Vector3::Max(boundsMax, position);
+			}
+			instanceMinAABB.push_back(boundsMin);
+			instanceMaxAABB.push_back(boundsMax);
+		}
+
+		void AddInstance(uint32_t meshIdx, const TriangleMesh& mesh, const Matrix& transform, unsigned char materialIndex)
+		{
+			AddInstance(meshIdx, mesh, transform);
+			instances.back().materialIndex = materialIndex;
+			instances.back().overridesMaterial = true;
+		}
+
+		//After the last AddInstance, instances added later need another Build
+		void Build()
+		{
+			nodesUsed = 0;
+			if (instances.empty())
+				return;
+
+			bvhNodePool.resize(2 * instances.size() - 1);
+			BVHNode& root = bvhNodePool[rootNodeIdx];
+			root.leftNode = 0;
+			root.firstTriIdx = 0;
+			root.triCount = static_cast<unsigned int>(instances.size());
+			nodesUsed = 1;
+
+			UpdateNodeBounds(rootNodeIdx);
+			Subdivide(rootNodeIdx);
+
+			bvhNodePool.resize(nodesUsed);
+			bvhNodePool.shrink_to_fit();
+			instanceMinAABB = {};
+			instanceMaxAABB = {};
+		}
+
+		void UpdateNodeBounds(unsigned int nodeIdx)
+		{
+			BVHNode& node = bvhNodePool[nodeIdx];
+			node.aabbMin = { INFINITY, INFINITY, INFINITY };
+			node.aabbMax = { -INFINITY, -INFINITY, -INFINITY };
+			for (unsigned int i{ node.firstTriIdx }; i < node.firstTriIdx + node.triCount; ++i)
+			{
+				node.aabbMin = Vector3::Min(node.aabbMin, instanceMinAABB[i]);
+				node.aabbMax = Vector3::Max(node.aabbMax, instanceMaxAABB[i]);
+			}
+		}
+
+		//Midpoint split like TriangleMesh::Subdivide, but of the centroid bounds: instances overlapping the split plane
+		//are common (large meshes next to small ones) and would otherwise all end up on one side
+		void Subdivide(unsigned int nodeIdx, unsigned int depth = 0)
+		{
+			BVHNode& node = bvhNodePool[nodeIdx];
+			if (node.triCount <= maxLeafInstances || depth >= maxDepth) return;
+
+			Vector3 centroidMin{ INFINITY, INFINITY, INFINITY };
+			Vector3 centroidMax{ -INFINITY, -INFINITY, -INFINITY };
+			for (unsigned int i{ node.firstTriIdx }; i < node.firstTriIdx + node.triCount; ++i)
+			{
+				const Vector3 centroid{ (instanceMinAABB[i] + instanceMaxAABB[i]) * 0.5f };
+				centroidMin = Vector3::Min(centroidMin, centroid);
+				centroidMax = Vector3::Max(centroidMax, centroid);
+			}
+
+			const Vector3 extent{ centroidMax - centroidMin };
+			int axis{ 0 };
+			if (extent.y > extent.x) axis = 1;
+			if (extent.z > extent[axis]) axis = 2;
+			const float splitPos{ centroidMin[axis] + extent[axis] * 0.5f };
+
+			int i = node.firstTriIdx;
+			int j = i + node.triCount - 1;
+			while (i <= j)
+			{
+				if ((instanceMinAABB[i][axis] + instanceMaxAABB[i][axis]) * 0.5f < splitPos)
+				{
+					i++;
+				}
+				else
+				{
+					std::swap(instances[i], instances[j]);
+					std::swap(instanceMinAABB[i], instanceMinAABB[j]);
+					std::swap(instanceMaxAABB[i], instanceMaxAABB[j]);
+					j--;
+				}
+			}
+
+			//Every centroid in the same spot
+			const int leftCount = i - node.firstTriIdx;
+			if (leftCount == 0 || leftCount == static_cast<int>(node.triCount)) return;
+
+			const unsigned int leftChildIdx = nodesUsed++;
+			const unsigned int rightChildIdx = nodesUsed++;
+			bvhNodePool[leftChildIdx].firstTriIdx = node.firstTriIdx;
+			bvhNodePool[leftChildIdx].triCount = leftCount;
+			bvhNodePool[rightChildIdx].firstTriIdx = i;
+			bvhNodePool[rightChildIdx].triCount = node.triCount - leftCount;
+			node.leftNode = leftChildIdx;
+			node.triCount = 0;
+			UpdateNodeBounds(leftChildIdx);
+			UpdateNodeBounds(rightChildIdx);
+
+			Subdivide(leftChildIdx, depth + 1);
+			Subdivide(rightChildIdx, depth + 1);
+		}
+	};
 #pragma endregion
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include "SIMD.h"
+
+//Uncomment to trade a few ulps in the hot math paths for speed:
+//Vector3::Normalize(d) through rsqrt + Newton, the Phong and Schlick powers without powf and the sphere hit test without divides
+//Every fast path is validated against a double precision reference by the KernelBenchmark, run it after touching any of them
+//#define FAST_MATH
+
+namespace dae
+{
+	//Scalar versions of the SIMD.h approximations, lane 0 of a single SIMD instruction
+	namespace FastMath
+	{
+		inline float Reciprocal(float x)
+		{
+			return GetFirstLane(dae::Reciprocal(Float4{ x }));
+		}
+
+		inline float InvSqrt(float x)
+		{
+			return GetFirstLane(dae::InvSqrt(Float4{ x }));
+		}
+
+		//x^y for x >= 0, 0 for x <= 0 where powf would return a sign depending on y (or NaN), relative error below 2e-3 for y up to 200
+		inline float Pow(float x, float y)
+		{
+			return GetFirstLane(dae::Pow(Float4{ x }, Float4{ y }));
+		}
+
+		//x^5 with multiplications, exact up to rounding
+		inline float Pow5(float x)
+		{
+			const float x2{ x * x };
+			return x2 * x2 * x;
+		}
+	}
+}
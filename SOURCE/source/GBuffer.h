@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Primary hits of a single screen tile, stored per component (SoA)
+	//Filled before any shading happens so the hits can be shaded grouped by material instead of in pixel order
+	struct TileGBuffer
+	{
+		//Room for every pixel of a 16x16 tile
+		static constexpr int size{ 256 };
+		//Words of a visibility mask covering every entry, a bit per entry
+		static constexpr int numMaskWords{ size / 64 };
+		//Material indices are unsigned chars
+		static constexpr int maxMaterials{ 256 };
+
+		float t[size];
+		float positionX[size];
+		float positionY[size];
+		float positionZ[size];
+		float normalX[size];
+		float normalY[size];
+		float normalZ[size];
+		unsigned char materialIndices[size];
+		uint32_t pixelIndices[size];
+		int numHits{};
+
+		//Entries in shading order, grouped by material (see SortByMaterial)
+		uint16_t sortedEntries[size];
+
+		HitRecord GetHit(int entryIdx) const
+		{
+			HitRecord hitRecord{};
+			hitRecord.origin = { positionX[entryIdx], positionY[entryIdx], positionZ[entryIdx] };
+			hitRecord.normal = { normalX[entryIdx], normalY[entryIdx], normalZ[entryIdx] };
+			hitRecord.t = t[entryIdx];
+			hitRecord.didHit = true;
+			hitRecord.materialIndex = materialIndices[entryIdx];
+			return hitRecord;
+		}
+
+		void AddHit(const HitRecord& hitRecord, uint32_t pixelIndex)
+		{
+			t[numHits] = hitRecord.t;
+			positionX[numHits] = hitRecord.origin.x;
+			positionY[numHits] = hitRecord.origin.y;
+			positionZ[numHits] = hitRecord.origin.z;
+			normalX[numHits] = hitRecord.normal.x;
+			normalY[numHits] = hitRecord.normal.y;
+			normalZ[numHits] = hitRecord.normal.z;
+			materialIndices[numHits] = hitRecord.materialIndex;
+			pixelIndices[numHits] = pixelIndex;
+			++numHits;
+		}
+
+		//Counting sort of the entries on material index, entries of the same material keep their (pixel) order
+		//pMaterialOffsets (numMaterials + 1 long) gets the first sorted entry of every material, numHits at numMaterials
+		void SortByMaterial(uint16_t* pMaterialOffsets, int numMaterials)
+		{
+			for (int materialIdx{}; materialIdx <= numMaterials; ++materialIdx)
+				pMaterialOffsets[materialIdx] = 0;
+			for (int entryIdx{}; entryIdx < numHits; ++entryIdx)
+				++pMaterialOffsets[materialIndices[entryIdx] + 1];
+			for (int materialIdx{}; materialIdx < numMaterials; ++materialIdx)
+				pMaterialOffsets[materialIdx + 1] += pMaterialOffsets[materialIdx];
+
+			uint16_t nextEntries[maxMaterials];
+			for (int materialIdx{}; materialIdx < numMaterials; ++materialIdx)
+				nextEntries[materialIdx] = pMaterialOffsets[materialIdx];
+			for (int entryIdx{}; entryIdx < numHits; ++entryIdx)
+				sortedEntries[nextEntries[materialIndices[entryIdx]]++] = uint16_t(entryIdx);
+		}
+	};
+}
@@ -0,0 +1,2117 @@
+//Standard includes
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//Project includes
+#include "Math.h"
+#include "DataTypes.h"
+#include "Utils.h"
+#include "RaySorting.h"
+#include "BRDFsSIMD.h"
+#include "Kernels.h"
+#include "MeshCleanup.h"
+#include "MeshFile.h"
+#include "AssetCache.h"
+
+using namespace dae;
+
+namespace dae
+{
+	//Set of rays every kernel is measured against
+	struct RaySet
+	{
+		std::string name{};
+		std::vector<Ray> rays{};
+		//Rays per row when the set is an image (row by row), 0 when the rays are unordered
+		int width{};
+	};
+
+	//Geometry of a renderer scene (Scene.cpp) without its materials and lights, traced like Scene::GetClosestHit(s)
+	struct SceneGeometry
+	{
+		std::string name{};
+		Vector3 cameraOrigin{};
+		float fovAngle{};
+		std::vector<TriangleMesh> meshes{};
+		std::vector<Plane> planes{};
+		std::vector<Sphere> spheres{};
+	};
+
+	//Shading inputs every BRDF kernel is measured against, stored per component so 8 samples load as a Vector3x8
+	struct BRDFSamples
+	{
+		std::vector<float> normalX{}, normalY{}, normalZ{};
+		std::vector<float> lightX{}, lightY{}, lightZ{};
+		std::vector<float> viewX{}, viewY{}, viewZ{};
+
+		size_t GetSize() const { return normalX.size(); }
+		Vector3 GetNormal(size_t idx) const { return { normalX[idx], normalY[idx], normalZ[idx] }; }
+		Vector3 GetLight(size_t idx) const { return { lightX[idx], lightY[idx], lightZ[idx] }; }
+		Vector3 GetView(size_t idx) const { return { viewX[idx], viewY[idx], viewZ[idx] }; }
+		Vector3x8 GetNormals(size_t first) const { return Vector3x8::Load(&normalX[first], &normalY[first], &normalZ[first]); }
+		Vector3x8 GetLights(size_t first) const { return Vector3x8::Load(&lightX[first], &lightY[first], &lightZ[first]); }
+		Vector3x8 GetViews(size_t first) const { return Vector3x8::Load(&viewX[first], &viewY[first], &viewZ[first]); }
+	};
+
+	//Linear colors the framebuffer conversion is measured against, stored per channel like the renderer's float buffer
+	struct ColorSamples
+	{
+		std::vector<float> red{}, green{}, blue{};
+
+		size_t GetSize() const { return red.size(); }
+	};
+
+	class KernelBenchmark final
+	{
+	public:
+		KernelBenchmark() = default;
+		~KernelBenchmark() = default;
+
+		KernelBenchmark(const KernelBenchmark&) = delete;
+		KernelBenchmark(KernelBenchmark&&) noexcept = delete;
+		KernelBenchmark& operator=(const KernelBenchmark&) = delete;
+		KernelBenchmark& operator=(KernelBenchmark&&) noexcept = delete;
+
+		/**
+		 * \brief Camera-like rays from a single eye point through a square image plane (same math as Renderer::RenderPixel)
+		 * \param numRays Number of rays, rounded down to a square resolution
+		 * \param eye Origin of all rays
+		 * \param target Point the image plane is centered on
+		 * \param fovAngle Vertical field of view in degrees
+		 */
+		static RaySet GenerateCoherentRays(size_t numRays, const Vector3& eye, const Vector3& target, float fovAngle)
+		{
+			RaySet raySet{ "coherent" };
+
+			const Vector3 forward{ (target - eye).Normalized() };
+			const Vector3 right{ Vector3::Cross(Vector3::UnitY, forward).Normalized() };
+			const Vector3 up{ Vector3::Cross(forward, right).Normalized() };
+			const float fov{ tanf(fovAngle * TO_RADIANS / 2.0f) };
+
+			const int resolution{ std::max(1, int(sqrtf(float(numRays)))) };
+			raySet.rays.reserve(size_t(resolution) * resolution);
+			raySet.width = resolution;
+
+			for (int py{}; py < resolution; ++py)
+			{
+				for (int px{}; px < resolution; ++px)
+				{
+					const float cx{ (2.f * (px + 0.5f) / float(resolution) - 1.0f) * fov };
+					const float cy{ (1.f - 2.f * (py + 0.5f) / float(resolution)) * fov };
+
+					const Vector3 direction{ (right * cx + up * cy + forward).Normalized() };
+					raySet.rays.push_back(Ray{ eye, direction });
+				}
+			}
+			return raySet;
+		}
+
+		/**
+		 * \brief The primary rays of a scene, same math as Renderer::GetPrimaryRayDirection with the camera looking down +z
+		 * \param scene Scene whose camera shoots the rays
+		 * \param width Horizontal resolution of the image
+		 * \param height Vertical resolution of the image
+		 */
+		static RaySet GeneratePrimaryRays(const SceneGeometry& scene, int width, int height)
+		{
+			RaySet raySet{ scene.name + " primary" };
+			raySet.rays.reserve(size_t(width) * height);
+			raySet.width = width;
+
+			const Matrix cameraToWorld{ Vector4{ Vector3::UnitX, 0.f }, Vector4{ Vector3::UnitY, 0.f }, Vector4{ Vector3::UnitZ, 0.f }, Vector4{ scene.cameraOrigin, 1.f } };
+			const float aspectRatio{ float(width) / float(height) };
+			const float fov{ tanf(scene.fovAngle * TO_RADIANS / 2.0f) };
+
+			for (int py{}; py < height; ++py)
+			{
+				for (int px{}; px < width; ++px)
+				{
+					const float cx{ (2.f * (px + 0.5f) / float(width) - 1.0f) * (aspectRatio * fov) };
+					const float cy{ (1.f - 2.f * (py + 0.5f) / float(height)) * fov };
+
+					Vector3 direction{ cameraToWorld.TransformVector(Vector3{ cx, cy, 1.f }) };
+					direction.Normalize();
+					raySet.rays.push_back(Ray{ scene.cameraOrigin, direction });
+				}
+			}
+			return raySet;
+		}
+
+		/**
+		 * \brief Random origins inside a box shooting in uniformly distributed directions (worst case for caches and branch predictors)
+		 * \param numRays Number of rays
+		 * \param boundsMin Minimum corner of the box the origins are picked in
+		 * \param boundsMax Maximum corner of the box the origins are picked in
+		 * \param seed Seed of the generator, a fixed seed makes every run trace the exact same rays
+		 */
+		static RaySet GenerateIncoherentRays(size_t numRays, const Vector3& boundsMin, const Vector3& boundsMax, uint32_t seed)
+		{
+			RaySet raySet{ "incoherent" };
+			raySet.rays.reserve(numRays);
+
+			std::mt19937 generator{ seed };
+			std::uniform_real_distribution<float> unitDistribution{ 0.f, 1.f };
+			std::normal_distribution<float> normalDistribution{ 0.f, 1.f };
+
+			for (size_t i{}; i < numRays; ++i)
+			{
+				const Vector3 origin{
+					Lerpf(boundsMin.x, boundsMax.x, unitDistribution(generator)),
+					Lerpf(boundsMin.y, boundsMax.y, unitDistribution(generator)),
+					Lerpf(boundsMin.z, boundsMax.z, unitDistribution(generator)) };
+
+				//Normalized gaussian vector = uniform direction on the sphere
+				Vector3 direction{};
+				do
+				{
+					direction = { normalDistribution(generator), normalDistribution(generator), normalDistribution(generator) };
+				} while (direction.SqrMagnitude() < 1e-6f);
+
+				raySet.rays.push_back(Ray{ origin, direction.Normalized() });
+			}
+			return raySet;
+		}
+
+		/**
+		 * \brief Secondary rays of a perfect mirror: every ray of the set that hits gets reflected around the normal at its hit point
+		 * \param raySet Rays that hit the mirror first
+		 * \param kernel bool(const Ray&, HitRecord&) closest hit kernel of the mirror
+		 */
+		template<typename Kernel>
+		static RaySet GenerateReflectedRays(const RaySet& raySet, Kernel&& kernel)
+		{
+			RaySet reflectedSet{ "reflected" };
+			for (const Ray& ray : raySet.rays)
+			{
+				HitRecord hitRecord{};
+				if (!kernel(ray, hitRecord))
+					continue;
+
+				//Meshes without culling can be hit from the back, offset the origin to the side the ray came from
+				const Vector3 normal{ Vector3::Dot(ray.direction, hitRecord.normal) > 0.f ? -hitRecord.normal : hitRecord.normal };
+				reflectedSet.rays.push_back(Ray{ hitRecord.origin + normal * 0.0001f, Vector3::Reflect(ray.direction, normal) });
+			}
+			return reflectedSet;
+		}
+
+		//Copy of an unordered set sorted on origin and direction (see RaySorting)
+		static RaySet GenerateSortedRays(const RaySet& raySet)
+		{
+			RaySet sortedSet{ raySet.name + " sorted", raySet.rays };
+			RaySorting::SortRays(sortedSet.rays);
+			return sortedSet;
+		}
+
+		/**
+		 * \brief Random normals with light and view directions in the hemisphere above them, like every lit hit the renderer shades
+		 * \param numSamples Number of samples, rounded down to a multiple of Float8::width
+		 * \param seed Seed of the generator
+		 */
+		static BRDFSamples GenerateBRDFSamples(size_t numSamples, uint32_t seed)
+		{
+			std::mt19937 generator{ seed };
+			std::normal_distribution<float> normalDistribution{ 0.f, 1.f };
+			const auto getDirection = [&]()
+				{
+					Vector3 direction{};
+					do
+					{
+						direction = { normalDistribution(generator), normalDistribution(generator), normalDistribution(generator) };
+					} while (direction.SqrMagnitude() < 1e-6f);
+					return direction.Normalized();
+				};
+
+			BRDFSamples samples{};
+			numSamples -= numSamples % Float8::width;
+			while (samples.GetSize() < numSamples)
+			{
+				const Vector3 normal{ getDirection() };
+				Vector3 light{ getDirection() };
+				Vector3 view{ getDirection() };
+				light = Vector3::Dot(light, normal) < 0.f ? -light : light;
+				view = Vector3::Dot(view, normal) < 0.f ? -view : view;
+
+				//Grazing angles blow the Cook-Torrance denominator up, the renderer never shades those either (observed area ~0)
+				if (Vector3::Dot(light, normal) < 0.01f || Vector3::Dot(view, normal) < 0.01f)
+					continue;
+
+				samples.normalX.push_back(normal.x); samples.normalY.push_back(normal.y); samples.normalZ.push_back(normal.z);
+				samples.lightX.push_back(light.x); samples.lightY.push_back(light.y); samples.lightZ.push_back(light.z);
+				samples.viewX.push_back(view.x); samples.viewY.push_back(view.y); samples.viewZ.push_back(view.z);
+			}
+			return samples;
+		}
+
+		/**
+		 * \brief Random colors between black and twice the brightest displayable one, so MaxToOne has to scale about half of them
+		 * \param numSamples Number of colors
+		 * \param seed Seed of the generator
+		 */
+		static ColorSamples GenerateColorSamples(size_t numSamples, uint32_t seed)
+		{
+			std::mt19937 generator{ seed };
+			std::uniform_real_distribution<float> channelDistribution{ 0.f, 2.f };
+
+			ColorSamples samples{};
+			for (size_t i{}; i < numSamples; ++i)
+			{
+				samples.red.push_back(channelDistribution(generator));
+				samples.green.push_back(channelDistribution(generator));
+				samples.blue.push_back(channelDistribution(generator));
+			}
+			return samples;
+		}
+
+		/**
+		 * \brief OBJ text with every statement OBJLoader handles: polygons of 3 to 5 corners in all four corner forms,
+		 * positive and negative indices, objects and groups (some without faces)
+		 * \param numPositions Number of v statements, the vt/vn/f/o/g statements come in proportion
+		 * \param seed Seed of the generator
+		 */
+		static std::string GenerateOBJText(size_t numPositions, uint32_t seed)
+		{
+			std::mt19937 generator{ seed };
+			std::uniform_real_distribution<float> coordinateDistribution{ -10.f, 10.f };
+			std::uniform_int_distribution<int> statementDistribution{ 0, 99 };
+
+			std::string text{ "# generated\n" };
+			size_t numTexCoords{};
+			size_t numNormals{};
+			size_t positionCount{};
+			//Random one of the count so far, half of them written relative to the end
+			const auto appendIndex = [&](size_t count)
+				{
+					const int index{ std::uniform_int_distribution<int>{ 1, int(count) }(generator) };
+					text += std::to_string(generator() % 2 ? index : index - int(count) - 1);
+				};
+
+			while (positionCount < numPositions)
+			{
+				const int statement{ statementDistribution(generator) };
+				if (statement < 35 || positionCount < 3)
+				{
+					text += "v " + std::to_string(coordinateDistribution(generator)) + ' ' + std::to_string(coordinateDistribution(generator)) + ' '
+						+ std::to_string(coordinateDistribution(generator)) + '\n';
+					++positionCount;
+				}
+				else if (statement < 45)
+				{
+					text += "vt " + std::to_string(coordinateDistribution(generator)) + ' ' + std::to_string(coordinateDistribution(generator)) + '\n';
+					++numTexCoords;
+				}
+				else if (statement < 55)
+				{
+					text += "vn 0 " + std::to_string(coordinateDistribution(generator)) + " 1\n";
+					++numNormals;
+				}
+				else if (statement < 57)
+				{
+					text += "o object" + std::to_string(positionCount) + '\n';
+				}
+				else if (statement < 60)
+				{
+					text += "g group" + std::to_string(positionCount) + '\n';
+				}
+				else
+				{
+					const int numCorners{ std::uniform_int_distribution<int>{ 3, 5 }(generator) };
+					const int form{ std::uniform_int_distribution<int>{ 0, 3 }(generator) };
+					const bool hasTexCoord{ (form == 1 || form == 3) && numTexCoords > 0 };
+					const bool hasNormal{ (form == 2 || form == 3) && numNormals > 0 };
+					text += 'f';
+					for (int corner{}; corner < numCorners; ++corner)
+					{
+						text += ' ';
+						appendIndex(positionCount);
+						if (hasTexCoord || hasNormal)
+							text += '/';
+						if (hasTexCoord)
+							appendIndex(numTexCoords);
+						if (hasNormal)
+						{
+							text += '/';
+							appendIndex(numNormals);
+						}
+					}
+					text += '\n';
+				}
+			}
+			return text;
+		}
+
+		/**
+		 * \brief Triangle soup of a mesh the way AppendTriangle builds one (3 positions per triangle), with a copy of every 8th triangle
+		 * starting at its second corner and a degenerate triangle (a corner repeated) after every 16th
+		 * \param positions Positions of the mesh
+		 * \param indices Indices of the mesh
+		 * \param soupPositions Filled with the positions of the soup
+		 * \param soupIndices Filled with the indices of the soup
+		 */
+		static void CreateTriangleSoup(std::span<const Vector3> positions, std::span<const int> indices, std::vector<Vector3>& soupPositions, std::vector<int>& soupIndices)
+		{
+			soupPositions.clear();
+			soupIndices.clear();
+			const auto appendTriangle = [&](int v0, int v1, int v2)
+				{
+					soupIndices.insert(soupIndices.end(), { int(soupPositions.size()), int(soupPositions.size()) + 1, int(soupPositions.size()) + 2 });
+					soupPositions.insert(soupPositions.end(), { positions[v0], positions[v1], positions[v2] });
+				};
+
+			for (size_t index{}; index + 2 < indices.size(); index += 3)
+			{
+				appendTriangle(indices[index], indices[index + 1], indices[index + 2]);
+				if (index / 3 % 8 == 0)
+					appendTriangle(indices[index + 1], indices[index + 2], indices[index]);
+				if (index / 3 % 16 == 0)
+					appendTriangle(indices[index], indices[index], indices[index + 1]);
+			}
+		}
+
+		/**
+		 * \brief Cuts an image ray set into 8x8 blocks sharing one origin, like the renderer does with its tiles
+		 * \param raySet Rays to bundle, returns no packets when it isn't an image or the origins differ
+		 */
+		static std::vector<RayPacket> GeneratePackets(const RaySet& raySet)
+		{
+			std::vector<RayPacket> packets{};
+			if (raySet.width == 0 || raySet.rays.empty())
+				return packets;
+
+			const int height{ int(raySet.rays.size()) / raySet.width };
+			for (int beginY{}; beginY < height; beginY += RayPacket::width)
+			{
+				for (int beginX{}; beginX < raySet.width; beginX += RayPacket::width)
+				{
+					const int numColumns{ std::min(raySet.width - beginX, RayPacket::width) };
+					const int numRows{ std::min(height - beginY, RayPacket::width) };
+
+					RayPacket packet{};
+					packet.origin = raySet.rays.front().origin;
+					for (int y{}; y < RayPacket::width; ++y)
+					{
+						for (int x{}; x < RayPacket::width; ++x)
+						{
+							const int lane{ y * RayPacket::width + x };
+							const Ray& ray{ raySet.rays[size_t(beginY + std::min(y, numRows - 1)) * raySet.width + beginX + std::min(x, numColumns - 1)] };
+							if (ray.origin.x != packet.origin.x || ray.origin.y != packet.origin.y || ray.origin.z != packet.origin.z)
+								return {};
+
+							packet.isActive[lane] = x < numColumns && y < numRows;
+							packet.SetDirection(lane, ray.direction);
+						}
+					}
+					packet.UpdateFrustum(numColumns, numRows);
+					packets.push_back(packet);
+				}
+			}
+			return packets;
+		}
+
+		/**
+		 * \brief Bundles every 64 consecutive rays of the set into a shadow packet, origins and lengths may differ per lane
+		 * \param raySet Rays to bundle
+		 */
+		static std::vector<ShadowRayPacket> GenerateShadowPackets(const RaySet& raySet)
+		{
+			std::vector<ShadowRayPacket> packets{};
+			for (size_t first{}; first < raySet.rays.size(); first += ShadowRayPacket::size)
+			{
+				ShadowRayPacket packet{};
+				for (int lane{}; lane < ShadowRayPacket::size && first + lane < raySet.rays.size(); ++lane)
+				{
+					packet.isActive[lane] = true;
+					packet.SetRay(lane, raySet.rays[first + lane]);
+				}
+				packet.UpdateBounds();
+				packets.push_back(packet);
+			}
+			return packets;
+		}
+
+		/**
+		 * \brief Times a kernel over every ray of the set, keeps the fastest of a few repetitions
+		 * \param kernelName Name the kernel is reported under
+		 * \param raySet Rays to test
+		 * \param kernel bool(const Ray&, HitRecord&), returns true on a hit
+		 */
+		template<typename Kernel>
+		void Measure(const std::string& kernelName, const RaySet& raySet, Kernel&& kernel)
+		{
+			double bestSeconds{ DBL_MAX };
+			size_t numHits{};
+
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				HitRecord hitRecord{};
+				numHits = 0;
+
+				const auto start = std::chrono::steady_clock::now();
+				for (const Ray& ray : raySet.rays)
+				{
+					if (kernel(ray, hitRecord))
+						++numHits;
+				}
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+			}
+
+			const double numTests{ double(raySet.rays.size()) };
+			m_Results.push_back({
+				kernelName,
+				raySet.name,
+				raySet.rays.size(),
+				bestSeconds * 1e9 / numTests,
+				numTests / bestSeconds,
+				double(numHits) / numTests });
+		}
+
+		/**
+		 * \brief Times a packet kernel over every packet of the set, reported per ray
+		 * \param kernelName Name the kernel is reported under
+		 * \param raySet Rays the packets were made from
+		 * \param packets Packets of the set (see GeneratePackets and GenerateShadowPackets)
+		 * \param kernel void(const Packet&, HitRecord*), fills the hit record of every lane
+		 */
+		template<typename Packet, typename Kernel>
+		void MeasurePackets(const std::string& kernelName, const RaySet& raySet, const std::vector<Packet>& packets, Kernel&& kernel)
+		{
+			double bestSeconds{ DBL_MAX };
+			size_t numHits{};
+			size_t numRays{};
+
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				numHits = 0;
+				numRays = 0;
+
+				const auto start = std::chrono::steady_clock::now();
+				for (const Packet& packet : packets)
+				{
+					HitRecord hitRecords[Packet::size]{};
+					kernel(packet, hitRecords);
+
+					for (int lane{}; lane < Packet::size; ++lane)
+					{
+						numRays += packet.isActive[lane];
+						numHits += packet.isActive[lane] && hitRecords[lane].didHit;
+					}
+				}
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+			}
+
+			const double numTests{ double(numRays) };
+			m_Results.push_back({
+				kernelName,
+				raySet.name,
+				numRays,
+				bestSeconds * 1e9 / numTests,
+				numTests / bestSeconds,
+				double(numHits) / numTests });
+		}
+
+		/**
+		 * \brief Times sorting the set (see RaySorting), reported per ray so it adds up with the kernels traced in sorted order
+		 * \param raySet Rays to sort, a copy gets sorted every repetition
+		 */
+		void MeasureSort(const RaySet& raySet)
+		{
+			double bestSeconds{ DBL_MAX };
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				std::vector<Ray> rays{ raySet.rays };
+
+				const auto start = std::chrono::steady_clock::now();
+				RaySorting::SortRays(rays);
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+			}
+
+			const double numTests{ double(raySet.rays.size()) };
+			m_Results.push_back({ "SortRays", raySet.name, raySet.rays.size(), bestSeconds * 1e9 / numTests, numTests / bestSeconds, 0.0 });
+		}
+
+		/**
+		 * \brief Times a BRDF kernel over every sample, keeps the fastest of a few repetitions
+		 * \param kernelName Name the kernel is reported under
+		 * \param samples Shading inputs
+		 * \param kernel ColorRGB(n, l, v) per sample or ColorRGBx8(n, l, v) per 8 samples
+		 */
+		template<typename Kernel>
+		void MeasureBRDF(const std::string& kernelName, const BRDFSamples& samples, Kernel&& kernel)
+		{
+			constexpr bool isWide{ std::is_invocable_v<Kernel, const Vector3x8&, const Vector3x8&, const Vector3x8&> };
+			constexpr size_t width{ isWide ? Float8::width : 1 };
+
+			double bestSeconds{ DBL_MAX };
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				//Summed so the compiler can't skip the evaluations
+				float sum[Float8::width]{};
+
+				const auto start = std::chrono::steady_clock::now();
+				for (size_t first{}; first < samples.GetSize(); first += width)
+				{
+					if constexpr (isWide)
+					{
+						float red[Float8::width];
+						kernel(samples.GetNormals(first), samples.GetLights(first), samples.GetViews(first)).r.Store(red);
+						for (size_t lane{}; lane < width; ++lane)
+							sum[lane] += red[lane];
+					}
+					else
+					{
+						sum[0] += kernel(samples.GetNormal(first), samples.GetLight(first), samples.GetView(first)).r;
+					}
+				}
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+				m_Sink += sum[0];
+			}
+
+			const double numTests{ double(samples.GetSize()) };
+			m_Results.push_back({ kernelName, "brdf samples", samples.GetSize(), bestSeconds * 1e9 / numTests, numTests / bestSeconds, 0.0 });
+		}
+
+		/**
+		 * \brief Times a shading kernel over every sample, keeps the fastest of a few repetitions
+		 * \param kernelName Name the kernel is reported under
+		 * \param samples Shading inputs, copied to the per component blocks the kernel takes before the timing starts
+		 * \param material Material every sample is shaded with
+		 * \param shade KernelTable::shade of the variant
+		 */
+		void MeasureShade(const std::string& kernelName, const BRDFSamples& samples, const MaterialData& material, decltype(KernelTable::shade) shade)
+		{
+			constexpr size_t width{ Float8::width };
+			std::vector<float> normals(3 * samples.GetSize());
+			std::vector<float> lightDirections(3 * samples.GetSize());
+			std::vector<float> viewDirections(3 * samples.GetSize());
+			for (size_t idx{}; idx < samples.GetSize(); ++idx)
+			{
+				const size_t first{ idx / width * 3 * width + idx % width };
+				normals[first] = samples.normalX[idx]; normals[first + width] = samples.normalY[idx]; normals[first + 2 * width] = samples.normalZ[idx];
+				lightDirections[first] = samples.lightX[idx]; lightDirections[first + width] = samples.lightY[idx]; lightDirections[first + 2 * width] = samples.lightZ[idx];
+				viewDirections[first] = samples.viewX[idx]; viewDirections[first + width] = samples.viewY[idx]; viewDirections[first + 2 * width] = samples.viewZ[idx];
+			}
+
+			double bestSeconds{ DBL_MAX };
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				//Summed so the compiler can't skip the evaluations
+				float sum{};
+
+				const auto start = std::chrono::steady_clock::now();
+				for (size_t first{}; first < normals.size(); first += 3 * width)
+				{
+					float colors[3 * width];
+					shade(material, &normals[first], &lightDirections[first], &viewDirections[first], colors);
+					sum += colors[0];
+				}
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+				m_Sink += sum;
+			}
+
+			const double numTests{ double(samples.GetSize()) };
+			m_Results.push_back({ kernelName, "brdf samples", samples.GetSize(), bestSeconds * 1e9 / numTests, numTests / bestSeconds, 0.0 });
+		}
+
+		/**
+		 * \brief Times a framebuffer conversion kernel over every color, keeps the fastest of a few repetitions
+		 * \param kernelName Name the kernel is reported under
+		 * \param samples Colors to convert
+		 * \param convertColors KernelTable::convertColors of the variant
+		 */
+		void MeasureConvertColors(const std::string& kernelName, const ColorSamples& samples, decltype(KernelTable::convertColors) convertColors)
+		{
+			const PixelFormat format{ 16, 8, 0, 0xFF000000 };
+			std::vector<uint32_t> pixels(samples.GetSize());
+
+			double bestSeconds{ DBL_MAX };
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				convertColors(samples.red.data(), samples.green.data(), samples.blue.data(), pixels.data(), samples.GetSize(), format);
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+				m_Sink += float(pixels[repetition % pixels.size()]);
+			}
+
+			const double numTests{ double(samples.GetSize()) };
+			m_Results.push_back({ kernelName, "colors", samples.GetSize(), bestSeconds * 1e9 / numTests, numTests / bestSeconds, 0.0 });
+		}
+
+		/**
+		 * \brief Times OBJLoader::Parse on OBJ text in memory, reported per triangle
+		 * \param kernelName Name the parse is reported under
+		 * \param text OBJ text (see GenerateOBJText)
+		 * \param numThreads Threads the parse may use, 0 for every core
+		 */
+		void MeasureParseOBJ(const std::string& kernelName, const std::string& text, unsigned int numThreads)
+		{
+			OBJData data{};
+			double bestSeconds{ DBL_MAX };
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				OBJLoader::Parse(text, data, nullptr, numThreads);
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+			}
+
+			const double numTests{ double(data.GetNumTriangles()) };
+			m_Results.push_back({ kernelName, "generated obj", data.GetNumTriangles(), bestSeconds * 1e9 / numTests, numTests / bestSeconds, 0.0 });
+		}
+
+		/**
+		 * \brief Times getting a mesh from a file ready for the hit tests (load, transforms, triangle list, BVH), reported per triangle
+		 * \param kernelName Name the path is reported under
+		 * \param setName Name of the mesh
+		 * \param load void(TriangleMesh&) that loads the file into an empty mesh
+		 */
+		template<typename LoadFunction>
+		void MeasureLoadMesh(const std::string& kernelName, const std::string& setName, LoadFunction&& load)
+		{
+			double bestSeconds{ DBL_MAX };
+			size_t numTriangles{};
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				TriangleMesh mesh{};
+				const auto start = std::chrono::steady_clock::now();
+				load(mesh);
+				mesh.UpdateTransforms();
+				mesh.FillTriangleList();
+				mesh.BuildBVH();
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+				numTriangles = mesh.triangles.size();
+				m_Sink += mesh.GetBVHNodes()[mesh.rootNodeIdx].aabbMax.x;
+			}
+
+			const double numTests{ double(numTriangles) };
+			m_Results.push_back({ kernelName, setName, numTriangles, bestSeconds * 1e9 / numTests, numTests / bestSeconds, 0.0 });
+		}
+
+		/**
+		 * \brief Times MeshCleanup::Clean on a triangle soup, reported per input triangle
+		 * \param kernelName Name the cleanup is reported under
+		 * \param setName Name of the soup
+		 * \param positions Positions of the soup (see CreateTriangleSoup)
+		 * \param indices Indices of the soup
+		 * \param options Cleanup options of the variant
+		 */
+		void MeasureMeshCleanup(const std::string& kernelName, const std::string& setName, const std::vector<Vector3>& positions, const std::vector<int>& indices,
+			const MeshCleanup::Options& options)
+		{
+			double bestSeconds{ DBL_MAX };
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				std::vector<Vector3> cleanPositions{ positions };
+				std::vector<int> cleanIndices{ indices };
+				const auto start = std::chrono::steady_clock::now();
+				MeshCleanup::Clean(cleanPositions, cleanIndices, options);
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+				m_Sink += float(cleanIndices.size());
+			}
+
+			const size_t numTriangles{ indices.size() / 3 };
+			const double numTests{ double(numTriangles) };
+			m_Results.push_back({ kernelName, setName, numTriangles, bestSeconds * 1e9 / numTests, numTests / bestSeconds, 0.0 });
+		}
+
+		/**
+		 * \brief Times adding instances of a mesh and building their top level BVH, reported per instance
+		 * \param kernelName Name the build is reported under
+		 * \param setName Name of the placements
+		 * \param mesh Mesh every instance places
+		 * \param transforms Object to world transform of every instance
+		 */
+		void MeasureBuildInstances(const std::string& kernelName, const std::string& setName, const TriangleMesh& mesh, const std::vector<Matrix>& transforms)
+		{
+			double bestSeconds{ DBL_MAX };
+			for (int repetition{}; repetition < m_NumRepetitions; ++repetition)
+			{
+				InstanceBVH instanceBVH{};
+				const auto start = std::chrono::steady_clock::now();
+				for (const Matrix& transform : transforms)
+					instanceBVH.AddInstance(0, mesh, transform);
+				instanceBVH.Build();
+				const auto end = std::chrono::steady_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(end - start).count());
+				m_Sink += instanceBVH.bvhNodePool[instanceBVH.rootNodeIdx].aabbMax.x;
+			}
+
+			const double numTests{ double(transforms.size()) };
+			m_Results.push_back({ kernelName, setName, transforms.size(), bestSeconds * 1e9 / numTests, numTests / bestSeconds, 0.0 });
+		}
+
+		/**
+		 * \brief Cleans the triangle soup of a mesh and the mesh itself, the soup has to come out with the same triangles (corner positions
+		 * in the same order) and as many positions, the copies and the degenerate triangles it adds are gone then
+		 * \param variantName Name of the variant under test
+		 * \param mesh Mesh the soup is made of
+		 * \param options Cleanup options of the variant
+		 */
+		void ValidateMeshCleanup(const std::string& variantName, const TriangleMesh& mesh, const MeshCleanup::Options& options)
+		{
+			std::vector<Vector3> referencePositions{ mesh.GetPositions().begin(), mesh.GetPositions().end() };
+			std::vector<int> referenceIndices{ mesh.GetIndices().begin(), mesh.GetIndices().end() };
+			MeshCleanup::Clean(referencePositions, referenceIndices, options);
+
+			std::vector<Vector3> soupPositions{};
+			std::vector<int> soupIndices{};
+			CreateTriangleSoup(mesh.GetPositions(), mesh.GetIndices(), soupPositions, soupIndices);
+			MeshCleanup::Clean(soupPositions, soupIndices, options);
+
+			size_t numMismatches{ referencePositions.size() != soupPositions.size() ? 1u : 0u };
+			numMismatches += std::max(referenceIndices.size(), soupIndices.size()) - std::min(referenceIndices.size(), soupIndices.size());
+			for (size_t index{}; index < std::min(referenceIndices.size(), soupIndices.size()); ++index)
+			{
+				const Vector3& referencePosition{ referencePositions[referenceIndices[index]] };
+				const Vector3& soupPosition{ soupPositions[soupIndices[index]] };
+				numMismatches += referencePosition.x != soupPosition.x || referencePosition.y != soupPosition.y || referencePosition.z != soupPosition.z;
+			}
+
+			m_Validations.push_back({ "MeshCleanup::Clean mesh", variantName, "triangle soup", referenceIndices.size(), numMismatches });
+		}
+
+		/**
+		 * \brief Parses the text in chunks on several threads and counts every array element and group that differs from the serial parse
+		 * \param variantName Name of the variant under test
+		 * \param text OBJ text, large enough to be split numThreads ways
+		 * \param numThreads Threads (and chunks) of the variant
+		 */
+		void ValidateParseOBJ(const std::string& variantName, const std::string& text, unsigned int numThreads)
+		{
+			OBJData reference{};
+			OBJData variant{};
+			const bool referenceParsed{ OBJLoader::Parse(text, reference, nullptr, 1) };
+			const bool variantParsed{ OBJLoader::Parse(text, variant, nullptr, numThreads) };
+
+			const auto countMismatches = [](const auto& referenceArray, const auto& variantArray, auto&& isEqual)
+				{
+					size_t numMismatches{ std::max(referenceArray.size(), variantArray.size()) - std::min(referenceArray.size(), variantArray.size()) };
+					for (size_t idx{}; idx < std::min(referenceArray.size(), variantArray.size()); ++idx)
+						numMismatches += !isEqual(referenceArray[idx], variantArray[idx]);
+					return numMismatches;
+				};
+			const auto isSameVector = [](const Vector3& a, const Vector3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; };
+
+			size_t numMismatches{ referenceParsed && variantParsed ? 0u : 1u };
+			numMismatches += countMismatches(reference.positions, variant.positions, isSameVector);
+			numMismatches += countMismatches(reference.normals, variant.normals, isSameVector);
+			numMismatches += countMismatches(reference.texCoords, variant.texCoords,
+				[](const OBJTexCoord& a, const OBJTexCoord& b) { return a.u == b.u && a.v == b.v; });
+			numMismatches += countMismatches(reference.vertices, variant.vertices,
+				[](const OBJVertex& a, const OBJVertex& b) { return a.position == b.position && a.texCoord == b.texCoord && a.normal == b.normal; });
+			numMismatches += countMismatches(reference.groups, variant.groups, [](const OBJGroup& a, const OBJGroup& b)
+				{
+					return a.objectName == b.objectName && a.groupName == b.groupName && a.firstTriangle == b.firstTriangle && a.numTriangles == b.numTriangles;
+				});
+
+			const size_t numElements{ reference.positions.size() + reference.normals.size() + reference.texCoords.size() + reference.vertices.size() + reference.groups.size() };
+			m_Validations.push_back({ "OBJLoader::Parse serial", variantName, "generated obj", numElements, numMismatches });
+		}
+
+		/**
+		 * \brief Saves the mesh and loads it back, the load has to refuse the file
+		 * \param variantName What is wrong with the mesh
+		 * \param mesh Mesh that MeshFile::Save writes but MeshFile::Load must reject
+		 */
+		void ValidateMeshFileRejected(const std::string& variantName, const TriangleMesh& mesh)
+		{
+			const std::string filename{ "kernel_benchmark_rejected.mesh" };
+			TriangleMesh loadedMesh{};
+			const bool isRejected{ MeshFile::Save(filename, mesh) && !MeshFile::Load(filename, loadedMesh) };
+			std::remove(filename.c_str());
+
+			m_Validations.push_back({ "MeshFile::Load rejects", variantName, "mesh file", 1, isRejected ? 0u : 1u });
+		}
+
+		/**
+		 * \brief Runs a framebuffer conversion variant against ColorRGB::MaxToOne + the 8 bit casts and counts every pixel that differs
+		 * \param kernelName Name of the reference
+		 * \param variantName Name of the variant under test
+		 * \param samples Colors to convert
+		 * \param convertColors KernelTable::convertColors of the variant
+		 */
+		void ValidateConvertColors(const std::string& kernelName, const std::string& variantName, const ColorSamples& samples, decltype(KernelTable::convertColors) convertColors)
+		{
+			const PixelFormat format{ 16, 8, 0, 0xFF000000 };
+			std::vector<uint32_t> pixels(samples.GetSize());
+			convertColors(samples.red.data(), samples.green.data(), samples.blue.data(), pixels.data(), samples.GetSize(), format);
+
+			size_t numMismatches{};
+			for (size_t idx{}; idx < samples.GetSize(); ++idx)
+			{
+				ColorRGB color{ samples.red[idx], samples.green[idx], samples.blue[idx] };
+				color.MaxToOne();
+				const uint32_t expected{ format.Pack(static_cast<uint8_t>(color.r * 255), static_cast<uint8_t>(color.g * 255), static_cast<uint8_t>(color.b * 255)) };
+				if (pixels[idx] != expected)
+					++numMismatches;
+			}
+
+			m_Validations.push_back({ kernelName, variantName, "colors", samples.GetSize(), numMismatches });
+		}
+
+		/**
+		 * \brief Runs an 8-wide BRDF against its scalar reference and counts every sample where a channel is off by more than the tolerance
+		 * \param kernelName Name of the reference kernel
+		 * \param variantName Name of the variant under test
+		 * \param samples Shading inputs
+		 * \param reference ColorRGB(n, l, v) scalar implementation
+		 * \param variant ColorRGBx8(n, l, v) 8-wide implementation
+		 * \param tolerance Allowed relative difference (absolute below 1)
+		 */
+		template<typename Reference, typename Variant>
+		void ValidateBRDF(const std::string& kernelName, const std::string& variantName, const BRDFSamples& samples,
+			Reference&& reference, Variant&& variant, float tolerance)
+		{
+			size_t numMismatches{};
+			for (size_t first{}; first < samples.GetSize(); first += Float8::width)
+			{
+				float red[Float8::width], green[Float8::width], blue[Float8::width];
+				variant(samples.GetNormals(first), samples.GetLights(first), samples.GetViews(first)).Store(red, green, blue);
+
+				for (size_t lane{}; lane < Float8::width; ++lane)
+				{
+					const size_t idx{ first + lane };
+					const ColorRGB expected{ reference(samples.GetNormal(idx), samples.GetLight(idx), samples.GetView(idx)) };
+
+					const auto isOff = [=](float expectedValue, float value) { return !(fabsf(value - expectedValue) <= tolerance * std::max(1.f, fabsf(expectedValue))); };
+					if (isOff(expected.r, red[lane]) || isOff(expected.g, green[lane]) || isOff(expected.b, blue[lane]))
+						++numMismatches;
+				}
+			}
+
+			m_Validations.push_back({ kernelName, variantName, "brdf samples", samples.GetSize(), numMismatches });
+		}
+
+		/**
+		 * \brief Measures the error of a float kernel against a double precision reference and counts every input outside the tolerance
+		 * \param kernelName Name of the kernel under test
+		 * \param referenceName Name of the reference it is compared with
+		 * \param inputSetName Name of the inputs in the report
+		 * \param inputs Kernel inputs
+		 * \param error double(const Input&) error of the kernel for one input, NaN counts as outside the tolerance
+		 * \param tolerance Largest allowed error
+		 */
+		template<typename Input, typename Error>
+		void ValidateAccuracy(const std::string& kernelName, const std::string& referenceName, const std::string& inputSetName,
+			const std::vector<Input>& inputs, Error&& error, double tolerance)
+		{
+			size_t numMismatches{};
+			double maxError{};
+			for (const Input& input : inputs)
+			{
+				const double inputError{ error(input) };
+				if (!(inputError <= tolerance))
+					++numMismatches;
+				maxError = std::isnan(inputError) ? INFINITY : std::max(maxError, inputError);
+			}
+
+			m_Validations.push_back({ kernelName, referenceName, inputSetName, inputs.size(), numMismatches, maxError });
+		}
+
+		/**
+		 * \brief Runs a variant against its reference kernel and counts every ray they disagree on
+		 * \param kernelName Name of the reference kernel
+		 * \param variantName Name of the variant under test
+		 * \param raySet Rays to test
+		 * \param reference bool(const Ray&, HitRecord&) reference implementation
+		 * \param variant bool(const Ray&, HitRecord&) implementation that has to match the reference
+		 * \param compareT False for any-hit variants that only report hit/miss
+		 * \param tolerance Allowed relative difference on t
+		 */
+		template<typename Reference, typename Variant>
+		void Validate(const std::string& kernelName, const std::string& variantName, const RaySet& raySet,
+			Reference&& reference, Variant&& variant, bool compareT = true, float tolerance = 1e-5f)
+		{
+			size_t numMismatches{};
+			for (const Ray& ray : raySet.rays)
+			{
+				HitRecord referenceHit{};
+				HitRecord variantHit{};
+				const bool referenceDidHit{ reference(ray, referenceHit) };
+				const bool variantDidHit{ variant(ray, variantHit) };
+
+				if (referenceDidHit != variantDidHit)
+				{
+					++numMismatches;
+				}
+				else if (compareT && referenceDidHit
+					&& fabsf(referenceHit.t - variantHit.t) > tolerance * std::max(1.f, fabsf(referenceHit.t)))
+				{
+					++numMismatches;
+				}
+			}
+
+			m_Validations.push_back({ kernelName, variantName, raySet.name, raySet.rays.size(), numMismatches });
+		}
+
+		/**
+		 * \brief Runs a packet variant against its single ray reference kernel and counts every lane they disagree on
+		 * \param kernelName Name of the reference kernel
+		 * \param variantName Name of the variant under test
+		 * \param raySet Rays the packets were made from
+		 * \param packets Packets of the set (see GeneratePackets)
+		 * \param reference bool(const Ray&, HitRecord&) reference implementation
+		 * \param variant void(const Packet&, HitRecord*) implementation that has to match the reference
+		 * \param compareT False for any-hit variants that only report hit/miss
+		 * \param tolerance Allowed relative difference on t
+		 */
+		template<typename Packet, typename Reference, typename Variant>
+		void ValidatePackets(const std::string& kernelName, const std::string& variantName, const RaySet& raySet, const std::vector<Packet>& packets,
+			Reference&& reference, Variant&& variant, bool compareT = true, float tolerance = 1e-5f)
+		{
+			size_t numMismatches{};
+			size_t numRays{};
+			for (const Packet& packet : packets)
+			{
+				HitRecord variantHits[RayPacket::size]{};
+				variant(packet, variantHits);
+
+				for (int lane{}; lane < RayPacket::size; ++lane)
+				{
+					if (!packet.isActive[lane]) continue;
+					++numRays;
+
+					HitRecord referenceHit{};
+					const bool referenceDidHit{ reference(packet.GetRay(lane), referenceHit) };
+					const HitRecord& variantHit{ variantHits[lane] };
+
+					if (referenceDidHit != variantHit.didHit
+						|| (compareT && referenceDidHit && fabsf(referenceHit.t - variantHit.t) > tolerance * std::max(1.f, fabsf(referenceHit.t))))
+					{
+						++numMismatches;
+					}
+				}
+			}
+
+			m_Validations.push_back({ kernelName, variantName, raySet.name, numRays, numMismatches });
+		}
+
+		//Returns true when every variant matched its reference
+		bool PrintReport(std::ostream& stream) const
+		{
+			//Name columns as wide as their longest entry, names like "HitTest_BVH quantized x8x8 SSE4.2" outgrew a fixed width
+			int kernelWidth{ 32 };
+			int raySetWidth{ 20 };
+			for (const auto& result : m_Results)
+			{
+				kernelWidth = std::max(kernelWidth, int(result.kernelName.size()) + 1);
+				raySetWidth = std::max(raySetWidth, int(result.raySetName.size()) + 1);
+			}
+
+			stream << std::left << std::setw(kernelWidth) << "KERNEL" << std::setw(raySetWidth) << "RAYS" << std::right
+				<< std::setw(10) << "COUNT" << std::setw(12) << "NS/TEST" << std::setw(16) << "TESTS/SEC" << std::setw(10) << "HIT%" << '\n';
+
+			for (const auto& result : m_Results)
+			{
+				stream << std::left << std::setw(kernelWidth) << result.kernelName << std::setw(raySetWidth) << result.raySetName << std::right
+					<< std::setw(10) << result.numRays
+					<< std::setw(12) << std::fixed << std::setprecision(2) << result.nsPerTest
+					<< std::setw(16) << std::setprecision(0) << result.testsPerSecond
+					<< std::setw(10) << std::setprecision(1) << result.hitRate * 100.0 << '\n';
+			}
+
+			bool allMatched{ true };
+			stream << "\nVALIDATION\n";
+			for (const auto& validation : m_Validations)
+			{
+				stream << ">> " << validation.kernelName << " vs " << validation.variantName << " (" << validation.raySetName << "): ";
+				if (validation.numMismatches == 0)
+				{
+					stream << "OK";
+				}
+				else
+				{
+					stream << validation.numMismatches << '/' << validation.numRays << " MISMATCHES";
+					allMatched = false;
+				}
+				if (validation.maxError >= 0.0)
+					stream << " (max error " << std::scientific << std::setprecision(2) << validation.maxError << std::defaultfloat << ')';
+				stream << '\n';
+			}
+			stream << std::defaultfloat;
+			return allMatched;
+		}
+
+	private:
+		struct Result
+		{
+			std::string kernelName;
+			std::string raySetName;
+			size_t numRays;
+			double nsPerTest;
+			double testsPerSecond;
+			double hitRate;
+		};
+
+		struct Validation
+		{
+			std::string kernelName;
+			std::string variantName;
+			std::string raySetName;
+			size_t numRays;
+			size_t numMismatches;
+			//Only set by ValidateAccuracy
+			double maxError{ -1.0 };
+		};
+
+		int m_NumRepetitions{ 5 };
+		float m_Sink{};
+		std::vector<Result> m_Results{};
+		std::vector<Validation> m_Validations{};
+	};
+}
+
+//Procedural fallback when the bunny can't be found next to the executable
+static void CreateSphereMesh(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+{
+	const int numRings{ 32 };
+	const int numSegments{ 64 };
+
+	for (int ring{}; ring <= numRings; ++ring)
+	{
+		const float theta{ PI * float(ring) / float(numRings) };
+		for (int segment{}; segment <= numSegments; ++segment)
+		{
+			const float phi{ PI_2 * float(segment) / float(numSegments) };
+			positions.push_back({ sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi) });
+		}
+	}
+
+	for (int ring{}; ring < numRings; ++ring)
+	{
+		for (int segment{}; segment < numSegments; ++segment)
+		{
+			const int i0{ ring * (numSegments + 1) + segment };
+			const int i1{ i0 + numSegments + 1 };
+
+			indices.insert(indices.end(), { i0, i1, i0 + 1 });
+			indices.insert(indices.end(), { i0 + 1, i1, i1 + 1 });
+		}
+	}
+
+	for (size_t i{}; i < indices.size(); i += 3)
+	{
+		const Vector3 edgeV0V1{ positions[indices[i + 1]] - positions[indices[i]] };
+		const Vector3 edgeV0V2{ positions[indices[i + 2]] - positions[indices[i]] };
+		const Vector3 normal{ Vector3::Cross(edgeV0V1, edgeV0V2) };
+		normals.push_back(normal.SqrMagnitude() > 0.f ? normal.Normalized() : Vector3::UnitY);
+	}
+}
+
+//Back, bottom, top, right and left walls of the W4 scenes
+static void AddRoomPlanes(SceneGeometry& scene)
+{
+	const std::pair<Vector3, Vector3> walls[]{
+		{ { 0.f, 0.f, 10.f }, { 0.f, 0.f, -1.f } },
+		{ { 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } },
+		{ { 0.f, 10.f, 0.f }, { 0.f, -1.f, 0.f } },
+		{ { 5.f, 0.f, 0.f }, { -1.f, 0.f, 0.f } },
+		{ { -5.f, 0.f, 0.f }, { 1.f, 0.f, 0.f } } };
+
+	for (const auto& [origin, normal] : walls)
+	{
+		Plane plane{};
+		plane.origin = origin;
+		plane.normal = normal;
+		scene.planes.push_back(plane);
+	}
+}
+
+//Scene_W4_BunnyScene, the bunny comes in already parsed
+static SceneGeometry CreateBunnyScene(const TriangleMesh& bunny)
+{
+	SceneGeometry scene{ "bunny", { 0.f, 3.f, -9.f }, 45.f };
+	AddRoomPlanes(scene);
+
+	TriangleMesh& mesh{ scene.meshes.emplace_back() };
+	mesh.positions = bunny.positions;
+	mesh.normals = bunny.normals;
+	mesh.indices = bunny.indices;
+	mesh.cullMode = TriangleCullMode::BackFaceCulling;
+	mesh.Scale({ 2.f, 2.f, 2.f });
+	//The other way around than Scene_W4_BunnyScene, the transformed AABB is only right after its Update
+	mesh.UpdateAABB();
+	mesh.UpdateTransforms();
+	mesh.FillTriangleList();
+	mesh.BuildBVH();
+	return scene;
+}
+
+//Scene_W4_ReferenceScene: six spheres and a triangle in every cull mode
+static SceneGeometry CreateReferenceScene()
+{
+	SceneGeometry scene{ "reference", { 0.f, 3.f, -9.f }, 45.f };
+	AddRoomPlanes(scene);
+
+	for (const float y : { 1.f, 3.f })
+	{
+		for (const float x : { -1.75f, 0.f, 1.75f })
+		{
+			Sphere sphere{};
+			sphere.origin = { x, y, 0.f };
+			sphere.radius = .75f;
+			scene.spheres.push_back(sphere);
+		}
+	}
+
+	const Triangle baseTriangle{ Vector3{ -.75f, 1.5f, 0.f }, Vector3{ .75f, 0.f, 0.f }, Vector3{ -.75f, 0.f, 0.f } };
+	const std::pair<float, TriangleCullMode> triangles[]{
+		{ -1.75f, TriangleCullMode::BackFaceCulling },
+		{ 0.f, TriangleCullMode::FrontFaceCulling },
+		{ 1.75f, TriangleCullMode::NoCulling } };
+
+	//Every mesh is in place before the BVHs get built
+	scene.meshes.resize(std::size(triangles));
+	for (size_t meshIdx{}; meshIdx < std::size(triangles); ++meshIdx)
+	{
+		TriangleMesh& mesh{ scene.meshes[meshIdx] };
+		mesh.cullMode = triangles[meshIdx].second;
+		mesh.AppendTriangle(baseTriangle, true);
+		mesh.Translate({ triangles[meshIdx].first, 4.5f, 0.f });
+		mesh.UpdateAABB();
+		mesh.UpdateTransforms();
+		mesh.FillTriangleList();
+		mesh.BuildBVH();
+	}
+	return scene;
+}
+
+int main(int argc, char* args[])
+{
+	//[numRays] [--isa=<name>], the packet, shading and framebuffer kernels run in every variant the CPU supports unless --isa picks one
+	//--convert=<file.obj> only writes <file>.mesh with a prebuilt BVH (see MeshFile.h)
+	size_t numRays{ size_t(1 << 18) };
+	std::vector<InstructionSet> instructionSets{};
+	constexpr std::string_view isaOption{ "--isa=" };
+	constexpr std::string_view convertOption{ "--convert=" };
+	for (int argIdx{ 1 }; argIdx < argc; ++argIdx)
+	{
+		const std::string_view arg{ args[argIdx] };
+		if (arg.starts_with(convertOption))
+		{
+			const std::string objFilename{ arg.substr(convertOption.size()) };
+			const std::string meshFilename{ objFilename.substr(0, objFilename.rfind('.')) + ".mesh" };
+			if (!MeshFile::ConvertOBJ(objFilename, meshFilename))
+			{
+				std::cout << "Converting " << objFilename << " failed\n";
+				return 1;
+			}
+			std::cout << "Wrote " << meshFilename << '\n';
+			return 0;
+		}
+		if (!arg.starts_with(isaOption))
+		{
+			numRays = size_t(std::stoul(args[argIdx]));
+			continue;
+		}
+
+		InstructionSet instructionSet{};
+		if (!CPUFeatures::ParseInstructionSet(arg.substr(isaOption.size()), instructionSet) || !Kernels::SelectInstructionSet(instructionSet))
+		{
+			std::cout << "Unknown or unsupported instruction set: " << arg << '\n';
+			return 1;
+		}
+		instructionSets = { instructionSet };
+	}
+	if (instructionSets.empty())
+	{
+		//Builds without SSE only have the baseline variants
+		for (const InstructionSet instructionSet : { InstructionSet::Baseline, InstructionSet::SSE42, InstructionSet::AVX2, InstructionSet::AVX512 })
+		{
+			if (CPUFeatures::IsSupported(instructionSet) && Kernels::GetTable(instructionSet).instructionSet == instructionSet)
+				instructionSets.push_back(instructionSet);
+		}
+	}
+	const uint32_t seed{ 1337 };
+
+	//--------- Geometry ---------
+	TriangleMesh mesh{};
+	mesh.cullMode = TriangleCullMode::NoCulling;
+	if (!Utils::ParseOBJ("Resources/lowpoly_bunny2.obj", mesh.positions, mesh.normals, mesh.indices))
+	{
+		std::cout << "(Resources/lowpoly_bunny2.obj not found, using a procedural sphere mesh)\n";
+		CreateSphereMesh(mesh.positions, mesh.normals, mesh.indices);
+	}
+	mesh.UpdateAABB();
+	mesh.UpdateTransforms();
+	mesh.FillTriangleList();
+	mesh.BuildBVH();
+
+	//Static copy with 16 bit positions and octahedral normals, the hit tests decode its triangles
+	TriangleMesh quantizedMesh{};
+	quantizedMesh.cullMode = TriangleCullMode::NoCulling;
+	quantizedMesh.positions = mesh.positions;
+	quantizedMesh.normals = mesh.normals;
+	quantizedMesh.indices = mesh.indices;
+	quantizedMesh.UpdateAABB();
+	quantizedMesh.UpdateTransforms();
+	quantizedMesh.FillTriangleList();
+	quantizedMesh.BuildBVH();
+	quantizedMesh.Quantize();
+
+	const BVHNode& root{ mesh.GetBVHNodes()[mesh.rootNodeIdx] };
+	const Vector3 boundsMin{ root.aabbMin };
+	const Vector3 boundsMax{ root.aabbMax };
+	const Vector3 center{ (boundsMin + boundsMax) * 0.5f };
+	const Vector3 extent{ boundsMax - boundsMin };
+	const float radius{ std::max(extent.x, std::max(extent.y, extent.z)) * 0.5f };
+
+	Sphere sphere{};
+	sphere.origin = center;
+	sphere.radius = radius;
+
+	Plane plane{};
+	plane.origin = center;
+	plane.normal = Vector3{ 0.f, 1.f, -1.f }.Normalized();
+
+	//A grid of shrunk and turned copies of the mesh filling its bounds: instances of the mesh under a top level BVH,
+	//and the same copies as transformed meshes of their own
+	constexpr int numInstancesPerAxis{ 8 };
+	std::vector<Matrix> instanceTransforms{};
+	{
+		std::mt19937 generator{ seed };
+		std::uniform_real_distribution<float> yawDistribution{ 0.f, PI_2 };
+		const float scale{ 1.f / numInstancesPerAxis };
+		for (int z{}; z < numInstancesPerAxis; ++z)
+		{
+			for (int y{}; y < numInstancesPerAxis; ++y)
+			{
+				for (int x{}; x < numInstancesPerAxis; ++x)
+				{
+					const Vector3 cellCenter{ boundsMin + Vector3{ extent.x * (x + .5f), extent.y * (y + .5f), extent.z * (z + .5f) } * scale };
+					const Matrix scaleTransform{ Matrix::CreateScale(scale, scale, scale) };
+					const Matrix rotationTransform{ Matrix::CreateRotationY(yawDistribution(generator)) };
+					const Matrix translationTransform{ Matrix::CreateTranslation(cellCenter - rotationTransform.TransformVector(center * scale)) };
+					instanceTransforms.push_back(scaleTransform * rotationTransform * translationTransform);
+				}
+			}
+		}
+	}
+	InstanceBVH instanceBVH{};
+	std::vector<TriangleMesh> flattenedMeshes(instanceTransforms.size());
+	for (size_t instanceIdx{}; instanceIdx < instanceTransforms.size(); ++instanceIdx)
+	{
+		instanceBVH.AddInstance(0, mesh, instanceTransforms[instanceIdx]);
+
+		TriangleMesh& flattenedMesh{ flattenedMeshes[instanceIdx] };
+		flattenedMesh.cullMode = TriangleCullMode::NoCulling;
+		flattenedMesh.positions = mesh.positions;
+		flattenedMesh.normals = mesh.normals;
+		flattenedMesh.indices = mesh.indices;
+		flattenedMesh.scaleTransform = instanceTransforms[instanceIdx];
+		flattenedMesh.UpdateAABB();
+		flattenedMesh.UpdateTransforms();
+		flattenedMesh.FillTriangleList();
+		flattenedMesh.BuildBVH();
+	}
+	instanceBVH.Build();
+
+	Triangle triangle{ center + Vector3{ -radius, -radius, 0.f }, center + Vector3{ 0.f, radius, 0.f }, center + Vector3{ radius, -radius, 0.f } };
+	triangle.cullMode = TriangleCullMode::NoCulling;
+
+	//--------- Kernels ---------
+	const auto sphereKernel = [&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Sphere(sphere, ray, hitRecord); };
+	const auto planeKernel = [&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Plane(plane, ray, hitRecord); };
+	const auto triangleKernel = [&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Triangle(triangle, ray, hitRecord); };
+	const auto slabKernel = [&](const Ray& ray, HitRecord&) { return GeometryUtils::SlabTest_BVH(ray, boundsMin, boundsMax); };
+	const auto bvhKernel = [&](const Ray& ray, HitRecord& hitRecord)
+		{
+			HitRecord temp{};
+			hitRecord = {};
+			return GeometryUtils::HitTest_BVH(mesh, ray, mesh.rootNodeIdx, temp, hitRecord);
+		};
+
+	const auto quantizedBVHKernel = [&](const Ray& ray, HitRecord& hitRecord)
+		{
+			HitRecord temp{};
+			hitRecord = {};
+			return GeometryUtils::HitTest_BVH(quantizedMesh, ray, quantizedMesh.rootNodeIdx, temp, hitRecord);
+		};
+
+	const auto instancesKernel = [&](const Ray& ray, HitRecord& hitRecord)
+		{
+			hitRecord = {};
+			return GeometryUtils::HitTest_Instances(instanceBVH, std::span<TriangleMesh>{ &mesh, 1 }, ray, hitRecord);
+		};
+
+	//Reference for the BVH: every triangle of the mesh, no acceleration structure
+	const auto bruteForceKernel = [&](const Ray& ray, HitRecord& hitRecord)
+		{
+			HitRecord temp{};
+			for (const Triangle& meshTriangle : mesh.triangles)
+			{
+				if (GeometryUtils::HitTest_Triangle(meshTriangle, ray, temp) && temp.t < hitRecord.t)
+					hitRecord = temp;
+			}
+			return hitRecord.didHit;
+		};
+	const auto quantizedBruteForceKernel = [&](const Ray& ray, HitRecord& hitRecord)
+		{
+			HitRecord temp{};
+			Triangle decoded{};
+			for (int triangleIdx{}; triangleIdx < int(quantizedMesh.GetNumTriangles()); ++triangleIdx)
+			{
+				if (GeometryUtils::HitTest_Triangle(quantizedMesh.GetTriangle(triangleIdx, decoded), ray, temp) && temp.t < hitRecord.t)
+					hitRecord = temp;
+			}
+			return hitRecord.didHit;
+		};
+
+	//Packet kernels of one instruction set (see Kernels.h), only lanes closer than closestT take a hit
+	const auto makeSpherePacketKernel = [&](const KernelTable& kernels)
+		{
+			return [&, kernels](const RayPacket& packet, HitRecord* pHitRecords)
+				{
+					float closestT[RayPacket::size];
+					for (int lane{}; lane < RayPacket::size; ++lane)
+						closestT[lane] = packet.isActive[lane] ? FLT_MAX : -FLT_MAX;
+					kernels.hitTestSphere(sphere, packet, closestT, pHitRecords);
+				};
+		};
+	const auto makePlanePacketKernel = [&](const KernelTable& kernels)
+		{
+			return [&, kernels](const RayPacket& packet, HitRecord* pHitRecords)
+				{
+					float closestT[RayPacket::size];
+					for (int lane{}; lane < RayPacket::size; ++lane)
+						closestT[lane] = packet.isActive[lane] ? FLT_MAX : -FLT_MAX;
+					kernels.hitTestPlane(plane, packet, closestT, pHitRecords);
+				};
+		};
+	const auto makeBVHPacketKernel = [&](const KernelTable& kernels)
+		{
+			return [&, kernels](const RayPacket& packet, HitRecord* pHitRecords) { kernels.hitTestTriangleMesh(mesh, packet, pHitRecords); };
+		};
+	const auto makeQuantizedBVHPacketKernel = [&](const KernelTable& kernels)
+		{
+			return [&, kernels](const RayPacket& packet, HitRecord* pHitRecords) { kernels.hitTestTriangleMesh(quantizedMesh, packet, pHitRecords); };
+		};
+
+	//Shadow packet kernels only report occlusion, written to didHit
+	const auto makeShadowPacketKernel = [](auto&& shadowKernel)
+		{
+			return [=](const ShadowRayPacket& packet, HitRecord* pHitRecords)
+				{
+					bool isOccluded[ShadowRayPacket::size]{};
+					shadowKernel(packet, isOccluded);
+					for (int lane{}; lane < ShadowRayPacket::size; ++lane)
+						pHitRecords[lane].didHit = isOccluded[lane];
+				};
+		};
+	const auto makeSphereShadowKernel = [&](const KernelTable& kernels)
+		{
+			return makeShadowPacketKernel([&, kernels](const ShadowRayPacket& packet, bool* pIsOccluded) { kernels.occlusionTestSphere(sphere, packet, pIsOccluded); });
+		};
+	const auto makePlaneShadowKernel = [&](const KernelTable& kernels)
+		{
+			return makeShadowPacketKernel([&, kernels](const ShadowRayPacket& packet, bool* pIsOccluded) { kernels.occlusionTestPlane(plane, packet, pIsOccluded); });
+		};
+	const auto makeBVHShadowKernel = [&](const KernelTable& kernels)
+		{
+			return makeShadowPacketKernel([&, kernels](const ShadowRayPacket& packet, bool* pIsOccluded) { kernels.occlusionTestTriangleMesh(mesh, packet, pIsOccluded); });
+		};
+
+	//Whole scenes: Scene::GetClosestHit against the packet path of Scene::GetClosestHits
+	const auto makeSceneKernel = [](SceneGeometry& scene)
+		{
+			return [&scene](const Ray& ray, HitRecord& closestHit)
+				{
+					HitRecord temp{};
+					closestHit = {};
+					for (TriangleMesh& sceneMesh : scene.meshes)
+					{
+						if (GeometryUtils::HitTest_TriangleMesh(sceneMesh, ray, temp, false) && closestHit.t > temp.t)
+							closestHit = temp;
+					}
+					for (const Plane& scenePlane : scene.planes)
+					{
+						if (GeometryUtils::HitTest_Plane(scenePlane, ray, temp) && closestHit.t > temp.t)
+							closestHit = temp;
+					}
+					for (const Sphere& sceneSphere : scene.spheres)
+					{
+						if (GeometryUtils::HitTest_Sphere(sceneSphere, ray, temp) && closestHit.t > temp.t)
+							closestHit = temp;
+					}
+					return closestHit.didHit;
+				};
+		};
+	const auto makeScenePacketKernel = [](SceneGeometry& scene, const KernelTable& kernels)
+		{
+			return [&scene, kernels](const RayPacket& packet, HitRecord* pHitRecords)
+				{
+					for (TriangleMesh& sceneMesh : scene.meshes)
+						kernels.hitTestTriangleMesh(sceneMesh, packet, pHitRecords);
+
+					float closestT[RayPacket::size];
+					for (int lane{}; lane < RayPacket::size; ++lane)
+						closestT[lane] = packet.isActive[lane] ? pHitRecords[lane].t : -FLT_MAX;
+					for (const Plane& scenePlane : scene.planes)
+						kernels.hitTestPlane(scenePlane, packet, closestT, pHitRecords);
+					for (const Sphere& sceneSphere : scene.spheres)
+						kernels.hitTestSphere(sceneSphere, packet, closestT, pHitRecords);
+				};
+		};
+
+	//Reported as "<kernel> <instruction set>"
+	const auto getVariantName = [](const std::string& kernelName, InstructionSet instructionSet) { return kernelName + ' ' + CPUFeatures::GetName(instructionSet); };
+
+	//--------- Rays ---------
+	//The mesh doubles as a mirror for the reflected set: secondary rays with scattered origins and directions
+	const RaySet coherentRays{ KernelBenchmark::GenerateCoherentRays(numRays, center - Vector3{ 0.f, 0.f, 3.f * radius }, center, 45.f) };
+	const RaySet incoherentRays{ KernelBenchmark::GenerateIncoherentRays(numRays, center - extent, center + extent, seed) };
+	const RaySet reflectedRays{ KernelBenchmark::GenerateReflectedRays(coherentRays, bvhKernel) };
+
+	const std::vector<RaySet> raySets{
+		coherentRays,
+		incoherentRays,
+		KernelBenchmark::GenerateSortedRays(incoherentRays),
+		reflectedRays,
+		KernelBenchmark::GenerateSortedRays(reflectedRays) };
+
+	//Primary rays of the renderer's default resolution, the image the packet widths get compared on
+	std::vector<SceneGeometry> scenes{};
+	scenes.push_back(CreateBunnyScene(mesh));
+	scenes.push_back(CreateReferenceScene());
+	std::vector<RaySet> sceneRaySets{};
+	for (const SceneGeometry& scene : scenes)
+		sceneRaySets.push_back(KernelBenchmark::GeneratePrimaryRays(scene, 640, 480));
+
+	//--------- Measurements ---------
+	KernelBenchmark benchmark{};
+	for (const RaySet& raySet : raySets)
+	{
+		benchmark.Measure("HitTest_Sphere", raySet, sphereKernel);
+		benchmark.Measure("HitTest_Plane", raySet, planeKernel);
+		benchmark.Measure("HitTest_Triangle", raySet, triangleKernel);
+		benchmark.Measure("SlabTest_BVH", raySet, slabKernel);
+		benchmark.Measure("HitTest_BVH", raySet, bvhKernel);
+		benchmark.Measure("HitTest_BVH any-hit", raySet, [&](const Ray& ray, HitRecord&) { return GeometryUtils::HitTest_TriangleMesh(mesh, ray); });
+		benchmark.Measure("HitTest_BVH quantized", raySet, quantizedBVHKernel);
+		benchmark.Measure("HitTest_Instances", raySet, instancesKernel);
+		benchmark.Measure("HitTest_Instances any-hit", raySet, [&](const Ray& ray, HitRecord&)
+			{
+				return GeometryUtils::HitTest_Instances(instanceBVH, std::span<TriangleMesh>{ &mesh, 1 }, ray);
+			});
+
+		const std::vector<ShadowRayPacket> shadowPackets{ KernelBenchmark::GenerateShadowPackets(raySet) };
+		const std::vector<RayPacket> packets{ KernelBenchmark::GeneratePackets(raySet) };
+		for (const InstructionSet instructionSet : instructionSets)
+		{
+			const KernelTable& kernels{ Kernels::GetTable(instructionSet) };
+			benchmark.MeasurePackets(getVariantName("HitTest_BVH x64 any", instructionSet), raySet, shadowPackets, makeBVHShadowKernel(kernels));
+
+			if (packets.empty())
+				continue;
+			benchmark.MeasurePackets(getVariantName("HitTest_Sphere x8x8", instructionSet), raySet, packets, makeSpherePacketKernel(kernels));
+			benchmark.MeasurePackets(getVariantName("HitTest_Plane x8x8", instructionSet), raySet, packets, makePlanePacketKernel(kernels));
+			benchmark.MeasurePackets(getVariantName("HitTest_BVH x8x8", instructionSet), raySet, packets, makeBVHPacketKernel(kernels));
+			benchmark.MeasurePackets(getVariantName("HitTest_BVH quantized x8x8", instructionSet), raySet, packets, makeQuantizedBVHPacketKernel(kernels));
+		}
+	}
+
+	for (size_t sceneIdx{}; sceneIdx < scenes.size(); ++sceneIdx)
+	{
+		SceneGeometry& scene{ scenes[sceneIdx] };
+		const RaySet& raySet{ sceneRaySets[sceneIdx] };
+		benchmark.Measure("Scene", raySet, makeSceneKernel(scene));
+
+		const std::vector<RayPacket> packets{ KernelBenchmark::GeneratePackets(raySet) };
+		for (const InstructionSet instructionSet : instructionSets)
+			benchmark.MeasurePackets(getVariantName("Scene x8x8", instructionSet), raySet, packets, makeScenePacketKernel(scene, Kernels::GetTable(instructionSet)));
+	}
+
+	//--------- BRDFs ---------
+	//Scalar BRDFs.h terms against their 8-wide BRDFsSIMD.h counterparts, with the error bound promised there
+	const BRDFSamples brdfSamples{ KernelBenchmark::GenerateBRDFSamples(numRays, seed) };
+	const auto registerBRDF = [&](const std::string& kernelName, auto&& reference, auto&& variant, float tolerance)
+		{
+			benchmark.MeasureBRDF(kernelName, brdfSamples, reference);
+			benchmark.MeasureBRDF(kernelName + " x8", brdfSamples, variant);
+			benchmark.ValidateBRDF(kernelName, "x8", brdfSamples, reference, variant, tolerance);
+		};
+
+	const float roughness{ 0.6f };
+	const ColorRGB albedo{ .972f, .960f, .915f };
+	registerBRDF("Lambert",
+		[&](const Vector3&, const Vector3&, const Vector3&) { return BRDF::Lambert(0.8f, albedo); },
+		[&](const Vector3x8&, const Vector3x8&, const Vector3x8&) { return BRDF::Lambert(Float8{ 0.8f }, albedo); }, 1e-5f);
+	//powf keeps the highlight of negative cosines with even exponents, the 8-wide version clamps them to 0
+	registerBRDF("Phong",
+		[&](const Vector3& n, const Vector3& l, const Vector3& v) { return Vector3::Dot(Vector3::Reflect(l, n), v) > 0.f ? BRDF::Phong(1.f, 60.f, l, v, n) : ColorRGB{}; },
+		[&](const Vector3x8& n, const Vector3x8& l, const Vector3x8& v) { return BRDF::Phong(1.f, 60.f, l, v, n); }, 2e-3f);
+	registerBRDF("Schlick",
+		[&](const Vector3&, const Vector3& l, const Vector3& v) { return BRDF::FresnelFunction_Schlick((l + v).Normalized(), v, albedo); },
+		[&](const Vector3x8&, const Vector3x8& l, const Vector3x8& v)
+		{
+			const Vector3x8 sum{ l + v };
+			return BRDF::FresnelFunction_Schlick(sum * (Float8{ 1.f } / Sqrt(Dot(sum, sum))), v, albedo);
+		}, 1e-5f);
+	registerBRDF("GGX",
+		[&](const Vector3& n, const Vector3& l, const Vector3& v)
+		{
+			const float d{ BRDF::NormalDistribution_GGX(n, (l + v).Normalized(), roughness) };
+			return ColorRGB{ d, d, d };
+		},
+		[&](const Vector3x8& n, const Vector3x8& l, const Vector3x8& v)
+		{
+			const Vector3x8 sum{ l + v };
+			const Float8 d{ BRDF::NormalDistribution_GGX(n, sum * (Float8{ 1.f } / Sqrt(Dot(sum, sum))), roughness) };
+			return ColorRGBx8{ d, d, d };
+		}, 1e-5f);
+	registerBRDF("Smith",
+		[&](const Vector3& n, const Vector3& l, const Vector3& v)
+		{
+			const float g{ BRDF::GeometryFunction_Smith(n, v, l, roughness) };
+			return ColorRGB{ g, g, g };
+		},
+		[&](const Vector3x8& n, const Vector3x8& l, const Vector3x8& v)
+		{
+			const Float8 g{ BRDF::GeometryFunction_Smith(n, v, l, roughness) };
+			return ColorRGBx8{ g, g, g };
+		}, 1e-5f);
+
+	//Whole materials, as the renderer shades them
+	const Material_CookTorrence metal{ albedo, 1.f, roughness };
+	const Material_CookTorrence plastic{ { .75f,.75f,.75f }, 0.f, roughness };
+	const Material_LambertPhong lambertPhong{ colors::Blue, 1.f, 1.f, 60.f };
+	const std::pair<std::string, MaterialData> materials[]{
+		{ "CookTorrence metal", metal.GetData() },
+		{ "CookTorrence", plastic.GetData() },
+		{ "LambertPhong", lambertPhong.GetData() } };
+	for (const auto& [kernelName, materialData] : materials)
+	{
+		const MaterialData material{ materialData };
+		const auto reference = [=](const Vector3& n, const Vector3& l, const Vector3& v)
+			{
+				HitRecord hitRecord{};
+				hitRecord.normal = n;
+				if (material.type == MaterialType::LambertPhong && Vector3::Dot(Vector3::Reflect(l, n), -v) <= 0.f)
+					return material.diffuse;
+				return material.Shade(hitRecord, l, v);
+			};
+		const float tolerance{ material.type == MaterialType::LambertPhong ? 2e-3f : 1e-4f };
+		registerBRDF(kernelName, reference, [=](const Vector3x8& n, const Vector3x8& l, const Vector3x8& v) { return BRDF::Shade(material, n, l, v); }, tolerance);
+
+		//The renderer's shading kernels, on the per component arrays it fills
+		for (const InstructionSet instructionSet : instructionSets)
+		{
+			const KernelTable& kernels{ Kernels::GetTable(instructionSet) };
+			const auto variant = [=](const Vector3x8& n, const Vector3x8& l, const Vector3x8& v)
+				{
+					constexpr int width{ Float8::width };
+					float normals[3 * width], lightDirections[3 * width], viewDirections[3 * width], colors[3 * width];
+					n.x.Store(normals); n.y.Store(normals + width); n.z.Store(normals + 2 * width);
+					l.x.Store(lightDirections); l.y.Store(lightDirections + width); l.z.Store(lightDirections + 2 * width);
+					v.x.Store(viewDirections); v.y.Store(viewDirections + width); v.z.Store(viewDirections + 2 * width);
+					kernels.shade(material, normals, lightDirections, viewDirections, colors);
+					return ColorRGBx8{ Float8::Load(colors), Float8::Load(colors + width), Float8::Load(colors + 2 * width) };
+				};
+			const std::string variantName{ getVariantName("x8", instructionSet) };
+			benchmark.MeasureShade(kernelName + ' ' + variantName, brdfSamples, material, kernels.shade);
+			benchmark.ValidateBRDF(kernelName, variantName, brdfSamples, reference, variant, tolerance);
+		}
+	}
+
+	//--------- Framebuffer ---------
+	const ColorSamples colorSamples{ KernelBenchmark::GenerateColorSamples(numRays, seed) };
+	for (const InstructionSet instructionSet : instructionSets)
+	{
+		const KernelTable& kernels{ Kernels::GetTable(instructionSet) };
+		benchmark.MeasureConvertColors(getVariantName("ConvertColors", instructionSet), colorSamples, kernels.convertColors);
+		benchmark.ValidateConvertColors("ColorRGB::MaxToOne", getVariantName("ConvertColors", instructionSet), colorSamples, kernels.convertColors);
+	}
+
+	//--------- Mesh loading ---------
+	//The chunked parse has to give the serial result for any number of chunks, 8 also splits the text on machines with fewer cores
+	const std::string objText{ KernelBenchmark::GenerateOBJText(numRays, seed) };
+	benchmark.MeasureParseOBJ("OBJLoader::Parse serial", objText, 1);
+	benchmark.MeasureParseOBJ("OBJLoader::Parse threads", objText, 0);
+	benchmark.ValidateParseOBJ("OBJLoader::Parse 8 chunks", objText, 8);
+
+	//The import cleanup on a soup of the generated mesh, every triangle with its own positions
+	{
+		OBJData objData{};
+		OBJLoader::Parse(objText, objData);
+		std::vector<Vector3> objPositions{ std::move(objData.positions) };
+		std::vector<int> objIndices(objData.vertices.size());
+		for (size_t index{}; index < objData.vertices.size(); ++index)
+			objIndices[index] = objData.vertices[index].position;
+
+		std::vector<Vector3> soupPositions{};
+		std::vector<int> soupIndices{};
+		KernelBenchmark::CreateTriangleSoup(objPositions, objIndices, soupPositions, soupIndices);
+		benchmark.MeasureMeshCleanup("MeshCleanup::Clean", "generated soup", soupPositions, soupIndices, {});
+		benchmark.MeasureMeshCleanup("MeshCleanup::Clean reorder", "generated soup", soupPositions, soupIndices, { .reorderForLocality = true });
+	}
+	benchmark.ValidateMeshCleanup("soup", mesh, {});
+	benchmark.ValidateMeshCleanup("soup reorder", mesh, { .reorderForLocality = true });
+
+	//The cleaned and reordered soup has to trace like the mesh
+	TriangleMesh cleanedMesh{};
+	cleanedMesh.cullMode = TriangleCullMode::NoCulling;
+	KernelBenchmark::CreateTriangleSoup(mesh.GetPositions(), mesh.GetIndices(), cleanedMesh.positions, cleanedMesh.indices);
+	MeshCleanup::Clean(cleanedMesh.positions, cleanedMesh.indices, { .reorderForLocality = true });
+	cleanedMesh.CalculateNormals();
+	cleanedMesh.UpdateAABB();
+	cleanedMesh.UpdateTransforms();
+	cleanedMesh.FillTriangleList();
+	cleanedMesh.BuildBVH();
+
+	//Startup of the same mesh from OBJ text (parse + BVH build) and from its mesh file (mapped in place, prebuilt BVH)
+	const std::string objFilename{ "kernel_benchmark.obj" };
+	const std::string meshFilename{ "kernel_benchmark.mesh" };
+	std::ofstream{ objFilename, std::ios::binary } << objText;
+	if (MeshFile::ConvertOBJ(objFilename, meshFilename))
+	{
+		benchmark.MeasureLoadMesh("Utils::ParseOBJ + BuildBVH", "generated obj", [&](TriangleMesh& loadedMesh)
+			{
+				Utils::ParseOBJ(objFilename, loadedMesh.positions, loadedMesh.normals, loadedMesh.indices);
+				loadedMesh.UpdateAABB();
+			});
+		benchmark.MeasureLoadMesh("MeshFile::Load", "generated obj", [&](TriangleMesh& loadedMesh) { MeshFile::Load(meshFilename, loadedMesh); });
+
+		//Held here so every repetition finds the asset loaded: only the mesh's own world space triangles get made
+		const std::shared_ptr<const MeshAsset> pObjAsset{ AssetCache::GetMesh(objFilename) };
+		if (pObjAsset)
+			benchmark.MeasureLoadMesh("AssetCache::LoadMesh cached", "generated obj", [&](TriangleMesh& loadedMesh) { AssetCache::LoadMesh(objFilename, loadedMesh); });
+	}
+	std::remove(objFilename.c_str());
+
+	//The benchmark mesh saved and mapped back: in place it has to trace exactly like the original, transformed it goes through the refit
+	TriangleMesh mappedMesh{};
+	TriangleMesh transformedMappedMesh{};
+	mappedMesh.cullMode = TriangleCullMode::NoCulling;
+	transformedMappedMesh.cullMode = TriangleCullMode::NoCulling;
+	const bool isMeshFileLoaded{ MeshFile::Save(meshFilename, mesh) && MeshFile::Load(meshFilename, mappedMesh) && MeshFile::Load(meshFilename, transformedMappedMesh) };
+
+	//Two meshes from one asset: they have to share its arrays, and the transformed one refits its own copy of the shared BVH
+	TriangleMesh cachedMesh{};
+	TriangleMesh transformedCachedMesh{};
+	cachedMesh.cullMode = TriangleCullMode::NoCulling;
+	transformedCachedMesh.cullMode = TriangleCullMode::NoCulling;
+	const bool isAssetShared{ isMeshFileLoaded && AssetCache::LoadMesh(meshFilename, cachedMesh) && AssetCache::LoadMesh(meshFilename, transformedCachedMesh)
+		&& cachedMesh.external.pOwner == transformedCachedMesh.external.pOwner };
+	std::remove(meshFilename.c_str());
+	if (isAssetShared)
+	{
+		cachedMesh.UpdateTransforms();
+		cachedMesh.FillTriangleList();
+		cachedMesh.BuildBVH();
+
+		transformedCachedMesh.RotateY(-0.5f);
+		transformedCachedMesh.Translate({ 0.1f, 0.f, 0.f });
+		transformedCachedMesh.UpdateTransforms();
+		transformedCachedMesh.FillTriangleList();
+		transformedCachedMesh.BuildBVH();
+	}
+	else
+	{
+		std::cout << "(the benchmark mesh couldn't be shared through the asset cache, its validations fail)\n";
+	}
+	if (isMeshFileLoaded)
+	{
+		mappedMesh.UpdateTransforms();
+		mappedMesh.FillTriangleList();
+		mappedMesh.BuildBVH();
+
+		transformedMappedMesh.RotateY(0.5f);
+		transformedMappedMesh.Translate({ 0.f, 0.f, 0.1f });
+		transformedMappedMesh.UpdateTransforms();
+		transformedMappedMesh.FillTriangleList();
+		transformedMappedMesh.BuildBVH();
+	}
+	else
+	{
+		std::cout << "(the benchmark mesh couldn't go through a mesh file, its validations fail)\n";
+	}
+
+	//The benchmark mesh under a BVH far deeper than the traversal stacks: every level keeps its right child (one triangle) on
+	//the stack while the chain continues on the left, the packet walks have to hand their rays to the single ray walk
+	std::vector<BVHNode> deepNodes(1);
+	std::vector<int> deepTriIdx(mesh.GetNumTriangles());
+	std::iota(deepTriIdx.begin(), deepTriIdx.end(), 0);
+	{
+		unsigned int chainIdx{};
+		for (unsigned int triangleIdx{}; triangleIdx + 1 < deepTriIdx.size(); ++triangleIdx)
+		{
+			const unsigned int leftIdx{ static_cast<unsigned int>(deepNodes.size()) };
+			deepNodes[chainIdx].leftNode = leftIdx;
+			deepNodes.resize(deepNodes.size() + 2);
+			deepNodes[leftIdx + 1].firstTriIdx = triangleIdx;
+			deepNodes[leftIdx + 1].triCount = 1;
+			chainIdx = leftIdx;
+		}
+		deepNodes[chainIdx].firstTriIdx = static_cast<unsigned int>(deepTriIdx.size()) - 1;
+		deepNodes[chainIdx].triCount = 1;
+
+		//Children come after their parent
+		for (size_t nodeIdx{ deepNodes.size() }; nodeIdx-- > 0;)
+		{
+			BVHNode& node{ deepNodes[nodeIdx] };
+			if (node.IsLeaf())
+			{
+				const Triangle& leafTriangle{ mesh.triangles[node.firstTriIdx] };
+				node.aabbMin = Vector3::Min(leafTriangle.v0, Vector3::Min(leafTriangle.v1, leafTriangle.v2));
+				node.aabbMax = Vector3::Max(leafTriangle.v0, Vector3::Max(leafTriangle.v1, leafTriangle.v2));
+				continue;
+			}
+			node.aabbMin = Vector3::Min(deepNodes[node.leftNode].aabbMin, deepNodes[node.leftNode + 1].aabbMin);
+			node.aabbMax = Vector3::Max(deepNodes[node.leftNode].aabbMax, deepNodes[node.leftNode + 1].aabbMax);
+		}
+	}
+	//The owner only marks the arrays as external, the benchmark mesh and the vectors above outlive deepMesh
+	TriangleMesh deepMesh{};
+	deepMesh.cullMode = mesh.cullMode;
+	deepMesh.SetExternalArrays({ std::make_shared<int>(), mesh.GetPositions(), mesh.GetNormals(), mesh.GetIndices(), deepNodes, deepTriIdx },
+		mesh.minAABB, mesh.maxAABB);
+	deepMesh.UpdateTransforms();
+	deepMesh.FillTriangleList();
+	deepMesh.BuildBVH();
+
+	//Top level BVH build of as many instances as rays, the renderer's instancing scene places a million
+	{
+		std::vector<Matrix> fieldTransforms(numRays);
+		std::mt19937 generator{ seed };
+		std::uniform_real_distribution<float> positionDistribution{ -1000.f, 1000.f };
+		std::uniform_real_distribution<float> yawDistribution{ 0.f, PI_2 };
+		for (Matrix& transform : fieldTransforms)
+			transform = Matrix::CreateRotationY(yawDistribution(generator)) * Matrix::CreateTranslation(Vector3{ positionDistribution(generator), 0.f, positionDistribution(generator) });
+		benchmark.MeasureBuildInstances("InstanceBVH::Build", "random field", mesh, fieldTransforms);
+	}
+
+	//Sorting has to win back its own cost, compare it with the kernels traced on the sorted sets
+	benchmark.MeasureSort(incoherentRays);
+	benchmark.MeasureSort(reflectedRays);
+
+	//--------- Validation ---------
+	//Optimized variants get registered here against the kernel they replace
+	for (const RaySet& raySet : raySets)
+	{
+		benchmark.Validate("HitTest_Sphere", "any-hit", raySet, sphereKernel,
+			[&](const Ray& ray, HitRecord&) { return GeometryUtils::HitTest_Sphere(sphere, ray); }, false);
+		benchmark.Validate("HitTest_Plane", "any-hit", raySet, planeKernel,
+			[&](const Ray& ray, HitRecord&) { return GeometryUtils::HitTest_Plane(plane, ray); }, false);
+		benchmark.Validate("HitTest_Triangle", "any-hit", raySet, triangleKernel,
+			[&](const Ray& ray, HitRecord&) { return GeometryUtils::HitTest_Triangle(triangle, ray); }, false);
+		benchmark.Validate("brute force", "HitTest_BVH", raySet, bruteForceKernel, bvhKernel);
+		benchmark.Validate("HitTest_BVH", "any-hit", raySet, bvhKernel,
+			[&](const Ray& ray, HitRecord&) { return GeometryUtils::HitTest_TriangleMesh(mesh, ray); }, false);
+		benchmark.Validate("brute force quantized", "HitTest_BVH quantized", raySet, quantizedBruteForceKernel, quantizedBVHKernel, true, 0.f);
+		benchmark.Validate("HitTest_BVH", "mesh file", raySet, bvhKernel, [&](const Ray& ray, HitRecord& hitRecord)
+			{
+				HitRecord temp{};
+				return isMeshFileLoaded && GeometryUtils::HitTest_BVH(mappedMesh, ray, mappedMesh.rootNodeIdx, temp, hitRecord);
+			}, true, 0.f);
+		benchmark.Validate("brute force", "HitTest_BVH cleaned soup", raySet, bruteForceKernel, [&](const Ray& ray, HitRecord& hitRecord)
+			{
+				HitRecord temp{};
+				return GeometryUtils::HitTest_BVH(cleanedMesh, ray, cleanedMesh.rootNodeIdx, temp, hitRecord);
+			}, true, 0.f);
+		benchmark.Validate("brute force", "HitTest_BVH mesh file refit", raySet, [&](const Ray& ray, HitRecord& hitRecord)
+			{
+				HitRecord temp{};
+				for (const Triangle& meshTriangle : transformedMappedMesh.triangles)
+				{
+					if (GeometryUtils::HitTest_Triangle(meshTriangle, ray, temp) && temp.t < hitRecord.t)
+						hitRecord = temp;
+				}
+				return hitRecord.didHit;
+			}, [&](const Ray& ray, HitRecord& hitRecord)
+			{
+				HitRecord temp{};
+				return isMeshFileLoaded && GeometryUtils::HitTest_BVH(transformedMappedMesh, ray, transformedMappedMesh.rootNodeIdx, temp, hitRecord);
+			}, true, 0.f);
+
+		//Every instance without the top level BVH has to give the same hits (the transforms are compared with the transformed meshes under Accuracy)
+		benchmark.Validate("every instance", "HitTest_Instances", raySet, [&](const Ray& ray, HitRecord& hitRecord)
+			{
+				HitRecord temp{};
+				for (const MeshInstance& instance : instanceBVH.instances)
+				{
+					const float closestT{ hitRecord.t };
+					GeometryUtils::HitTest_BVH(mesh, instance.ToObjectSpace(ray), mesh.rootNodeIdx, temp, hitRecord);
+					if (hitRecord.t < closestT)
+						hitRecord.normal = instance.NormalToWorld(hitRecord.normal);
+				}
+				return hitRecord.didHit;
+			}, instancesKernel, true, 0.f);
+		benchmark.Validate("HitTest_Instances", "any-hit", raySet, instancesKernel, [&](const Ray& ray, HitRecord&)
+			{
+				return GeometryUtils::HitTest_Instances(instanceBVH, std::span<TriangleMesh>{ &mesh, 1 }, ray);
+			}, false);
+		benchmark.Validate("HitTest_BVH", "asset cache", raySet, bvhKernel, [&](const Ray& ray, HitRecord& hitRecord)
+			{
+				HitRecord temp{};
+				return isAssetShared && GeometryUtils::HitTest_BVH(cachedMesh, ray, cachedMesh.rootNodeIdx, temp, hitRecord);
+			}, true, 0.f);
+		benchmark.Validate("brute force", "HitTest_BVH asset cache refit", raySet, [&](const Ray& ray, HitRecord& hitRecord)
+			{
+				HitRecord temp{};
+				for (const Triangle& meshTriangle : transformedCachedMesh.triangles)
+				{
+					if (GeometryUtils::HitTest_Triangle(meshTriangle, ray, temp) && temp.t < hitRecord.t)
+						hitRecord = temp;
+				}
+				return hitRecord.didHit;
+			}, [&](const Ray& ray, HitRecord& hitRecord)
+			{
+				HitRecord temp{};
+				return isAssetShared && GeometryUtils::HitTest_BVH(transformedCachedMesh, ray, transformedCachedMesh.rootNodeIdx, temp, hitRecord);
+			}, true, 0.f);
+
+		const std::vector<ShadowRayPacket> shadowPackets{ KernelBenchmark::GenerateShadowPackets(raySet) };
+		const std::vector<RayPacket> packets{ KernelBenchmark::GeneratePackets(raySet) };
+		for (const InstructionSet instructionSet : instructionSets)
+		{
+			const KernelTable& kernels{ Kernels::GetTable(instructionSet) };
+			benchmark.ValidatePackets("HitTest_Sphere", getVariantName("shadow packet", instructionSet), raySet, shadowPackets, sphereKernel, makeSphereShadowKernel(kernels), false);
+			benchmark.ValidatePackets("HitTest_Plane", getVariantName("shadow packet", instructionSet), raySet, shadowPackets, planeKernel, makePlaneShadowKernel(kernels), false);
+			benchmark.ValidatePackets("HitTest_BVH", getVariantName("shadow packet", instructionSet), raySet, shadowPackets, bvhKernel, makeBVHShadowKernel(kernels), false);
+			benchmark.ValidatePackets("HitTest_BVH", getVariantName("shadow packet deep BVH", instructionSet), raySet, shadowPackets, bvhKernel,
+				makeShadowPacketKernel([&, kernels](const ShadowRayPacket& packet, bool* pIsOccluded) { kernels.occlusionTestTriangleMesh(deepMesh, packet, pIsOccluded); }), false);
+
+			if (packets.empty())
+				continue;
+			benchmark.ValidatePackets("HitTest_Sphere", getVariantName("packet", instructionSet), raySet, packets, sphereKernel, makeSpherePacketKernel(kernels), true);
+			benchmark.ValidatePackets("HitTest_Plane", getVariantName("packet", instructionSet), raySet, packets, planeKernel, makePlanePacketKernel(kernels), true, 0.f);
+			benchmark.ValidatePackets("HitTest_BVH", getVariantName("packet", instructionSet), raySet, packets, bvhKernel, makeBVHPacketKernel(kernels), true, 0.f);
+			benchmark.ValidatePackets("HitTest_BVH quantized", getVariantName("packet", instructionSet), raySet, packets, quantizedBVHKernel,
+				makeQuantizedBVHPacketKernel(kernels), true, 0.f);
+			benchmark.ValidatePackets("HitTest_BVH", getVariantName("packet deep BVH", instructionSet), raySet, packets, bvhKernel,
+				[&, kernels](const RayPacket& packet, HitRecord* pHitRecords) { kernels.hitTestTriangleMesh(deepMesh, packet, pHitRecords); }, true, 0.f);
+		}
+	}
+
+	benchmark.ValidateMeshFileRejected("BVH deeper than maxTraversalDepth", deepMesh);
+
+	for (size_t sceneIdx{}; sceneIdx < scenes.size(); ++sceneIdx)
+	{
+		SceneGeometry& scene{ scenes[sceneIdx] };
+		const RaySet& raySet{ sceneRaySets[sceneIdx] };
+		const std::vector<RayPacket> packets{ KernelBenchmark::GeneratePackets(raySet) };
+		for (const InstructionSet instructionSet : instructionSets)
+		{
+			benchmark.ValidatePackets("Scene", getVariantName("packet", instructionSet), raySet, packets, makeSceneKernel(scene),
+				makeScenePacketKernel(scene, Kernels::GetTable(instructionSet)), true);
+		}
+	}
+
+	//--------- Accuracy ---------
+	//The hot math paths against double precision, the bounds FAST_MATH (FastMath.h) has to stay within
+	//Every kernel gets float inputs, the reference computes from the same floats so only the kernel's own error is measured
+	std::vector<Vector3> vectors(numRays);
+	{
+		std::mt19937 generator{ seed };
+		std::normal_distribution<float> normalDistribution{ 0.f, 1.f };
+		std::uniform_real_distribution<float> exponentDistribution{ -3.f, 3.f };
+		for (Vector3& vector : vectors)
+		{
+			do
+			{
+				vector = { normalDistribution(generator), normalDistribution(generator), normalDistribution(generator) };
+			} while (vector.SqrMagnitude() < 1e-6f);
+			vector *= powf(10.f, exponentDistribution(generator));
+		}
+	}
+	const auto getMagnitude = [](const Vector3& v) { return std::sqrt(double(v.x) * v.x + double(v.y) * v.y + double(v.z) * v.z); };
+	const auto getNormalizedError = [&](const Vector3& v, const Vector3& normalized)
+		{
+			const double magnitude{ getMagnitude(v) };
+			return std::max({ fabs(normalized.x - v.x / magnitude), fabs(normalized.y - v.y / magnitude), fabs(normalized.z - v.z / magnitude) });
+		};
+	benchmark.ValidateAccuracy("Vector3::Normalized", "double", "random vectors", vectors,
+		[&](const Vector3& v) { return getNormalizedError(v, v.Normalized()); }, 1e-6);
+	benchmark.ValidateAccuracy("Vector3::Normalize", "double", "random vectors", vectors,
+		[&](const Vector3& v)
+		{
+			Vector3 normalized{ v };
+			const double magnitude{ getMagnitude(v) };
+			const double magnitudeError{ fabs(normalized.Normalize() - magnitude) / magnitude };
+			return std::max(magnitudeError, getNormalizedError(v, normalized));
+		}, 1e-6);
+
+	//Quantized meshes: normals within a fraction of a degree, positions within half a step (+ the float rounding of decoding)
+	benchmark.ValidateAccuracy("TriangleMesh::DecodeNormal", "double", "random vectors", vectors,
+		[&](const Vector3& v) { return getNormalizedError(v, TriangleMesh::DecodeNormal(TriangleMesh::EncodeNormal(v))); }, 1e-4);
+	std::vector<int> vertexIndices(quantizedMesh.quantizedPositions.size());
+	std::iota(vertexIndices.begin(), vertexIndices.end(), 0);
+	benchmark.ValidateAccuracy("TriangleMesh::DecodePosition", "steps", "mesh vertices", vertexIndices,
+		[&](int vertexIdx)
+		{
+			const Vector3 decoded{ quantizedMesh.DecodePosition(vertexIdx) };
+			const Vector3& original{ mesh.transformedPositions[vertexIdx] };
+			const Vector3& step{ quantizedMesh.quantizationStep };
+			return std::max({ fabs(decoded.x - original.x) / step.x, fabs(decoded.y - original.y) / step.y, fabs(decoded.z - original.z) / step.z });
+		}, 0.51);
+
+	//Phong over the samples with a highlight (reflection towards the viewer), for a range of exponents
+	std::vector<size_t> highlightSamples{};
+	for (size_t idx{}; idx < brdfSamples.GetSize(); ++idx)
+	{
+		if (Vector3::Dot(Vector3::Reflect(brdfSamples.GetLight(idx), brdfSamples.GetNormal(idx)), brdfSamples.GetView(idx)) > 0.f)
+			highlightSamples.push_back(idx);
+	}
+	benchmark.ValidateAccuracy("BRDF::Phong", "double", "brdf samples", highlightSamples,
+		[&](size_t idx)
+		{
+			const Vector3 n{ brdfSamples.GetNormal(idx) };
+			const Vector3 l{ brdfSamples.GetLight(idx) };
+			const Vector3 v{ brdfSamples.GetView(idx) };
+			const double nDotL{ double(n.x) * l.x + double(n.y) * l.y + double(n.z) * l.z };
+			const double cosAlpha{ (l.x - 2.0 * nDotL * n.x) * v.x + (l.y - 2.0 * nDotL * n.y) * v.y + (l.z - 2.0 * nDotL * n.z) * v.z };
+
+			double maxError{};
+			for (const float exponent : { 1.f, 5.f, 60.f, 200.f })
+			{
+				const double expected{ std::pow(cosAlpha, double(exponent)) };
+				maxError = std::max(maxError, fabs(BRDF::Phong(1.f, exponent, l, v, n).r - expected) / std::max(1.0, expected));
+			}
+			return maxError;
+		}, 2e-3);
+
+	std::vector<size_t> allSamples(brdfSamples.GetSize());
+	for (size_t idx{}; idx < allSamples.size(); ++idx)
+		allSamples[idx] = idx;
+	benchmark.ValidateAccuracy("BRDF::Schlick", "double", "brdf samples", allSamples,
+		[&](size_t idx)
+		{
+			const Vector3 h{ (brdfSamples.GetLight(idx) + brdfSamples.GetView(idx)).Normalized() };
+			const Vector3 v{ brdfSamples.GetView(idx) };
+			const double x5{ std::pow(1.0 - (double(h.x) * v.x + double(h.y) * v.y + double(h.z) * v.z), 5.0) };
+			const ColorRGB fresnel{ BRDF::FresnelFunction_Schlick(h, v, albedo) };
+			return std::max({
+				fabs(fresnel.r - (albedo.r + (1.0 - albedo.r) * x5)),
+				fabs(fresnel.g - (albedo.g + (1.0 - albedo.g) * x5)),
+				fabs(fresnel.b - (albedo.b + (1.0 - albedo.b) * x5)) });
+		}, 1e-6);
+
+	//Closest root of the sphere in front of the ray, -1 on a miss
+	//Rays grazing the sphere lose precision in the float discriminant whatever the math mode, hence the looser bound
+	const auto getSphereT = [&](const Ray& ray)
+		{
+			const double toRayX{ double(ray.origin.x) - sphere.origin.x };
+			const double toRayY{ double(ray.origin.y) - sphere.origin.y };
+			const double toRayZ{ double(ray.origin.z) - sphere.origin.z };
+			const double a{ double(ray.direction.x) * ray.direction.x + double(ray.direction.y) * ray.direction.y + double(ray.direction.z) * ray.direction.z };
+			const double b{ 2.0 * (ray.direction.x * toRayX + ray.direction.y * toRayY + ray.direction.z * toRayZ) };
+			const double c{ toRayX * toRayX + toRayY * toRayY + toRayZ * toRayZ - double(sphere.radius) * sphere.radius };
+			const double discriminant{ b * b - 4.0 * a * c };
+			if (discriminant < 0.0)
+				return -1.0;
+
+			const double t0{ (-b - std::sqrt(discriminant)) / (2.0 * a) };
+			const double t1{ (-b + std::sqrt(discriminant)) / (2.0 * a) };
+			const double t{ t0 >= 0.0 ? t0 : t1 };
+			return t >= 0.0 && t >= ray.min && t <= ray.max ? t : -1.0;
+		};
+	for (const RaySet& raySet : raySets)
+	{
+		benchmark.ValidateAccuracy("HitTest_Sphere", "double", raySet.name, raySet.rays,
+			[&](const Ray& ray) -> double
+			{
+				HitRecord hitRecord{};
+				const bool didHit{ GeometryUtils::HitTest_Sphere(sphere, ray, hitRecord) };
+				const double expectedT{ getSphereT(ray) };
+				if (didHit != (expectedT >= 0.0))
+					return INFINITY;
+				return didHit ? fabs(hitRecord.t - expectedT) / std::max(1.0, expectedT) : 0.0;
+			}, 1e-4);
+	}
+
+	//Instances against the transformed copies of the mesh: the world positions back in object space and the object normals in world space
+	//Built from the same transforms in the same order (the top level BVH reorders its instances)
+	InstanceBVH unsortedInstances{};
+	for (const Matrix& transform : instanceTransforms)
+		unsortedInstances.AddInstance(0, mesh, transform);
+	std::vector<int> instanceIndices(instanceTransforms.size());
+	std::iota(instanceIndices.begin(), instanceIndices.end(), 0);
+	benchmark.ValidateAccuracy("MeshInstance::ToObjectSpace", "object space", "instance transforms", instanceIndices,
+		[&](int instanceIdx)
+		{
+			const MeshInstance& instance{ unsortedInstances.instances[instanceIdx] };
+			const TriangleMesh& flattenedMesh{ flattenedMeshes[instanceIdx] };
+			double maxError{};
+			for (size_t vertexIdx{}; vertexIdx < mesh.positions.size(); ++vertexIdx)
+			{
+				const Vector3 objectPosition{ instance.ToObjectSpace(Ray{ flattenedMesh.transformedPositions[vertexIdx] }).origin };
+				maxError = std::max(maxError, double((objectPosition - mesh.positions[vertexIdx]).Magnitude() / radius));
+			}
+			return maxError;
+		}, 1e-5);
+	benchmark.ValidateAccuracy("MeshInstance::NormalToWorld", "transformed normals", "instance transforms", instanceIndices,
+		[&](int instanceIdx)
+		{
+			const MeshInstance& instance{ unsortedInstances.instances[instanceIdx] };
+			const TriangleMesh& flattenedMesh{ flattenedMeshes[instanceIdx] };
+			double maxError{};
+			for (size_t normalIdx{}; normalIdx < mesh.normals.size(); ++normalIdx)
+			{
+				const Vector3 worldNormal{ instance.NormalToWorld(mesh.normals[normalIdx]) };
+				maxError = std::max(maxError, double((worldNormal - flattenedMesh.transformedNormals[normalIdx].Normalized()).Magnitude()));
+			}
+			return maxError;
+		}, 1e-5);
+
+	//--------- Report ---------
+#if defined(FAST_MATH)
+	const char* mathMode{ "fast math" };
+#else
+	const char* mathMode{ "exact math" };
+#endif
+	std::string variantNames{};
+	for (const InstructionSet instructionSet : instructionSets)
+		variantNames += std::string{ variantNames.empty() ? "" : " " } + CPUFeatures::GetName(instructionSet);
+	//Per copy of the mesh: a transformed mesh has its own triangles, arrays and BVH, an instance its record and top level nodes
+	size_t flattenedBytes{};
+	for (const TriangleMesh& flattenedMesh : flattenedMeshes)
+	{
+		flattenedBytes += flattenedMesh.triangles.size() * sizeof(Triangle) + flattenedMesh.triIdx.size() * sizeof(int)
+			+ (flattenedMesh.positions.size() + flattenedMesh.normals.size() + flattenedMesh.transformedPositions.size() + flattenedMesh.transformedNormals.size()) * sizeof(Vector3)
+			+ flattenedMesh.indices.size() * sizeof(int) + flattenedMesh.bvhNodePool.size() * sizeof(BVHNode);
+	}
+	const size_t instanceBytes{ instanceBVH.instances.size() * sizeof(MeshInstance) + instanceBVH.bvhNodePool.size() * sizeof(BVHNode) };
+	std::cout << "(instances: " << instanceBytes / instanceBVH.instances.size() << " bytes per instance instead of "
+		<< flattenedBytes / flattenedMeshes.size() << " per transformed mesh)\n";
+
+	//The arrays the hit tests read besides the BVH and the indices, which both meshes share
+	const size_t geometryBytes{ mesh.triangles.size() * sizeof(Triangle) + (mesh.transformedPositions.size() + mesh.transformedNormals.size()) * sizeof(Vector3) };
+	const size_t quantizedGeometryBytes{ quantizedMesh.quantizedPositions.size() * sizeof(QuantizedPosition) + quantizedMesh.quantizedNormals.size() * sizeof(uint32_t) };
+	std::cout << "(quantized mesh: " << quantizedGeometryBytes << " bytes of geometry instead of " << geometryBytes << ")\n";
+	std::cout << "**KERNEL BENCHMARK** (" << mesh.triangles.size() << " triangles, seed " << seed << ", " << mathMode << ", kernels " << variantNames << ")\n";
+	const bool allMatched{ benchmark.PrintReport(std::cout) };
+
+	std::ofstream fileStream("kernel_benchmark.txt");
+	benchmark.PrintReport(fileStream);
+	fileStream.close();
+
+	return allMatched ? 0 : 1;
+}
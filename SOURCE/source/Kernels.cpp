@@ -0,0 +1,142 @@
+//AVX-512 implies FMA, GCC and clang (-ffp-contract=on by default) would fuse multiplies and adds in those variants and round
+//differently than the others (this has to come before the includes, the kernels are made of the inline functions in the headers)
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "Kernels.h"
+#include "Utils.h"
+#include "BRDFsSIMD.h"
+#include "SIMD.h"
+
+//flatten inlines every call below a kernel entry point, which puts the whole kernel under the entry point's instruction set
+//(the BVH walks use a stack for that, only the single ray fallback of a diverged packet stays a baseline call)
+#if defined(__GNUC__) || defined(__clang__)
+#define KERNEL_FLATTEN __attribute__((flatten))
+#else
+#define KERNEL_FLATTEN
+#endif
+
+namespace dae
+{
+	namespace Kernels
+	{
+		template<typename FloatN>
+		static void Shade(const MaterialData& material, const float* pNormals, const float* pLightDirections, const float* pViewDirections, float* pColors)
+		{
+			static_assert(FloatN::width == Float8::width, "the renderer shades batches of Float8::width hits");
+			constexpr int width{ FloatN::width };
+
+			const Vector3xN<FloatN> normals{ Vector3xN<FloatN>::Load(pNormals, pNormals + width, pNormals + 2 * width) };
+			const Vector3xN<FloatN> lightDirections{ Vector3xN<FloatN>::Load(pLightDirections, pLightDirections + width, pLightDirections + 2 * width) };
+			const Vector3xN<FloatN> viewDirections{ Vector3xN<FloatN>::Load(pViewDirections, pViewDirections + width, pViewDirections + 2 * width) };
+			BRDF::Shade(material, normals, lightDirections, viewDirections).Store(pColors, pColors + width, pColors + 2 * width);
+		}
+
+		//Max(b, a) is std::max(a, b), so this matches ColorRGB::MaxToOne + the uint8_t casts bit for bit
+		template<typename FloatN>
+		static void ConvertColors(const float* pRed, const float* pGreen, const float* pBlue, uint32_t* pPixels, size_t count, const PixelFormat& format)
+		{
+			const FloatN one{ 1.f };
+			const FloatN scale{ 255.f };
+
+			size_t first{};
+			for (; first + FloatN::width <= count; first += FloatN::width)
+			{
+				const FloatN red{ FloatN::Load(pRed + first) };
+				const FloatN green{ FloatN::Load(pGreen + first) };
+				const FloatN blue{ FloatN::Load(pBlue + first) };
+
+				const FloatN maxValue{ Max(Max(blue, green), red) };
+				const MaskOf<FloatN> isOverexposed{ maxValue > one };
+
+				float scaledRed[FloatN::width], scaledGreen[FloatN::width], scaledBlue[FloatN::width];
+				(Select(isOverexposed, red / maxValue, red) * scale).Store(scaledRed);
+				(Select(isOverexposed, green / maxValue, green) * scale).Store(scaledGreen);
+				(Select(isOverexposed, blue / maxValue, blue) * scale).Store(scaledBlue);
+
+				for (int lane{}; lane < FloatN::width; ++lane)
+				{
+					pPixels[first + lane] = format.Pack(static_cast<uint8_t>(scaledRed[lane]), static_cast<uint8_t>(scaledGreen[lane]), static_cast<uint8_t>(scaledBlue[lane]));
+				}
+			}
+
+			for (; first < count; ++first)
+			{
+				ColorRGB color{ pRed[first], pGreen[first], pBlue[first] };
+				color.MaxToOne();
+				pPixels[first] = format.Pack(static_cast<uint8_t>(color.r * 255), static_cast<uint8_t>(color.g * 255), static_cast<uint8_t>(color.b * 255));
+			}
+		}
+
+		//Entry points + table of one instruction set: the packet kernels run FloatPacket::width lanes per operation, the BRDFs Float8::width
+#define DEFINE_KERNELS(instructionSet, target, FloatPacket, FloatBatch) \
+		namespace instructionSet##Kernels \
+		{ \
+			target KERNEL_FLATTEN static void HitTestTriangleMesh(TriangleMesh& mesh, const RayPacket& packet, HitRecord* pHitRecords) \
+			{ GeometryUtils::HitTest_TriangleMesh<FloatPacket>(mesh, packet, pHitRecords); } \
+			target KERNEL_FLATTEN static void HitTestSphere(const Sphere& sphere, const RayPacket& packet, float* closestT, HitRecord* pHitRecords) \
+			{ GeometryUtils::HitTest_Sphere<FloatPacket>(sphere, packet, closestT, pHitRecords); } \
+			target KERNEL_FLATTEN static void HitTestPlane(const Plane& plane, const RayPacket& packet, float* closestT, HitRecord* pHitRecords) \
+			{ GeometryUtils::HitTest_Plane<FloatPacket>(plane, packet, closestT, pHitRecords); } \
+			target KERNEL_FLATTEN static void OcclusionTestTriangleMesh(TriangleMesh& mesh, const ShadowRayPacket& packet, bool* isOccluded) \
+			{ GeometryUtils::HitTest_TriangleMesh<FloatPacket>(mesh, packet, isOccluded); } \
+			target KERNEL_FLATTEN static void OcclusionTestSphere(const Sphere& sphere, const ShadowRayPacket& packet, bool* isOccluded) \
+			{ GeometryUtils::HitTest_Sphere<FloatPacket>(sphere, packet, isOccluded); } \
+			target KERNEL_FLATTEN static void OcclusionTestPlane(const Plane& plane, const ShadowRayPacket& packet, bool* isOccluded) \
+			{ GeometryUtils::HitTest_Plane<FloatPacket>(plane, packet, isOccluded); } \
+			target KERNEL_FLATTEN static void ShadeBatch(const MaterialData& material, const float* pNormals, const float* pLightDirections, const float* pViewDirections, float* pColors) \
+			{ Shade<FloatBatch>(material, pNormals, pLightDirections, pViewDirections, pColors); } \
+			target KERNEL_FLATTEN static void ConvertColorBatch(const float* pRed, const float* pGreen, const float* pBlue, uint32_t* pPixels, size_t count, const PixelFormat& format) \
+			{ ConvertColors<FloatPacket>(pRed, pGreen, pBlue, pPixels, count, format); } \
+			\
+			static const KernelTable table{ InstructionSet::instructionSet, \
+				&HitTestTriangleMesh, &HitTestSphere, &HitTestPlane, \
+				&OcclusionTestTriangleMesh, &OcclusionTestSphere, &OcclusionTestPlane, \
+				&ShadeBatch, &ConvertColorBatch }; \
+		}
+
+		DEFINE_KERNELS(Baseline, , Float4, Float8)
+#if defined(SIMD_SSE)
+		//Same SSE types, the compiler gets to use SSE4.1 blends/rounding and POPCNT
+		DEFINE_KERNELS(SSE42, SIMD_TARGET_SSE42, Float4, Float8)
+		DEFINE_KERNELS(AVX2, SIMD_TARGET_AVX2, Float8AVX2, Float8AVX2)
+		//16 lanes per packet operation with the active lanes in mask registers, the BRDFs stay 8-wide (the renderer's batches)
+		DEFINE_KERNELS(AVX512, SIMD_TARGET_AVX512, Float16AVX512, Float8AVX2)
+#endif
+#undef DEFINE_KERNELS
+
+		const KernelTable& GetTable(InstructionSet instructionSet)
+		{
+#if defined(SIMD_SSE)
+			switch (instructionSet)
+			{
+			case InstructionSet::SSE42:
+				return SSE42Kernels::table;
+			case InstructionSet::AVX2:
+				return AVX2Kernels::table;
+			case InstructionSet::AVX512:
+				return AVX512Kernels::table;
+			default:
+				break;
+			}
+#else
+			(void)instructionSet;
+#endif
+			return BaselineKernels::table;
+		}
+
+		const KernelTable* g_pActiveKernels{ &GetTable(CPUFeatures::GetSupportedInstructionSet()) };
+
+		bool SelectInstructionSet(InstructionSet instructionSet)
+		{
+			if (!CPUFeatures::IsSupported(instructionSet))
+				return false;
+
+			g_pActiveKernels = &GetTable(instructionSet);
+			return true;
+		}
+	}
+}
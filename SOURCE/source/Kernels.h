@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "CPUFeatures.h"
+
+namespace dae
+{
+	struct TriangleMesh;
+	struct Sphere;
+	struct Plane;
+	struct RayPacket;
+	struct ShadowRayPacket;
+	struct HitRecord;
+	struct MaterialData;
+
+	//32 bit pixels with 8 bits per channel, Pack does what SDL_MapRGB does for those formats
+	struct PixelFormat
+	{
+		uint32_t redShift{};
+		uint32_t greenShift{};
+		uint32_t blueShift{};
+		//Alpha bits set in every pixel (opaque)
+		uint32_t alphaMask{};
+
+		uint32_t Pack(uint8_t red, uint8_t green, uint8_t blue) const
+		{
+			return (uint32_t(red) << redShift) | (uint32_t(green) << greenShift) | (uint32_t(blue) << blueShift) | alphaMask;
+		}
+	};
+
+	//The hot kernels, compiled once for every instruction set (Kernels.cpp)
+	//Every variant gives the exact same results as the GeometryUtils and BRDF templates they wrap, only the speed differs
+	struct KernelTable
+	{
+		InstructionSet instructionSet;
+
+		//GeometryUtils packet tests, closest hit
+		void (*hitTestTriangleMesh)(TriangleMesh& mesh, const RayPacket& packet, HitRecord* pHitRecords);
+		void (*hitTestSphere)(const Sphere& sphere, const RayPacket& packet, float* closestT, HitRecord* pHitRecords);
+		void (*hitTestPlane)(const Plane& plane, const RayPacket& packet, float* closestT, HitRecord* pHitRecords);
+
+		//GeometryUtils packet tests, any hit
+		void (*occlusionTestTriangleMesh)(TriangleMesh& mesh, const ShadowRayPacket& packet, bool* isOccluded);
+		void (*occlusionTestSphere)(const Sphere& sphere, const ShadowRayPacket& packet, bool* isOccluded);
+		void (*occlusionTestPlane)(const Plane& plane, const ShadowRayPacket& packet, bool* isOccluded);
+
+		//BRDF::Shade of BRDFsSIMD.h for Float8::width hits with the same material
+		//Vectors and colors are stored per component: the x (r) of every hit, then y (g), then z (b)
+		void (*shade)(const MaterialData& material, const float* pNormals, const float* pLightDirections, const float* pViewDirections, float* pColors);
+
+		//ColorRGB::MaxToOne, scale to [0, 255] and pack, for count colors stored per channel
+		void (*convertColors)(const float* pRed, const float* pGreen, const float* pBlue, uint32_t* pPixels, size_t count, const PixelFormat& format);
+	};
+
+	namespace Kernels
+	{
+		extern const KernelTable* g_pActiveKernels;
+
+		//The variants of the highest instruction set the CPU supports, unless SelectInstructionSet picked another one
+		inline const KernelTable& Get() { return *g_pActiveKernels; }
+
+		//Switches every kernel to another instruction set (benchmarks, comparisons), call while no kernel runs
+		//False when the CPU doesn't support it, the active kernels stay the same then
+		bool SelectInstructionSet(InstructionSet instructionSet);
+
+		//Variants of any instruction set, only call them on a CPU that supports it
+		//Builds without SSE only have the baseline variants and return those for every set
+		const KernelTable& GetTable(InstructionSet instructionSet);
+	}
+}
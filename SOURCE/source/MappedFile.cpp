@@ -0,0 +1,135 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#if defined(_WIN32)
+	bool MappedFile::Open(const std::string& filename)
+	{
+		Close();
+		m_Error.clear();
+
+		const HANDLE file{ CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			m_Error = { int(GetLastError()), std::system_category() };
+			return false;
+		}
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file, &size))
+		{
+			m_Error = { int(GetLastError()), std::system_category() };
+			CloseHandle(file);
+			return false;
+		}
+
+		m_FileHandle = file;
+		m_IsOpen = true;
+		//Windows can't map an empty file
+		if (size.QuadPart == 0)
+			return true;
+
+		const HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+		const void* pView{ mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr };
+		if (!pView)
+		{
+			m_Error = { int(GetLastError()), std::system_category() };
+			if (mapping)
+				CloseHandle(mapping);
+			Close();
+			return false;
+		}
+
+		m_MappingHandle = mapping;
+		m_pData = static_cast<const char*>(pView);
+		m_Size = size_t(size.QuadPart);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_pData)
+			UnmapViewOfFile(m_pData);
+		if (m_MappingHandle)
+			CloseHandle(m_MappingHandle);
+		if (m_FileHandle)
+			CloseHandle(m_FileHandle);
+
+		m_pData = nullptr;
+		m_Size = 0;
+		m_IsOpen = false;
+		m_FileHandle = nullptr;
+		m_MappingHandle = nullptr;
+	}
+#else
+	bool MappedFile::Open(const std::string& filename)
+	{
+		Close();
+		m_Error.clear();
+
+		const int file{ open(filename.c_str(), O_RDONLY) };
+		if (file < 0)
+		{
+			m_Error = { errno, std::generic_category() };
+			return false;
+		}
+
+		struct stat status {};
+		const bool hasStatus{ fstat(file, &status) == 0 };
+		if (!hasStatus || !S_ISREG(status.st_mode))
+		{
+			//Directories, devices and pipes open fine but can't be mapped
+			m_Error = hasStatus ? std::make_error_code(S_ISDIR(status.st_mode) ? std::errc::is_a_directory : std::errc::invalid_argument)
+				: std::error_code{ errno, std::generic_category() };
+			close(file);
+			return false;
+		}
+
+		//The mapping keeps the file alive, the descriptor isn't needed anymore
+		void* pView{ nullptr };
+		if (status.st_size > 0)
+		{
+			pView = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+			if (pView == MAP_FAILED)
+			{
+				m_Error = { errno, std::generic_category() };
+				close(file);
+				return false;
+			}
+		}
+		close(file);
+
+		m_pData = static_cast<const char*>(pView);
+		m_Size = size_t(status.st_size);
+		m_IsOpen = true;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_pData)
+			munmap(const_cast<char*>(m_pData), m_Size);
+
+		m_pData = nullptr;
+		m_Size = 0;
+		m_IsOpen = false;
+	}
+#endif
+}
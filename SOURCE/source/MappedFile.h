@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <system_error>
+
+namespace dae
+{
+	//Read-only view of a whole file mapped into the address space, the pages come straight from the OS file cache
+	//Nothing gets copied: processes mapping the same file share the memory, pages load on first touch
+	class MappedFile final
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) noexcept = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+		//False when the file can't be opened or mapped, GetError has the reason then. An empty file opens fine (no data, size 0)
+		bool Open(const std::string& filename);
+		void Close();
+
+		bool IsOpen() const { return m_IsOpen; }
+		const char* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+		//OS error of the last Open that failed
+		const std::error_code& GetError() const { return m_Error; }
+
+	private:
+		const char* m_pData{};
+		size_t m_Size{};
+		bool m_IsOpen{};
+		std::error_code m_Error{};
+#if defined(_WIN32)
+		void* m_FileHandle{};
+		void* m_MappingHandle{};
+#endif
+	};
+}
@@ -7,6 +7,71 @@
 
 namespace dae
 {
+#pragma region Material DATA
+	enum class MaterialType : unsigned char
+	{
+		SolidColor,
+		Lambert,
+		LambertPhong,
+		CookTorrence
+	};
+
+	//Flat copy of a material with everything that only depends on its parameters precomputed
+	//Scenes keep one per material in a table indexed by HitRecord::materialIndex, shading it needs no virtual call
+	struct MaterialData
+	{
+		MaterialType type{ MaterialType::SolidColor };
+
+		//SolidColor: the color, Lambert(Phong): kd * cd / PI, CookTorrence: albedo / PI
+		ColorRGB diffuse{};
+		//CookTorrence: base reflectivity (0.04 for dielectrics, the albedo for metals)
+		ColorRGB f0{};
+		bool isMetal{};
+		//CookTorrence: roughness^4 for the GGX normal distribution and k = (roughness^2 + 1)^2 / 8 for Schlick-GGX
+		float alphaSquared{};
+		float k{};
+
+		//LambertPhong
+		float specularReflectance{};
+		float phongExponent{};
+
+		//Same result as Material::Shade of the material it was made from
+		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
+		{
+			switch (type)
+			{
+			case MaterialType::SolidColor:
+			case MaterialType::Lambert:
+				return diffuse;
+
+			case MaterialType::LambertPhong:
+				return diffuse + BRDF::Phong(specularReflectance, phongExponent, l, -v, hitRecord.normal);
+
+			case MaterialType::CookTorrence:
+			{
+				const Vector3& n{ hitRecord.normal };
+				const Vector3 halfVector{ (v + l) / (v + l).Magnitude() };
+
+				const ColorRGB F{ BRDF::FresnelFunction_Schlick(halfVector, v, f0) };
+				const float D{ BRDF::NormalDistribution_GGX(Vector3::Dot(n, halfVector), alphaSquared) };
+				const float nDotV{ Vector3::Dot(n, v) };
+				const float nDotL{ Vector3::Dot(n, l) };
+				const float G{ BRDF::GeometryFunction_Smith(nDotV, nDotL, k) };
+
+				const ColorRGB specular{ D * F * G * (1.f / (4.f * (nDotV * nDotL))) };
+				if (isMetal)
+					return specular;
+
+				//Dielectrics: whatever isn't reflected is diffused
+				const ColorRGB kd{ ColorRGB{ 1.f, 1.f, 1.f } - F };
+				return kd * kd * diffuse + specular;
+			}
+			}
+			return {};
+		}
+	};
+#pragma endregion
+
 #pragma region Material BASE
 	class Material
 	{
@@ -27,6 +92,9 @@ namespace dae
 		 * \return color
 		 */
 		virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) = 0;
+
+		//Flat copy for the material table of the scene (see MaterialData)
+		virtual MaterialData GetData() const = 0;
 	};
 #pragma endregion
 
@@ -45,6 +113,14 @@ namespace dae
 			return m_Color;
 		}
 
+		MaterialData GetData() const override
+		{
+			MaterialData data{};
+			data.type = MaterialType::SolidColor;
+			data.diffuse = m_Color;
+			return data;
+		}
+
 	private:
 		ColorRGB m_Color{ colors::White };
 	};
@@ -65,6 +141,14 @@ namespace dae
 			return { BRDF::Lambert(m_DiffuseReflectance,m_DiffuseColor) };
 		}
 
+		MaterialData GetData() const override
+		{
+			MaterialData data{};
+			data.type = MaterialType::Lambert;
+			data.diffuse = BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
+			return data;
+		}
+
 	private:
 		ColorRGB m_DiffuseColor{ colors::White };
 		float m_DiffuseReflectance{ 1.f }; //kd
@@ -89,6 +173,16 @@ namespace dae
 			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor) + BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, -v, hitRecord.normal);
 		}
 
+		MaterialData GetData() const override
+		{
+			MaterialData data{};
+			data.type = MaterialType::LambertPhong;
+			data.diffuse = BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
+			data.specularReflectance = m_SpecularReflectance;
+			data.phongExponent = m_PhongExponent;
+			return data;
+		}
+
 	private:
 		ColorRGB m_DiffuseColor{ colors::White };
 		float m_DiffuseReflectance{ 0.5f }; //kd
@@ -138,6 +232,18 @@ namespace dae
 
 		}
 
+		MaterialData GetData() const override
+		{
+			MaterialData data{};
+			data.type = MaterialType::CookTorrence;
+			data.isMetal = m_Metalness != 0.f;
+			data.f0 = data.isMetal ? m_Albedo : ColorRGB{ 0.04f,0.04f,0.04f };
+			data.diffuse = BRDF::Lambert(1.f, m_Albedo);
+			data.alphaSquared = Square(Square(m_Roughness));
+			data.k = Square(Square(m_Roughness) + 1.f) / 8.f;
+			return data;
+		}
+
 	private:
 		ColorRGB m_Albedo{ 0.955f, 0.637f, 0.538f }; //Copper
 		float m_Metalness{ 1.0f };
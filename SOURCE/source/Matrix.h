@@ -1,53 +1,305 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
 #include "Vector3.h"
 #include "Vector4.h"
+#include "SIMD.h"
 
 namespace dae {
+	//Header only like the vectors, transforms and multiplies run on Float4 rows (SSE/NEON, see SIMD.h)
+	//Constant evaluation takes the scalar path, which does the same operations in the same order
 	struct Matrix
 	{
 		Matrix() = default;
-		Matrix(
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
-			const Vector3& t);
+			const Vector3& t) :
+			Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+		{
+		}
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
-			const Vector4& t);
-
-		Matrix(const Matrix& m);
-
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
-		const Matrix& Transpose();
-
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
-
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
-
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+			const Vector4& t) :
+			data{ xAxis, yAxis, zAxis, t }
+		{
+		}
+
+		constexpr Matrix(const Matrix& m) = default;
+		constexpr Matrix& operator=(const Matrix& m) = default;
+
+		constexpr Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(v.x, v.y, v.z);
+		}
+
+		constexpr Vector3 TransformVector(float x, float y, float z) const
+		{
+			if (std::is_constant_evaluated())
+			{
+				return Vector3{
+					data[0].x * x + data[1].x * y + data[2].x * z,
+					data[0].y * x + data[1].y * y + data[2].y * z,
+					data[0].z * x + data[1].z * y + data[2].z * z
+				};
+			}
+
+			float result[Float4::width];
+			(GetRow(0) * Float4{ x } + GetRow(1) * Float4{ y } + GetRow(2) * Float4{ z }).Store(result);
+			return { result[0], result[1], result[2] };
+		}
+
+		constexpr Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z);
+		}
+
+		constexpr Vector3 TransformPoint(float x, float y, float z) const
+		{
+			if (std::is_constant_evaluated())
+			{
+				return Vector3{
+					data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+					data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+					data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+				};
+			}
+
+			float result[Float4::width];
+			(GetRow(0) * Float4{ x } + GetRow(1) * Float4{ y } + GetRow(2) * Float4{ z } + GetRow(3)).Store(result);
+			return { result[0], result[1], result[2] };
+		}
+
+		//Batched TransformPoint, the rows stay in registers for the whole array (pPoints and pTransformed may be the same array)
+		void TransformPoints(const Vector3* pPoints, Vector3* pTransformed, size_t count) const
+		{
+			const Float4 row0{ GetRow(0) };
+			const Float4 row1{ GetRow(1) };
+			const Float4 row2{ GetRow(2) };
+			const Float4 row3{ GetRow(3) };
+
+			float result[Float4::width];
+			for (size_t i{}; i < count; ++i)
+			{
+				const Vector3& p{ pPoints[i] };
+				(row0 * Float4{ p.x } + row1 * Float4{ p.y } + row2 * Float4{ p.z } + row3).Store(result);
+				pTransformed[i] = { result[0], result[1], result[2] };
+			}
+		}
+
+		//Batched TransformVector
+		void TransformVectors(const Vector3* pVectors, Vector3* pTransformed, size_t count) const
+		{
+			const Float4 row0{ GetRow(0) };
+			const Float4 row1{ GetRow(1) };
+			const Float4 row2{ GetRow(2) };
+
+			float result[Float4::width];
+			for (size_t i{}; i < count; ++i)
+			{
+				const Vector3& v{ pVectors[i] };
+				(row0 * Float4{ v.x } + row1 * Float4{ v.y } + row2 * Float4{ v.z }).Store(result);
+				pTransformed[i] = { result[0], result[1], result[2] };
+			}
+		}
+
+		constexpr const Matrix& Transpose()
+		{
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = data[c][r];
+				}
+			}
+
+			*this = result;
+			return *this;
+		}
+
+		constexpr Vector3 GetAxisX() const
+		{
+			return data[0];
+		}
+
+		constexpr Vector3 GetAxisY() const
+		{
+			return data[1];
+		}
+
+		constexpr Vector3 GetAxisZ() const
+		{
+			return data[2];
+		}
+
+		constexpr Vector3 GetTranslation() const
+		{
+			return data[3];
+		}
+
+		static constexpr Matrix CreateTranslation(float x, float y, float z)
+		{
+			return { Vector4{ 1, 0, 0, x },
+					 Vector4{ 0, 1, 0, y },
+					 Vector4{ 0, 0, 1, z },
+					 Vector4{ 0, 0, 0, 1 } };
+		}
+
+		static constexpr Matrix CreateTranslation(const Vector3& t)
+		{
+			return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+		}
+
+		static Matrix CreateRotationX(float pitch)
+		{
+			return { Vector4{ 1   ,0             ,0              ,0 },
+					 Vector4{ 0   ,cosf(pitch)   ,-sinf(pitch)   ,0 },
+					 Vector4{ 0   ,sinf(pitch)   ,cosf(pitch)    ,0 },
+					 Vector4{ 0   ,0             ,0              ,1 } };
+		}
+
+		static Matrix CreateRotationY(float yaw)
+		{
+			return { Vector4{ cosf(yaw) ,0   ,-sinf(yaw)  ,0 },
+					 Vector4{ 0         ,1   ,0           ,0 },
+					 Vector4{ sinf(yaw) ,0   ,cosf(yaw)   ,0 },
+					 Vector4{ 0         ,0   ,0           ,1 } };
+		}
+
+		static Matrix CreateRotationZ(float roll)
+		{
+			return { Vector4{ cosf(roll)    ,sinf(roll)  ,0  ,0 },
+					 Vector4{ -sinf(roll)   ,cosf(roll)  ,0  ,0 },
+					 Vector4{ 0             ,0           ,1  ,0 },
+					 Vector4{ 0             ,0           ,0  ,1 } };
+		}
+
+		static Matrix CreateRotation(float pitch, float yaw, float roll)
+		{
+			return CreateRotation({ pitch, yaw, roll });
+		}
+
+		static Matrix CreateRotation(const Vector3& r)
+		{
+			return { CreateRotationX(r.x) * CreateRotationY(r.y) * CreateRotationZ(r.z) };
+		}
+
+		static constexpr Matrix CreateScale(float sx, float sy, float sz)
+		{
+			return { Vector4{ sx, 0, 0, 0 },
+					 Vector4{ 0, sy, 0, 0 },
+					 Vector4{ 0, 0, sz, 0 },
+					 Vector4{ 0, 0, 0, 1 } };
+		}
+
+		static constexpr Matrix CreateScale(const Vector3& s)
+		{
+			return CreateScale(s[0], s[1], s[2]);
+		}
+
+		static constexpr Matrix Transpose(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Transpose();
+
+			return out;
+		}
+
+		//Inverse of a transform without projection (last column 0, 0, 0, 1): the 3x3 part through its adjugate, then the translation
+		static constexpr Matrix InverseAffine(const Matrix& m)
+		{
+			const Vector3 xAxis{ m.GetAxisX() };
+			const Vector3 yAxis{ m.GetAxisY() };
+			const Vector3 zAxis{ m.GetAxisZ() };
+			const Vector3 yCrossZ{ Vector3::Cross(yAxis, zAxis) };
+			const Vector3 zCrossX{ Vector3::Cross(zAxis, xAxis) };
+			const Vector3 xCrossY{ Vector3::Cross(xAxis, yAxis) };
+			const float invDeterminant{ 1.f / Vector3::Dot(xAxis, yCrossZ) };
+
+			//The cross products are the columns of the inverse
+			const Vector3 invXAxis{ Vector3{ yCrossZ.x, zCrossX.x, xCrossY.x } * invDeterminant };
+			const Vector3 invYAxis{ Vector3{ yCrossZ.y, zCrossX.y, xCrossY.y } * invDeterminant };
+			const Vector3 invZAxis{ Vector3{ yCrossZ.z, zCrossX.z, xCrossY.z } * invDeterminant };
+			const Vector3 translation{ m.GetTranslation() };
+			return { invXAxis, invYAxis, invZAxis, -(invXAxis * translation.x + invYAxis * translation.y + invZAxis * translation.z) };
+		}
+
+		//Exact compare against the default matrix
+		constexpr bool IsIdentity() const
+		{
+			const Matrix identity{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				const Vector4& row{ data[r] };
+				const Vector4& identityRow{ identity.data[r] };
+				if (row.x != identityRow.x || row.y != identityRow.y || row.z != identityRow.z || row.w != identityRow.w)
+					return false;
+			}
+			return true;
+		}
+
+		#pragma region Matrix Operators
+		constexpr Vector4& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Vector4 operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		//Row r of the result = sum over k of this[r][k] * m row k, the same sums Dot(row, column) adds up
+		constexpr Matrix operator*(const Matrix& m) const
+		{
+			Matrix result{};
+			if (std::is_constant_evaluated())
+			{
+				const Matrix m_transposed = Transpose(m);
+				for (int r{ 0 }; r < 4; ++r)
+				{
+					for (int c{ 0 }; c < 4; ++c)
+					{
+						result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
+					}
+				}
+				return result;
+			}
+
+			const Float4 row0{ m.GetRow(0) };
+			const Float4 row1{ m.GetRow(1) };
+			const Float4 row2{ m.GetRow(2) };
+			const Float4 row3{ m.GetRow(3) };
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				const Vector4& row{ data[r] };
+				(row0 * Float4{ row.x } + row1 * Float4{ row.y } + row2 * Float4{ row.z } + row3 * Float4{ row.w }).Store(&result.data[r].x);
+			}
+			return result;
+		}
+
+		constexpr const Matrix& operator*=(const Matrix& m)
+		{
+			*this = *this * m;
+			return *this;
+		}
+		#pragma endregion
 
 	private:
+		Float4 GetRow(int index) const
+		{
+			return Float4::Load(&data[index].x);
+		}
 
 		//Row-Major Matrix
 		Vector4 data[4]
@@ -63,4 +315,4 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
-}
\ No newline at end of file
+}
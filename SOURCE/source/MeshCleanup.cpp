@@ -0,0 +1,268 @@
+#include "MeshCleanup.h"
+#include "RaySorting.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace dae
+{
+	namespace MeshCleanup
+	{
+		//Vertices hashed on their cell, chained through m_NextInBucket. Cells that share a bucket share the chain,
+		//that only costs a few extra compares, so the buckets don't store the cell (one array read per lookup)
+		class SpatialHash final
+		{
+		public:
+			SpatialHash(float cellSize, size_t numPositions) :
+				m_CellSize{ cellSize },
+				m_BucketHeads(std::bit_ceil(std::max(numPositions, size_t(1)) * 2), -1),
+				m_NextInBucket(numPositions, -1)
+			{
+			}
+
+			//First earlier vertex that position welds to, -1 when it's the first one there
+			int Find(const std::vector<Vector3>& positions, const Vector3& position) const
+			{
+				if (m_CellSize <= 0.f)
+					return FindInCell(positions, position, GetExactKey(position));
+
+				//A vertex within the weld distance can sit in any of the neighbouring cells
+				const int64_t cellX{ GetCell(position.x) };
+				const int64_t cellY{ GetCell(position.y) };
+				const int64_t cellZ{ GetCell(position.z) };
+				int weldedIdx{ -1 };
+				for (int64_t z{ cellZ - 1 }; z <= cellZ + 1; ++z)
+				{
+					for (int64_t y{ cellY - 1 }; y <= cellY + 1; ++y)
+					{
+						for (int64_t x{ cellX - 1 }; x <= cellX + 1; ++x)
+						{
+							const int candidateIdx{ FindInCell(positions, position, GetCellKey(x, y, z)) };
+							if (candidateIdx >= 0 && (weldedIdx < 0 || candidateIdx < weldedIdx))
+								weldedIdx = candidateIdx;
+						}
+					}
+				}
+				return weldedIdx;
+			}
+
+			void Add(const Vector3& position, int vertexIdx)
+			{
+				const uint64_t key{ m_CellSize <= 0.f ? GetExactKey(position)
+					: GetCellKey(GetCell(position.x), GetCell(position.y), GetCell(position.z)) };
+
+				int& bucketHead{ m_BucketHeads[GetBucket(key)] };
+				m_NextInBucket[vertexIdx] = bucketHead;
+				bucketHead = vertexIdx;
+			}
+
+		private:
+			float m_CellSize{};
+			std::vector<int> m_BucketHeads{};
+			std::vector<int> m_NextInBucket{};
+
+			size_t GetBucket(uint64_t key) const
+			{
+				return size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & (m_BucketHeads.size() - 1);
+			}
+
+			int64_t GetCell(float value) const
+			{
+				return int64_t(std::floor(value / m_CellSize));
+			}
+
+			//21 bits per axis, cells that alias only cost a few extra distance tests
+			static uint64_t GetCellKey(int64_t x, int64_t y, int64_t z)
+			{
+				constexpr uint64_t mask{ (uint64_t(1) << 21) - 1 };
+				return (uint64_t(x) & mask) << 42 | (uint64_t(y) & mask) << 21 | (uint64_t(z) & mask);
+			}
+
+			//Bit patterns, + 0.f turns -0 into 0 so both weld
+			static uint64_t GetExactKey(const Vector3& position)
+			{
+				uint32_t bits[3]{};
+				const float values[3]{ position.x + 0.f, position.y + 0.f, position.z + 0.f };
+				std::memcpy(bits, values, sizeof(bits));
+				return (uint64_t(bits[0]) * 0x9E3779B97F4A7C15ull) ^ (uint64_t(bits[1]) * 0xC2B2AE3D27D4EB4Full) ^ uint64_t(bits[2]);
+			}
+
+			int FindInCell(const std::vector<Vector3>& positions, const Vector3& position, uint64_t key) const
+			{
+				//The chain runs from the last vertex added to the first, so the earliest match is the last one found
+				const float maxSqrDistance{ m_CellSize * m_CellSize };
+				int weldedIdx{ -1 };
+				for (int vertexIdx{ m_BucketHeads[GetBucket(key)] }; vertexIdx >= 0; vertexIdx = m_NextInBucket[vertexIdx])
+				{
+					const Vector3& candidate{ positions[vertexIdx] };
+					const bool isWelded{ m_CellSize <= 0.f
+						? candidate.x == position.x && candidate.y == position.y && candidate.z == position.z
+						: (candidate - position).SqrMagnitude() <= maxSqrDistance };
+					if (isWelded)
+						weldedIdx = vertexIdx;
+				}
+				return weldedIdx;
+			}
+		};
+
+		//Same triangle whatever corner it starts at: the smallest index first, the winding kept
+		static std::array<int, 3> GetTriangleKey(int v0, int v1, int v2)
+		{
+			if (v1 < v0 && v1 < v2)
+				return { v1, v2, v0 };
+			if (v2 < v0 && v2 < v1)
+				return { v2, v0, v1 };
+			return { v0, v1, v2 };
+		}
+
+		//Centroids quantized inside the bounds of all of them, the same 30 bit Morton code the ray sorting uses
+		static std::vector<uint32_t> GetLocalityOrder(const std::vector<Vector3>& positions, const std::vector<int>& indices)
+		{
+			const uint32_t numTriangles{ uint32_t(indices.size() / 3) };
+			std::vector<Vector3> centroids(numTriangles);
+			Vector3 boundsMin{ INFINITY, INFINITY, INFINITY };
+			Vector3 boundsMax{ -INFINITY, -INFINITY, -INFINITY };
+			for (uint32_t triangleIdx{}; triangleIdx < numTriangles; ++triangleIdx)
+			{
+				const int* pTriangle{ &indices[size_t(triangleIdx) * 3] };
+				centroids[triangleIdx] = (positions[pTriangle[0]] + positions[pTriangle[1]] + positions[pTriangle[2]]) / 3.f;
+				boundsMin = Vector3::Min(boundsMin, centroids[triangleIdx]);
+				boundsMax = Vector3::Max(boundsMax, centroids[triangleIdx]);
+			}
+			const Vector3 extent{ boundsMax - boundsMin };
+			const Vector3 scale{
+				extent.x > 0.f ? 1023.f / extent.x : 0.f,
+				extent.y > 0.f ? 1023.f / extent.y : 0.f,
+				extent.z > 0.f ? 1023.f / extent.z : 0.f };
+
+			std::vector<uint32_t> keys(numTriangles);
+			std::vector<uint32_t> order(numTriangles);
+			for (uint32_t triangleIdx{}; triangleIdx < numTriangles; ++triangleIdx)
+			{
+				const Vector3& centroid{ centroids[triangleIdx] };
+				keys[triangleIdx] =
+					RaySorting::SpreadBits(RaySorting::Quantize((centroid.x - boundsMin.x) * scale.x)) << 2 |
+					RaySorting::SpreadBits(RaySorting::Quantize((centroid.y - boundsMin.y) * scale.y)) << 1 |
+					RaySorting::SpreadBits(RaySorting::Quantize((centroid.z - boundsMin.z) * scale.z));
+				order[triangleIdx] = triangleIdx;
+			}
+			std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+			return order;
+		}
+
+		Report Clean(std::vector<Vector3>& positions, std::vector<int>& indices, const Options& options)
+		{
+			Report report{};
+
+			//Weld: every position maps to the first one it welds to
+			std::vector<int> weldedIdx(positions.size());
+			SpatialHash hash{ options.weldDistance, positions.size() };
+			for (size_t vertexIdx{}; vertexIdx < positions.size(); ++vertexIdx)
+			{
+				const int earlierIdx{ hash.Find(positions, positions[vertexIdx]) };
+				if (earlierIdx >= 0)
+				{
+					weldedIdx[vertexIdx] = weldedIdx[earlierIdx];
+					++report.numWeldedPositions;
+					continue;
+				}
+				weldedIdx[vertexIdx] = int(vertexIdx);
+				hash.Add(positions[vertexIdx], int(vertexIdx));
+			}
+
+			//Degenerate triangles: the normal TriangleMesh computes for them would be NaN
+			std::vector<int> cleanIndices{};
+			cleanIndices.reserve(indices.size());
+			for (size_t index{}; index + 2 < indices.size(); index += 3)
+			{
+				const int v0{ weldedIdx[indices[index]] };
+				const int v1{ weldedIdx[indices[index + 1]] };
+				const int v2{ weldedIdx[indices[index + 2]] };
+				const float sqrArea{ Vector3::Cross(positions[v1] - positions[v0], positions[v2] - positions[v0]).SqrMagnitude() };
+				if (v0 == v1 || v1 == v2 || v2 == v0 || !std::isnormal(sqrArea))
+				{
+					++report.numDegenerateTriangles;
+					continue;
+				}
+				cleanIndices.insert(cleanIndices.end(), { v0, v1, v2 });
+			}
+
+			//Duplicates: the kept triangles hashed on their key, chained like the spatial hash, so the first one in the file stays
+			const size_t numTriangles{ cleanIndices.size() / 3 };
+			const size_t bucketMask{ std::bit_ceil(std::max(numTriangles, size_t(1)) * 2) - 1 };
+			std::vector<int> bucketHeads(bucketMask + 1, -1);
+			std::vector<int> nextInBucket(numTriangles, -1);
+			std::vector<std::array<int, 3>> keys(numTriangles);
+			indices.clear();
+			for (size_t triangleIdx{}; triangleIdx < numTriangles; ++triangleIdx)
+			{
+				const int* pTriangle{ &cleanIndices[triangleIdx * 3] };
+				const std::array<int, 3> key{ GetTriangleKey(pTriangle[0], pTriangle[1], pTriangle[2]) };
+				const uint64_t hash{ (uint64_t(uint32_t(key[0])) * 0x9E3779B97F4A7C15ull) ^ (uint64_t(uint32_t(key[1])) * 0xC2B2AE3D27D4EB4Full) ^ uint32_t(key[2]) };
+				int& bucketHead{ bucketHeads[size_t((hash * 0x9E3779B97F4A7C15ull) >> 32) & bucketMask] };
+
+				bool isDuplicate{};
+				for (int keptIdx{ bucketHead }; keptIdx >= 0 && !isDuplicate; keptIdx = nextInBucket[keptIdx])
+					isDuplicate = keys[keptIdx] == key;
+				if (isDuplicate)
+				{
+					++report.numDuplicateTriangles;
+					continue;
+				}
+
+				keys[triangleIdx] = key;
+				nextInBucket[triangleIdx] = bucketHead;
+				bucketHead = int(triangleIdx);
+				indices.insert(indices.end(), pTriangle, pTriangle + 3);
+			}
+
+			if (options.reorderForLocality)
+			{
+				const std::vector<uint32_t> order{ GetLocalityOrder(positions, indices) };
+				cleanIndices.resize(indices.size());
+				for (size_t orderIdx{}; orderIdx < order.size(); ++orderIdx)
+					std::copy_n(&indices[size_t(order[orderIdx]) * 3], 3, &cleanIndices[orderIdx * 3]);
+				indices.swap(cleanIndices);
+			}
+
+			//Only the used positions stay, in first use order when reordering and in file order otherwise
+			std::vector<int> newIdx(positions.size(), -1);
+			int numUsedPositions{};
+			if (options.reorderForLocality)
+			{
+				for (const int index : indices)
+				{
+					if (newIdx[index] < 0)
+						newIdx[index] = numUsedPositions++;
+				}
+			}
+			else
+			{
+				for (const int index : indices)
+					newIdx[index] = 0;
+				for (int& idx : newIdx)
+				{
+					if (idx == 0)
+						idx = numUsedPositions++;
+				}
+			}
+
+			std::vector<Vector3> usedPositions(numUsedPositions);
+			for (size_t vertexIdx{}; vertexIdx < positions.size(); ++vertexIdx)
+			{
+				if (newIdx[vertexIdx] >= 0)
+					usedPositions[newIdx[vertexIdx]] = positions[vertexIdx];
+			}
+			for (int& index : indices)
+				index = newIdx[index];
+
+			report.numUnusedPositions = positions.size() - report.numWeldedPositions - usedPositions.size();
+			positions.swap(usedPositions);
+			return report;
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	//Import stage between a loader and TriangleMesh: fewer vertices and no triangles the BVH would build and test for nothing
+	namespace MeshCleanup
+	{
+		struct Options
+		{
+			//Positions closer than this become one vertex (spatial hash with cells of this size), 0 only welds identical positions
+			float weldDistance{ 0.f };
+			//Triangles sorted along a Morton curve over their centroids and vertices numbered in first use order,
+			//so triangles next to each other in space are next to each other in memory
+			bool reorderForLocality{ false };
+		};
+
+		struct Report
+		{
+			size_t numWeldedPositions{};
+			//Positions no triangle uses anymore (including the ones only degenerate or duplicate triangles used)
+			size_t numUnusedPositions{};
+			//Triangles with two corners on the same vertex or without a normal (zero, NaN or infinite area)
+			size_t numDegenerateTriangles{};
+			//Same vertices in the same winding as an earlier triangle, the opposite winding is a different triangle (back faces)
+			size_t numDuplicateTriangles{};
+		};
+
+		//Welds the positions, drops degenerate and duplicate triangles, removes the positions left unused and optionally reorders
+		//Both vectors get replaced, every 3 indices make a triangle
+		Report Clean(std::vector<Vector3>& positions, std::vector<int>& indices, const Options& options = {});
+	}
+}
@@ -0,0 +1,241 @@
+#include "MeshFile.h"
+#include "MappedFile.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+namespace dae
+{
+	namespace MeshFile
+	{
+		//The arrays are stored in the native layout, a reader with another byte order or padding would misread them
+		static_assert(std::endian::native == std::endian::little, "mesh files are little endian");
+		static_assert(sizeof(Vector3) == 12 && std::is_trivially_copyable_v<Vector3>);
+		static_assert(sizeof(BVHNode) == 36 && std::is_trivially_copyable_v<BVHNode>);
+
+		constexpr uint32_t magic{ 0x4D454144 }; //"DAEM"
+		constexpr uint32_t version{ 1 };
+		constexpr uint64_t arrayAlignment{ 64 };
+
+		struct Header
+		{
+			uint32_t magic{ MeshFile::magic };
+			uint32_t version{ MeshFile::version };
+			uint32_t numPositions{};
+			uint32_t numTriangles{};
+			//0 without a prebuilt BVH, the triangle order then isn't stored either
+			uint32_t numBVHNodes{};
+			uint32_t reserved{};
+			Vector3 minAABB{};
+			Vector3 maxAABB{};
+			//From the start of the file
+			uint64_t positionsOffset{};
+			uint64_t normalsOffset{};
+			uint64_t indicesOffset{};
+			uint64_t bvhNodesOffset{};
+			uint64_t triIdxOffset{};
+		};
+		static_assert(sizeof(Header) == 88);
+
+		static uint64_t AlignUp(uint64_t offset)
+		{
+			return (offset + arrayAlignment - 1) / arrayAlignment * arrayAlignment;
+		}
+
+		//Points array at count elements at offset, false when they don't lie inside the file
+		template<typename T>
+		static bool GetArray(const MappedFile& file, uint64_t offset, uint64_t count, std::span<const T>& array)
+		{
+			if (offset % alignof(T) != 0 || offset > file.GetSize() || count > (file.GetSize() - offset) / sizeof(T))
+				return false;
+
+			array = { reinterpret_cast<const T*>(file.GetData() + offset), size_t(count) };
+			return true;
+		}
+
+		//Every index gets checked once (no parsing, just a scan) so a corrupt file can't send the hit tests out of the arrays,
+		//into a cycle or deeper than their traversal stacks
+		static const char* Validate(const Header& header, const ExternalMeshArrays& arrays)
+		{
+			for (const int index : arrays.indices)
+			{
+				if (index < 0 || uint32_t(index) >= header.numPositions)
+					return "index outside the positions";
+			}
+
+			if (header.numBVHNodes == 0)
+				return nullptr;
+			if (header.numTriangles == 0 || header.numBVHNodes > 2 * header.numTriangles - 1)
+				return "more BVH nodes than a BVH over the triangles can have";
+			for (const int triangleIdx : arrays.triIdx)
+			{
+				if (triangleIdx < 0 || uint32_t(triangleIdx) >= header.numTriangles)
+					return "BVH triangle outside the triangles";
+			}
+			//RefitBVH walks the pool backwards, the children have to come after their parent (which also rules out cycles)
+			//That order gives every parent its depth before its children, the root is at depth 1
+			std::vector<int> depths(header.numBVHNodes);
+			depths[0] = 1;
+			for (uint32_t nodeIdx{}; nodeIdx < header.numBVHNodes; ++nodeIdx)
+			{
+				const BVHNode& node{ arrays.bvhNodes[nodeIdx] };
+				const bool isValid{ node.IsLeaf()
+					? node.firstTriIdx <= header.numTriangles && node.triCount <= header.numTriangles - node.firstTriIdx
+					: node.leftNode > nodeIdx && node.leftNode < header.numBVHNodes - 1 };
+				if (!isValid)
+					return "BVH node outside the nodes or triangles";
+				if (depths[nodeIdx] > GeometryUtils::maxTraversalDepth)
+					return "BVH deeper than the traversal stacks";
+				if (!node.IsLeaf())
+				{
+					depths[node.leftNode] = std::max(depths[node.leftNode], depths[nodeIdx] + 1);
+					depths[node.leftNode + 1] = std::max(depths[node.leftNode + 1], depths[nodeIdx] + 1);
+				}
+			}
+			return nullptr;
+		}
+
+		bool Save(const std::string& filename, const TriangleMesh& mesh)
+		{
+			const std::span<const Vector3> positions{ mesh.GetPositions() };
+			const std::span<const Vector3> normals{ mesh.GetNormals() };
+			const std::span<const int> indices{ mesh.GetIndices() };
+			const size_t numTriangles{ indices.size() / 3 };
+
+			//BuildBVH leaves unused nodes at the end of the pool, a prebuilt BVH that never got refit is still in the mapped file
+			const bool hasBVH{ !mesh.bvhNodePool.empty() || !mesh.external.bvhNodes.empty() };
+			const std::span<const BVHNode> bvhNodes{ mesh.GetBVHNodes(), hasBVH ? size_t(mesh.nodesUsed) : 0 };
+			const std::span<const int> triIdx{ mesh.GetTriIdx(), hasBVH ? numTriangles : 0 };
+			if (hasBVH && !(mesh.scaleTransform * mesh.rotationTransform * mesh.translationTransform).IsIdentity())
+			{
+				std::cout << filename << ": the BVH is built over transformed triangles, save the mesh before transforming it\n";
+				return false;
+			}
+			if (normals.size() != numTriangles)
+			{
+				std::cout << filename << ": the mesh needs one normal per triangle\n";
+				return false;
+			}
+
+			Header header{};
+			header.numPositions = uint32_t(positions.size());
+			header.numTriangles = uint32_t(numTriangles);
+			header.numBVHNodes = uint32_t(bvhNodes.size());
+			if (!positions.empty())
+			{
+				header.minAABB = positions[0];
+				header.maxAABB = positions[0];
+				for (const Vector3& position : positions)
+				{
+					header.minAABB = Vector3::Min(position, header.minAABB);
+					header.maxAABB = Vector3::Max(position, header.maxAABB);
+				}
+			}
+			header.positionsOffset = AlignUp(sizeof(Header));
+			header.normalsOffset = AlignUp(header.positionsOffset + positions.size_bytes());
+			header.indicesOffset = AlignUp(header.normalsOffset + normals.size_bytes());
+			header.bvhNodesOffset = AlignUp(header.indicesOffset + indices.size_bytes());
+			header.triIdxOffset = AlignUp(header.bvhNodesOffset + bvhNodes.size_bytes());
+
+			std::ofstream file{ filename, std::ios::binary };
+			if (!file)
+			{
+				std::cout << filename << ": can't be written\n";
+				return false;
+			}
+
+			const char padding[arrayAlignment]{};
+			const auto writeArray = [&](uint64_t offset, const void* pData, size_t numBytes)
+				{
+					file.write(padding, std::streamsize(offset - uint64_t(file.tellp())));
+					file.write(static_cast<const char*>(pData), std::streamsize(numBytes));
+				};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+			writeArray(header.positionsOffset, positions.data(), positions.size_bytes());
+			writeArray(header.normalsOffset, normals.data(), normals.size_bytes());
+			writeArray(header.indicesOffset, indices.data(), indices.size_bytes());
+			writeArray(header.bvhNodesOffset, bvhNodes.data(), bvhNodes.size_bytes());
+			writeArray(header.triIdxOffset, triIdx.data(), triIdx.size_bytes());
+
+			if (!file.flush())
+			{
+				std::cout << filename << ": can't be written\n";
+				return false;
+			}
+			return true;
+		}
+
+		bool ConvertOBJ(const std::string& objFilename, const std::string& meshFilename, bool includeBVH)
+		{
+			TriangleMesh mesh{};
+			if (!Utils::ParseOBJ(objFilename, mesh.positions, mesh.normals, mesh.indices))
+				return false;
+
+			//Default transforms, the BVH gets built over the object space triangles
+			if (includeBVH && !mesh.indices.empty())
+			{
+				mesh.UpdateAABB();
+				mesh.UpdateTransforms();
+				mesh.FillTriangleList();
+				mesh.BuildBVH();
+			}
+			return Save(meshFilename, mesh);
+		}
+
+		bool Load(const std::string& filename, TriangleMesh& mesh)
+		{
+			const auto pFile{ std::make_shared<MappedFile>() };
+			if (!pFile->Open(filename))
+			{
+				std::cout << filename << ": can't be opened (" << pFile->GetError().message() << ")\n";
+				return false;
+			}
+
+			Header header{};
+			if (pFile->GetSize() < sizeof(Header))
+			{
+				std::cout << filename << ": not a mesh file\n";
+				return false;
+			}
+			std::memcpy(&header, pFile->GetData(), sizeof(Header));
+			if (header.magic != magic)
+			{
+				std::cout << filename << ": not a mesh file\n";
+				return false;
+			}
+			if (header.version != version)
+			{
+				std::cout << filename << ": mesh file version " << header.version << ", expected " << version << '\n';
+				return false;
+			}
+
+			ExternalMeshArrays arrays{};
+			const uint64_t numTriIdx{ header.numBVHNodes > 0 ? header.numTriangles : 0 };
+			if (!GetArray(*pFile, header.positionsOffset, header.numPositions, arrays.positions)
+				|| !GetArray(*pFile, header.normalsOffset, header.numTriangles, arrays.normals)
+				|| !GetArray(*pFile, header.indicesOffset, uint64_t(header.numTriangles) * 3, arrays.indices)
+				|| !GetArray(*pFile, header.bvhNodesOffset, header.numBVHNodes, arrays.bvhNodes)
+				|| !GetArray(*pFile, header.triIdxOffset, numTriIdx, arrays.triIdx))
+			{
+				std::cout << filename << ": array outside the file\n";
+				return false;
+			}
+			if (const char* error{ Validate(header, arrays) })
+			{
+				std::cout << filename << ": " << error << '\n';
+				return false;
+			}
+
+			arrays.pOwner = pFile;
+			mesh.SetExternalArrays(std::move(arrays), header.minAABB, header.maxAABB);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Binary TriangleMesh: a header, then the object space arrays laid out exactly as they sit in memory (positions, per triangle normals,
+	//indices and optionally a prebuilt BVH with its triangle order), every array 64 byte aligned so a mapped file is used in place
+	namespace MeshFile
+	{
+		//Object space arrays of the mesh + its BVH when one is built, which needs the identity transform (the BVH has to be in object space)
+		//False when the file can't be written or the BVH is transformed, the reason gets printed then
+		bool Save(const std::string& filename, const TriangleMesh& mesh);
+
+		//Utils::ParseOBJ + optionally BuildBVH, so loading the mesh file skips both
+		bool ConvertOBJ(const std::string& objFilename, const std::string& meshFilename, bool includeBVH = true);
+
+		//Memory maps the file and points mesh.external at its arrays, nothing gets copied or parsed (the pages are shared with
+		//every other process mapping the file). The mesh then goes through UpdateTransforms, FillTriangleList and BuildBVH like
+		//a parsed one, BuildBVH costs nothing for a prebuilt BVH under the identity transform
+		//False when the file can't be read or isn't a valid mesh file, the reason gets printed then
+		bool Load(const std::string& filename, TriangleMesh& mesh);
+	}
+}
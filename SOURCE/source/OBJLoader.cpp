@@ -0,0 +1,435 @@
+#include "OBJLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <thread>
+
+namespace dae
+{
+	namespace OBJLoader
+	{
+		//Line-aligned part of the text, parsed on its own by one thread
+		//Negative indices count from the chunk's first v/vt/vn until Stitch adds the counts of the chunks before it
+		struct Chunk
+		{
+			std::string_view text{};
+			OBJData data{};
+			//Vertices whose position/texCoord/normal index was negative
+			std::vector<size_t> relativePositions{};
+			std::vector<size_t> relativeTexCoords{};
+			std::vector<size_t> relativeNormals{};
+			//Cleared by an o/g before the chunk's first face, the first group then doesn't go on with the group the chunk before ended in
+			bool continuesGroup{ true };
+			//Groups before the chunk's first o statement, they belong to the object the chunk before ended in
+			size_t numInheritingGroups{};
+			bool hasObject{};
+			size_t numLines{};
+			//Line in the chunk (1-based), 0 when it parsed fine
+			size_t errorLine{};
+		};
+
+		//Smaller texts aren't worth another thread
+		constexpr size_t minChunkSize{ size_t(1) << 20 };
+
+		//Carriage returns count as blanks so CRLF files parse the same
+		static bool IsBlank(char character)
+		{
+			return character == ' ' || character == '\t' || character == '\r';
+		}
+
+		static void SkipBlanks(const char*& p, const char* pEnd)
+		{
+			while (p < pEnd && IsBlank(*p))
+				++p;
+		}
+
+		//A number has to end at a blank or the end of the line ("1.5x" is malformed)
+		static bool IsTokenEnd(const char* p, const char* pEnd)
+		{
+			return p == pEnd || IsBlank(*p);
+		}
+
+		static bool ParseFloat(const char*& p, const char* pEnd, float& value)
+		{
+			SkipBlanks(p, pEnd);
+			//from_chars doesn't take a plus sign
+			if (p < pEnd && *p == '+')
+				++p;
+
+			const auto [pNext, error] { std::from_chars(p, pEnd, value) };
+			if (error != std::errc{} || !IsTokenEnd(pNext, pEnd))
+				return false;
+
+			p = pNext;
+			return true;
+		}
+
+		//1-based index, or negative relative to the count read so far (-1 is the last one)
+		//Negative ones can only be resolved against the chunk's own count here, Parse checks the range once the chunks are stitched
+		static bool ParseIndex(const char*& p, const char* pEnd, size_t count, int& index, bool& isRelative)
+		{
+			int value{};
+			const auto [pNext, error] { std::from_chars(p, pEnd, value) };
+			if (error != std::errc{} || value == 0)
+				return false;
+
+			isRelative = value < 0;
+			index = isRelative ? int(int64_t(count) + value) : value - 1;
+			p = pNext;
+			return true;
+		}
+
+		//Corners are v, v/vt, v//vn or v/vt/vn, a polygon becomes a fan around its first corner (0 1 2, 0 2 3, ...)
+		static bool ParseFace(const char*& p, const char* pEnd, Chunk& chunk)
+		{
+			struct Corner
+			{
+				OBJVertex vertex{};
+				bool isPositionRelative{};
+				bool isTexCoordRelative{};
+				bool isNormalRelative{};
+			};
+
+			OBJData& data{ chunk.data };
+			const auto addVertex = [&](const Corner& corner)
+				{
+					const size_t vertexIdx{ data.vertices.size() };
+					data.vertices.push_back(corner.vertex);
+					if (corner.isPositionRelative)
+						chunk.relativePositions.push_back(vertexIdx);
+					if (corner.isTexCoordRelative)
+						chunk.relativeTexCoords.push_back(vertexIdx);
+					if (corner.isNormalRelative)
+						chunk.relativeNormals.push_back(vertexIdx);
+				};
+
+			Corner firstCorner{};
+			Corner previousCorner{};
+			int numCorners{};
+
+			SkipBlanks(p, pEnd);
+			while (p < pEnd)
+			{
+				Corner corner{};
+				if (!ParseIndex(p, pEnd, data.positions.size(), corner.vertex.position, corner.isPositionRelative))
+					return false;
+
+				if (p < pEnd && *p == '/')
+				{
+					++p;
+					if (p < pEnd && *p != '/' && !ParseIndex(p, pEnd, data.texCoords.size(), corner.vertex.texCoord, corner.isTexCoordRelative))
+						return false;
+					if (p < pEnd && *p == '/')
+					{
+						++p;
+						if (!ParseIndex(p, pEnd, data.normals.size(), corner.vertex.normal, corner.isNormalRelative))
+							return false;
+					}
+				}
+				if (!IsTokenEnd(p, pEnd))
+					return false;
+
+				if (numCorners == 0)
+				{
+					firstCorner = corner;
+				}
+				else if (numCorners >= 2)
+				{
+					addVertex(firstCorner);
+					addVertex(previousCorner);
+					addVertex(corner);
+				}
+				previousCorner = corner;
+				++numCorners;
+
+				SkipBlanks(p, pEnd);
+			}
+			return numCorners >= 3;
+		}
+
+		//Rest of the line without the surrounding blanks
+		static std::string_view GetName(const char* p, const char* pEnd)
+		{
+			SkipBlanks(p, pEnd);
+			while (pEnd > p && IsBlank(pEnd[-1]))
+				--pEnd;
+			return { p, size_t(pEnd - p) };
+		}
+
+		//Triangles from here on belong to a new group, the current one just gets renamed when it has none yet
+		static void BeginGroup(Chunk& chunk, std::string_view objectName, std::string_view groupName)
+		{
+			OBJData& data{ chunk.data };
+			OBJGroup& currentGroup{ data.groups.back() };
+			currentGroup.numTriangles = data.GetNumTriangles() - currentGroup.firstTriangle;
+			if (currentGroup.numTriangles == 0)
+			{
+				if (data.groups.size() == 1)
+					chunk.continuesGroup = false;
+				currentGroup.objectName = objectName;
+				currentGroup.groupName = groupName;
+				return;
+			}
+			data.groups.push_back({ std::string{ objectName }, std::string{ groupName }, data.GetNumTriangles() });
+		}
+
+		static bool ParseLine(const char* p, const char* pEnd, Chunk& chunk)
+		{
+			SkipBlanks(p, pEnd);
+			if (p == pEnd || *p == '#')
+				return true;
+
+			const char* pKeyword{ p };
+			while (p < pEnd && !IsBlank(*p))
+				++p;
+			const std::string_view keyword{ pKeyword, size_t(p - pKeyword) };
+
+			OBJData& data{ chunk.data };
+			//A w after the position and colors after that are skipped
+			if (keyword == "v")
+			{
+				Vector3& position{ data.positions.emplace_back() };
+				return ParseFloat(p, pEnd, position.x) && ParseFloat(p, pEnd, position.y) && ParseFloat(p, pEnd, position.z);
+			}
+			if (keyword == "f")
+				return ParseFace(p, pEnd, chunk);
+			if (keyword == "vn")
+			{
+				Vector3& normal{ data.normals.emplace_back() };
+				return ParseFloat(p, pEnd, normal.x) && ParseFloat(p, pEnd, normal.y) && ParseFloat(p, pEnd, normal.z);
+			}
+			//v is optional
+			if (keyword == "vt")
+			{
+				OBJTexCoord& texCoord{ data.texCoords.emplace_back() };
+				if (!ParseFloat(p, pEnd, texCoord.u))
+					return false;
+				SkipBlanks(p, pEnd);
+				return p == pEnd || ParseFloat(p, pEnd, texCoord.v);
+			}
+			if (keyword == "o")
+			{
+				BeginGroup(chunk, GetName(p, pEnd), {});
+				if (!chunk.hasObject)
+				{
+					chunk.hasObject = true;
+					chunk.numInheritingGroups = data.groups.size() - 1;
+				}
+				return true;
+			}
+			if (keyword == "g")
+			{
+				const std::string objectName{ data.groups.back().objectName };
+				BeginGroup(chunk, objectName, GetName(p, pEnd));
+				return true;
+			}
+			return true;
+		}
+
+		//Stops at the first malformed line
+		static void ParseChunk(Chunk& chunk)
+		{
+			chunk.data.groups.emplace_back();
+
+			const char* p{ chunk.text.data() };
+			const char* const pTextEnd{ p + chunk.text.size() };
+			while (p < pTextEnd)
+			{
+				++chunk.numLines;
+				const void* pNewline{ std::memchr(p, '\n', size_t(pTextEnd - p)) };
+				const char* const pLineEnd{ pNewline ? static_cast<const char*>(pNewline) : pTextEnd };
+				if (!ParseLine(p, pLineEnd, chunk))
+				{
+					chunk.errorLine = chunk.numLines;
+					return;
+				}
+				p = pNewline ? pLineEnd + 1 : pTextEnd;
+			}
+
+			OBJGroup& lastGroup{ chunk.data.groups.back() };
+			lastGroup.numTriangles = chunk.data.GetNumTriangles() - lastGroup.firstTriangle;
+			if (!chunk.hasObject)
+				chunk.numInheritingGroups = chunk.data.groups.size();
+		}
+
+		//About numChunks equal parts, every one but the last ends right after a newline
+		static std::vector<Chunk> SplitText(std::string_view text, size_t numChunks)
+		{
+			std::vector<Chunk> chunks{};
+			size_t begin{};
+			for (size_t chunkIdx{ 1 }; chunkIdx <= numChunks && begin < text.size(); ++chunkIdx)
+			{
+				size_t end{ text.size() };
+				if (chunkIdx < numChunks)
+				{
+					end = text.find('\n', std::max(begin, text.size() / numChunks * chunkIdx));
+					end = end == std::string_view::npos ? text.size() : end + 1;
+				}
+				chunks.emplace_back().text = text.substr(begin, end - begin);
+				begin = end;
+			}
+			return chunks;
+		}
+
+		//Moves the arrays of a chunk to their offsets in data (the prefix sums of the chunks before it) and rebases its negative indices
+		//False when an index of the chunk points outside the final arrays
+		static bool CopyChunk(const Chunk& chunk, OBJData& data, size_t firstPosition, size_t firstTexCoord, size_t firstNormal, size_t firstVertex)
+		{
+			std::copy(chunk.data.positions.begin(), chunk.data.positions.end(), data.positions.begin() + firstPosition);
+			std::copy(chunk.data.texCoords.begin(), chunk.data.texCoords.end(), data.texCoords.begin() + firstTexCoord);
+			std::copy(chunk.data.normals.begin(), chunk.data.normals.end(), data.normals.begin() + firstNormal);
+
+			OBJVertex* pVertices{ data.vertices.data() + firstVertex };
+			std::copy(chunk.data.vertices.begin(), chunk.data.vertices.end(), pVertices);
+			for (const size_t vertexIdx : chunk.relativePositions)
+				pVertices[vertexIdx].position += int(firstPosition);
+			//A relative vt/vn before enough of them resolves to -1 or lower, -1 would pass for an absent one below
+			for (const size_t vertexIdx : chunk.relativeTexCoords)
+			{
+				pVertices[vertexIdx].texCoord += int(firstTexCoord);
+				if (pVertices[vertexIdx].texCoord < 0)
+					return false;
+			}
+			for (const size_t vertexIdx : chunk.relativeNormals)
+			{
+				pVertices[vertexIdx].normal += int(firstNormal);
+				if (pVertices[vertexIdx].normal < 0)
+					return false;
+			}
+
+			for (size_t vertexIdx{}; vertexIdx < chunk.data.vertices.size(); ++vertexIdx)
+			{
+				const OBJVertex& vertex{ pVertices[vertexIdx] };
+				if (size_t(vertex.position) >= data.positions.size()
+					|| (vertex.texCoord != -1 && size_t(vertex.texCoord) >= data.texCoords.size())
+					|| (vertex.normal != -1 && size_t(vertex.normal) >= data.normals.size()))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		//Joins the groups in file order, a chunk's first group goes on with the last one of the chunk before unless an o/g started a new one
+		static void StitchGroups(std::vector<Chunk>& chunks, OBJData& data)
+		{
+			size_t firstTriangle{};
+			for (Chunk& chunk : chunks)
+			{
+				for (size_t groupIdx{}; groupIdx < chunk.data.groups.size(); ++groupIdx)
+				{
+					OBJGroup& group{ chunk.data.groups[groupIdx] };
+					group.firstTriangle += firstTriangle;
+					if (groupIdx < chunk.numInheritingGroups)
+						group.objectName = data.groups.empty() ? std::string{} : data.groups.back().objectName;
+
+					if (data.groups.empty())
+						data.groups.push_back(std::move(group));
+					else if (groupIdx == 0 && chunk.continuesGroup)
+						data.groups.back().numTriangles += group.numTriangles;
+					else if (data.groups.back().numTriangles == 0)
+						data.groups.back() = std::move(group);
+					else
+						data.groups.push_back(std::move(group));
+				}
+				firstTriangle += chunk.data.GetNumTriangles();
+			}
+
+			if (!data.groups.empty() && data.groups.back().numTriangles == 0)
+				data.groups.pop_back();
+		}
+
+		bool Parse(std::string_view text, OBJData& data, std::string* pError, unsigned int numThreads)
+		{
+			data = {};
+
+			if (numThreads == 0)
+				numThreads = std::max(1u, std::thread::hardware_concurrency());
+			std::vector<Chunk> chunks{ SplitText(text, std::clamp(text.size() / minChunkSize, size_t(1), size_t(numThreads))) };
+
+			//The calling thread parses the first chunk itself
+			std::vector<std::future<void>> futures{};
+			for (size_t chunkIdx{ 1 }; chunkIdx < chunks.size(); ++chunkIdx)
+				futures.push_back(std::async(std::launch::async, [&chunk = chunks[chunkIdx]] { ParseChunk(chunk); }));
+			if (!chunks.empty())
+				ParseChunk(chunks.front());
+			for (const std::future<void>& future : futures)
+				future.wait();
+
+			//Prefix sums of the counts are where every chunk's arrays go
+			size_t numLines{};
+			size_t numPositions{}, numTexCoords{}, numNormals{}, numVertices{};
+			std::vector<size_t> offsets(chunks.size() * 4);
+			for (size_t chunkIdx{}; chunkIdx < chunks.size(); ++chunkIdx)
+			{
+				const Chunk& chunk{ chunks[chunkIdx] };
+				if (chunk.errorLine != 0)
+				{
+					if (pError)
+						*pError = "line " + std::to_string(numLines + chunk.errorLine) + ": malformed statement";
+					return false;
+				}
+
+				offsets[chunkIdx * 4] = numPositions;
+				offsets[chunkIdx * 4 + 1] = numTexCoords;
+				offsets[chunkIdx * 4 + 2] = numNormals;
+				offsets[chunkIdx * 4 + 3] = numVertices;
+				numLines += chunk.numLines;
+				numPositions += chunk.data.positions.size();
+				numTexCoords += chunk.data.texCoords.size();
+				numNormals += chunk.data.normals.size();
+				numVertices += chunk.data.vertices.size();
+			}
+
+			data.positions.resize(numPositions);
+			data.texCoords.resize(numTexCoords);
+			data.normals.resize(numNormals);
+			data.vertices.resize(numVertices);
+
+			std::vector<std::future<bool>> copyFutures{};
+			for (size_t chunkIdx{ 1 }; chunkIdx < chunks.size(); ++chunkIdx)
+			{
+				copyFutures.push_back(std::async(std::launch::async, [&, chunkIdx]
+					{
+						const size_t* pOffsets{ &offsets[chunkIdx * 4] };
+						return CopyChunk(chunks[chunkIdx], data, pOffsets[0], pOffsets[1], pOffsets[2], pOffsets[3]);
+					}));
+			}
+			bool isInRange{ chunks.empty() || CopyChunk(chunks.front(), data, 0, 0, 0, 0) };
+			for (std::future<bool>& future : copyFutures)
+				isInRange = future.get() && isInRange;
+
+			if (!isInRange)
+			{
+				if (pError)
+					*pError = "face index outside the v/vt/vn of the file";
+				return false;
+			}
+
+			StitchGroups(chunks, data);
+			return true;
+		}
+
+		bool Load(const std::string& filename, OBJData& data)
+		{
+			MappedFile file{};
+			if (!file.Open(filename))
+			{
+				std::cout << filename << ": can't be opened (" << file.GetError().message() << ")\n";
+				return false;
+			}
+
+			std::string error{};
+			if (!Parse({ file.GetData(), file.GetSize() }, data, &error))
+			{
+				std::cout << filename << ": " << error << '\n';
+				return false;
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	//One corner of a face: zero-based indices into the OBJData arrays, -1 for the attributes the face leaves out
+	struct OBJVertex
+	{
+		int position{ -1 };
+		int texCoord{ -1 };
+		int normal{ -1 };
+	};
+
+	struct OBJTexCoord
+	{
+		float u{};
+		float v{};
+	};
+
+	//Triangles between two o/g statements, the names are empty before the first one
+	struct OBJGroup
+	{
+		std::string objectName{};
+		std::string groupName{};
+		size_t firstTriangle{};
+		size_t numTriangles{};
+	};
+
+	//Geometry of an OBJ file, polygons are fan triangulated so every 3 vertices make a triangle
+	struct OBJData
+	{
+		std::vector<Vector3> positions{};
+		std::vector<OBJTexCoord> texCoords{};
+		std::vector<Vector3> normals{};
+		std::vector<OBJVertex> vertices{};
+		//Only groups with triangles, in file order
+		std::vector<OBJGroup> groups{};
+
+		size_t GetNumTriangles() const { return vertices.size() / 3; }
+	};
+
+	namespace OBJLoader
+	{
+		//Memory maps the file and parses it in place (v, vt, vn, f with v/vt/vn tuples and negative indices, o and g)
+		//Materials, smoothing groups, lines and points are skipped
+		//False when the file can't be read or doesn't parse, the reason gets printed then
+		bool Load(const std::string& filename, OBJData& data);
+
+		//Same for OBJ text already in memory, pError receives the reason on failure ("line 12: malformed statement")
+		//Large texts are split into line-aligned chunks parsed on numThreads threads (0: every core), the result doesn't depend on the count
+		bool Parse(std::string_view text, OBJData& data, std::string* pError = nullptr, unsigned int numThreads = 0);
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Reorders incoherent rays (bounces, random directions) so rays traced one after the other visit the same BVH nodes
+	//Key = direction octant in the top 3 bits, then a 30 bit Morton code of the origin quantized inside the bounds of all origins
+	namespace RaySorting
+	{
+		static constexpr int numKeyBits{ 33 };
+		static constexpr int numRadixBits{ 11 };
+		static constexpr uint32_t numBuckets{ 1u << numRadixBits };
+
+		//Spreads the lower 10 bits of value so there are 2 zero bits between every bit
+		inline uint32_t SpreadBits(uint32_t value)
+		{
+			value &= 0x3ff;
+			value = (value | (value << 16)) & 0x030000ff;
+			value = (value | (value << 8)) & 0x0300f00f;
+			value = (value | (value << 4)) & 0x030c30c3;
+			value = (value | (value << 2)) & 0x09249249;
+			return value;
+		}
+
+		//Origin scaled to [0, 1023] per axis, NaN and out of bounds values are clamped
+		inline uint32_t Quantize(float value)
+		{
+			return uint32_t(value > 0.f ? std::min(value, 1023.f) : 0.f);
+		}
+
+		inline uint64_t GetKey(const Ray& ray, const Vector3& boundsMin, const Vector3& scale)
+		{
+			const uint32_t morton{
+				SpreadBits(Quantize((ray.origin.x - boundsMin.x) * scale.x)) << 2 |
+				SpreadBits(Quantize((ray.origin.y - boundsMin.y) * scale.y)) << 1 |
+				SpreadBits(Quantize((ray.origin.z - boundsMin.z) * scale.z)) };
+
+			const uint32_t octant{
+				uint32_t(ray.direction.x < 0.f) << 2 |
+				uint32_t(ray.direction.y < 0.f) << 1 |
+				uint32_t(ray.direction.z < 0.f) };
+
+			return uint64_t(octant) << 30 | morton;
+		}
+
+		/**
+		 * \brief Computes the sorted order of a set of rays, the rays themselves are left untouched
+		 * \param rays Rays to sort
+		 * \param order Filled with an index into rays per ray, in sorted order
+		 */
+		inline void GetSortedOrder(const std::vector<Ray>& rays, std::vector<uint32_t>& order)
+		{
+			const uint32_t numRays{ uint32_t(rays.size()) };
+			order.resize(numRays);
+			if (numRays == 0)
+				return;
+
+			//Bounds of the origins, so the Morton code uses its full resolution whatever the scene size
+			Vector3 boundsMin{ rays.front().origin };
+			Vector3 boundsMax{ rays.front().origin };
+			for (const Ray& ray : rays)
+			{
+				boundsMin = Vector3::Min(boundsMin, ray.origin);
+				boundsMax = Vector3::Max(boundsMax, ray.origin);
+			}
+			const Vector3 extent{ boundsMax - boundsMin };
+			const Vector3 scale{
+				extent.x > 0.f ? 1023.f / extent.x : 0.f,
+				extent.y > 0.f ? 1023.f / extent.y : 0.f,
+				extent.z > 0.f ? 1023.f / extent.z : 0.f };
+
+			std::vector<uint64_t> keys(numRays);
+			for (uint32_t i{}; i < numRays; ++i)
+			{
+				keys[i] = GetKey(rays[i], boundsMin, scale);
+				order[i] = i;
+			}
+
+			//LSD radix sort, 3 passes of 11 bits, stable so equal keys keep their original order
+			std::vector<uint64_t> sortedKeys(numRays);
+			std::vector<uint32_t> sortedOrder(numRays);
+			std::vector<uint32_t> offsets(numBuckets);
+			for (int shift{}; shift < numKeyBits; shift += numRadixBits)
+			{
+				std::fill(offsets.begin(), offsets.end(), 0);
+				for (const uint64_t key : keys)
+					++offsets[(key >> shift) & (numBuckets - 1)];
+
+				uint32_t sum{};
+				for (uint32_t& offset : offsets)
+				{
+					const uint32_t count{ offset };
+					offset = sum;
+					sum += count;
+				}
+
+				for (uint32_t i{}; i < numRays; ++i)
+				{
+					const uint32_t destination{ offsets[(keys[i] >> shift) & (numBuckets - 1)]++ };
+					sortedKeys[destination] = keys[i];
+					sortedOrder[destination] = order[i];
+				}
+				keys.swap(sortedKeys);
+				order.swap(sortedOrder);
+			}
+		}
+
+		//Sorts the rays in place
+		inline void SortRays(std::vector<Ray>& rays)
+		{
+			std::vector<uint32_t> order{};
+			GetSortedOrder(rays, order);
+
+			std::vector<Ray> sortedRays{};
+			sortedRays.reserve(rays.size());
+			for (const uint32_t rayIdx : order)
+				sortedRays.push_back(rays[rayIdx]);
+			rays.swap(sortedRays);
+		}
+	}
+}
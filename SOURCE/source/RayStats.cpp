@@ -0,0 +1,51 @@
+#include "RayStats.h"
+
+#if defined(RAY_STATS)
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dae
+{
+	namespace RayStats
+	{
+		static std::mutex g_RegistryMutex{};
+		static std::vector<std::unique_ptr<ThreadCounters>> g_ThreadCounters{};
+		static RayCounters g_FrameCounters{};
+
+		ThreadCounters* RegisterThread()
+		{
+			const std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+			g_ThreadCounters.push_back(std::make_unique<ThreadCounters>());
+			return g_ThreadCounters.back().get();
+		}
+
+		void MergeFrame()
+		{
+			const std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+
+			g_FrameCounters = {};
+			for (const auto& pCounters : g_ThreadCounters)
+			{
+				g_FrameCounters += *pCounters;
+				static_cast<RayCounters&>(*pCounters) = {};
+			}
+		}
+
+		const RayCounters& GetFrameCounters()
+		{
+			return g_FrameCounters;
+		}
+
+		void Print(std::ostream& stream, const RayCounters& counters)
+		{
+			stream << "   primary rays: " << counters.primaryRays
+				<< " | shadow rays: " << counters.shadowRays
+				<< " | BVH nodes: " << counters.nodesVisited
+				<< " | slab tests: " << counters.slabTests
+				<< " | triangle tests: " << counters.triangleTests
+				<< " | hits: " << counters.hits << std::endl;
+		}
+	}
+}
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+
+//Uncomment to count rays and traversal work per frame (printed alongside the dFPS)
+//Keep this disabled for production builds, the counters and every RAY_STATS_INC then compile away completely
+//#define RAY_STATS
+
+#if defined(RAY_STATS)
+#define RAY_STATS_INC(counter) (++::dae::RayStats::GetThreadCounters().counter)
+#else
+#define RAY_STATS_INC(counter) ((void)0)
+#endif
+
+#if defined(RAY_STATS)
+namespace dae
+{
+	struct RayCounters
+	{
+		uint64_t primaryRays{};
+		uint64_t shadowRays{};
+		uint64_t nodesVisited{};
+		uint64_t slabTests{};
+		uint64_t triangleTests{};
+		uint64_t hits{};
+
+		RayCounters& operator+=(const RayCounters& c)
+		{
+			primaryRays += c.primaryRays;
+			shadowRays += c.shadowRays;
+			nodesVisited += c.nodesVisited;
+			slabTests += c.slabTests;
+			triangleTests += c.triangleTests;
+			hits += c.hits;
+
+			return *this;
+		}
+	};
+
+	namespace RayStats
+	{
+		//Every thread gets its own cache line, so workers never write to a line another worker is using (false sharing)
+		struct alignas(64) ThreadCounters : RayCounters
+		{
+		};
+
+		//Allocates the counters for the calling thread, only happens once per thread
+		ThreadCounters* RegisterThread();
+
+		inline RayCounters& GetThreadCounters()
+		{
+			thread_local ThreadCounters* pCounters{ RegisterThread() };
+			return *pCounters;
+		}
+
+		//Sums the counters of every thread into the frame totals and resets them, call when all workers are done
+		void MergeFrame();
+
+		//Totals of the last merged frame
+		const RayCounters& GetFrameCounters();
+
+		void Print(std::ostream& stream, const RayCounters& counters);
+	}
+}
+#endif
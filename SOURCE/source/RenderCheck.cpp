@@ -0,0 +1,256 @@
+#include "RenderCheck.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "FastMath.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dae
+{
+	namespace RenderCheck
+	{
+		//Resolution of the main window
+		static constexpr int g_Width{ 640 };
+		static constexpr int g_Height{ 480 };
+
+		//Share of the pixels that may be more than 1 LSB apart in any channel
+		//Away from edges the approximations stay below 1 LSB: rsqrt + Newton is a few ulps off and the fast pow 2e-3 relative,
+		//which is half a step of 255. Only discrete changes go further: a ray that hits or misses a sphere's silhouette or
+		//passes a shadow edge on the other side, the fast Phong dropping its highlight where the reflection cosine is negative
+		//(powf's sign depends on the exponent there) and in BRDF mode, which isn't weighted by the observed area, Cook-Torrance's
+		//1 / (4 * n.v * n.l) blowing the ulps up where the light grazes a surface. Those pixels depend on the compiler and the
+		//CPU, the bounds are 10x the most measured with GCC on x86-64 (0.007% Combined on W3, 0.4% BRDF on W3 and the reference)
+		static constexpr double g_MaxOffPixelsCombined{ 7e-4 };
+		static constexpr double g_MaxOffPixelsBRDF{ 4e-2 };
+
+		//Start of the file, bump the version when its layout changes
+		static constexpr uint32_t g_FileMagic{ 0x4B484352 }; //"RCHK"
+		static constexpr uint32_t g_FileVersion{ 1 };
+
+		struct Render
+		{
+			std::string name{};
+			Renderer::LightingMode lightingMode{};
+			//Red, green and blue of every pixel, row by row
+			std::vector<uint8_t> channels{};
+		};
+
+		template<typename SceneType>
+		static std::unique_ptr<Scene> CreateScene()
+		{
+			std::unique_ptr<Scene> pScene{ std::make_unique<SceneType>() };
+			pScene->Initialize();
+			return pScene;
+		}
+
+		//Every scene as Initialize leaves it (the animated ones at time 0), in the renderer's default path
+		static std::vector<Render> RenderScenes()
+		{
+			const std::pair<const char*, std::unique_ptr<Scene>(*)()> scenes[]{
+				{ "W1", &CreateScene<Scene_W1> },
+				{ "W2", &CreateScene<Scene_W2> },
+				{ "W3 test", &CreateScene<Scene_W3_TestScene> },
+				{ "W3", &CreateScene<Scene_W3> },
+				{ "W4 bunny", &CreateScene<Scene_W4_BunnyScene> },
+				{ "W4 reference", &CreateScene<Scene_W4_ReferenceScene> },
+				{ "W4 extra", &CreateScene<Scene_W4_ExtraScene> },
+				{ "W4 instancing", &CreateScene<Scene_W4_InstancingScene> } };
+			const std::pair<const char*, Renderer::LightingMode> lightingModes[]{
+				{ "combined", Renderer::LightingMode::Combined },
+				{ "BRDF", Renderer::LightingMode::BRDF } };
+
+			std::vector<Render> renders{};
+			Renderer renderer{ g_Width, g_Height };
+			for (const auto& [sceneName, createScene] : scenes)
+			{
+				const std::unique_ptr<Scene> pScene{ createScene() };
+				for (const auto& [modeName, lightingMode] : lightingModes)
+				{
+					renderer.SetLightingMode(lightingMode);
+					renderer.Render(pScene.get());
+
+					Render& render{ renders.emplace_back() };
+					render.name = std::string{ sceneName } + ' ' + modeName;
+					render.lightingMode = lightingMode;
+
+					const PixelFormat& format{ renderer.GetPixelFormat() };
+					const size_t numPixels{ size_t(renderer.GetWidth()) * renderer.GetHeight() };
+					render.channels.reserve(3 * numPixels);
+					for (size_t pixelIdx{}; pixelIdx < numPixels; ++pixelIdx)
+					{
+						const uint32_t pixel{ renderer.GetPixels()[pixelIdx] };
+						render.channels.push_back(static_cast<uint8_t>(pixel >> format.redShift));
+						render.channels.push_back(static_cast<uint8_t>(pixel >> format.greenShift));
+						render.channels.push_back(static_cast<uint8_t>(pixel >> format.blueShift));
+					}
+				}
+			}
+			return renders;
+		}
+
+		static std::string GetFilename(bool isFastMath)
+		{
+			return isFastMath ? "render_check_fast_math.bin" : "render_check_exact.bin";
+		}
+
+		static void WriteUInt(std::ostream& stream, uint32_t value)
+		{
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+		}
+
+		static bool ReadUInt(std::istream& stream, uint32_t& value)
+		{
+			return bool(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+		}
+
+		//Header (magic, version, math mode, resolution, number of renders), then the name and channels of every render
+		static void SaveRenders(const std::string& filename, bool isFastMath, const std::vector<Render>& renders)
+		{
+			std::ofstream fileStream{ filename, std::ios::binary };
+			WriteUInt(fileStream, g_FileMagic);
+			WriteUInt(fileStream, g_FileVersion);
+			WriteUInt(fileStream, isFastMath);
+			WriteUInt(fileStream, g_Width);
+			WriteUInt(fileStream, g_Height);
+			WriteUInt(fileStream, uint32_t(renders.size()));
+			for (const Render& render : renders)
+			{
+				WriteUInt(fileStream, uint32_t(render.name.size()));
+				fileStream.write(render.name.data(), render.name.size());
+				fileStream.write(reinterpret_cast<const char*>(render.channels.data()), render.channels.size());
+			}
+		}
+
+		//The channels of every render the other math mode saved, in the same order as renders
+		//False with the reason when the file is from another version, the same math mode, other scenes or is cut short
+		static bool LoadRenders(std::istream& fileStream, bool isFastMath, const std::vector<Render>& renders, std::vector<std::vector<uint8_t>>& otherChannels, std::string& error)
+		{
+			uint32_t magic{}, version{}, isOtherFastMath{}, width{}, height{}, numRenders{};
+			if (!ReadUInt(fileStream, magic) || !ReadUInt(fileStream, version) || !ReadUInt(fileStream, isOtherFastMath)
+				|| !ReadUInt(fileStream, width) || !ReadUInt(fileStream, height) || !ReadUInt(fileStream, numRenders))
+			{
+				error = "header cut short";
+				return false;
+			}
+			if (magic != g_FileMagic || version != g_FileVersion)
+			{
+				error = "not a render check file of this version";
+				return false;
+			}
+			if (bool(isOtherFastMath) == isFastMath)
+			{
+				error = "saved by the same math mode";
+				return false;
+			}
+			if (width != g_Width || height != g_Height || numRenders != renders.size())
+			{
+				error = std::to_string(numRenders) + " renders of " + std::to_string(width) + "x" + std::to_string(height)
+					+ " instead of " + std::to_string(renders.size()) + " of " + std::to_string(g_Width) + "x" + std::to_string(g_Height);
+				return false;
+			}
+
+			otherChannels.resize(renders.size());
+			for (size_t renderIdx{}; renderIdx < renders.size(); ++renderIdx)
+			{
+				const Render& render{ renders[renderIdx] };
+				uint32_t nameSize{};
+				std::string name{};
+				if (ReadUInt(fileStream, nameSize) && nameSize == render.name.size())
+				{
+					name.resize(nameSize);
+					fileStream.read(name.data(), nameSize);
+				}
+				if (!fileStream || name != render.name)
+				{
+					error = "render " + std::to_string(renderIdx) + " isn't " + render.name;
+					return false;
+				}
+
+				otherChannels[renderIdx].resize(render.channels.size());
+				if (!fileStream.read(reinterpret_cast<char*>(otherChannels[renderIdx].data()), otherChannels[renderIdx].size()))
+				{
+					error = render.name + " cut short";
+					return false;
+				}
+			}
+			if (fileStream.peek() != std::char_traits<char>::eof())
+			{
+				error = "data after the last render";
+				return false;
+			}
+			return true;
+		}
+
+		//Pixels with a channel more than 1 LSB apart
+		static size_t CountOffPixels(const std::vector<uint8_t>& reference, const std::vector<uint8_t>& variant)
+		{
+			size_t numOffPixels{};
+			for (size_t idx{}; idx < reference.size(); idx += 3)
+			{
+				bool isOff{};
+				for (size_t channel{}; channel < 3; ++channel)
+					isOff |= std::abs(int(reference[idx + channel]) - int(variant[idx + channel])) > 1;
+				numOffPixels += isOff;
+			}
+			return numOffPixels;
+		}
+
+		bool Run(std::ostream& stream)
+		{
+#if defined(FAST_MATH)
+			constexpr bool isFastMath{ true };
+#else
+			constexpr bool isFastMath{ false };
+#endif
+			const std::string filename{ GetFilename(isFastMath) };
+			const std::string otherFilename{ GetFilename(!isFastMath) };
+
+			const std::vector<Render> renders{ RenderScenes() };
+			SaveRenders(filename, isFastMath, renders);
+			stream << "Saved " << renders.size() << " renders to " << filename << '\n';
+
+			std::ifstream otherStream{ otherFilename, std::ios::binary };
+			if (!otherStream)
+			{
+				stream << "No " << otherFilename << " to compare them with yet, build " << (isFastMath ? "without" : "with")
+					<< " FAST_MATH and run --render-check again\n";
+				return true;
+			}
+
+			std::vector<std::vector<uint8_t>> otherChannels{};
+			std::string error{};
+			if (!LoadRenders(otherStream, isFastMath, renders, otherChannels, error))
+			{
+				stream << ">> " << otherFilename << ": MISMATCH (" << error << "), run --render-check in the other math mode again\n";
+				return false;
+			}
+
+			//Exact math is the reference, whichever of the two builds runs
+			bool allMatched{ true };
+			for (size_t renderIdx{}; renderIdx < renders.size(); ++renderIdx)
+			{
+				const Render& render{ renders[renderIdx] };
+				const std::vector<uint8_t>& exactChannels{ isFastMath ? otherChannels[renderIdx] : render.channels };
+				const std::vector<uint8_t>& fastChannels{ isFastMath ? render.channels : otherChannels[renderIdx] };
+
+				const size_t numPixels{ render.channels.size() / 3 };
+				const size_t numOffPixels{ CountOffPixels(exactChannels, fastChannels) };
+				const double maxOffPixels{ render.lightingMode == Renderer::LightingMode::BRDF ? g_MaxOffPixelsBRDF : g_MaxOffPixelsCombined };
+				const size_t maxNumOffPixels{ size_t(maxOffPixels * double(numPixels)) };
+
+				const bool isMatched{ numOffPixels <= maxNumOffPixels };
+				allMatched &= isMatched;
+				stream << ">> exact math vs fast math (" << render.name << "): " << (isMatched ? "OK" : "MISMATCH")
+					<< " (" << numOffPixels << " of " << numPixels << " pixels over 1 LSB, at most " << maxNumOffPixels << ")\n";
+			}
+			return allMatched;
+		}
+	}
+}
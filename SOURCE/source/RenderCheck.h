@@ -0,0 +1,16 @@
+#pragma once
+#include <iosfwd>
+
+namespace dae
+{
+	//Exact against FAST_MATH (FastMath.h) renders of every scene, in Combined and BRDF mode, without a window
+	//FAST_MATH changes inline functions all the way down to Vector3::Normalize, so one program can't hold both versions of the
+	//renderer: every build saves its renders to a file and compares them against the file the other math mode saved
+	namespace RenderCheck
+	{
+		//Renders the scenes through an offscreen Renderer and saves them (render_check_exact.bin or render_check_fast_math.bin)
+		//False when the other math mode's file doesn't match these scenes, is cut short, or too many of its pixels are off
+		//Without that file there is nothing to compare yet, the output says so
+		bool Run(std::ostream& stream);
+	}
+}
@@ -9,10 +9,38 @@
 #include "Material.h"
 #include "Scene.h"
 #include "Utils.h"
+#include "RaySorting.h"
+#include "RayStats.h"
+#include "Timer.h"
+#include "Tracer.h"
 
+#include <algorithm>
 #include <future> //async
+#include <iostream>
 #include <ppl.h> //parallel_for
 using namespace dae;
+
+//Blue > Cyan > Green > Yellow > Red false color ramp, value in [0,1]
+static ColorRGB GetHeatmapColor(float value)
+{
+	static const ColorRGB ramp[]{ colors::Blue, colors::Cyan, colors::Green, colors::Yellow, colors::Red };
+	constexpr int numSegments{ 4 };
+
+	const float scaledValue{ std::clamp(value, 0.f, 1.f) * numSegments };
+	const int segment{ std::min(int(scaledValue), numSegments - 1) };
+
+	return ColorRGB::Lerp(ramp[segment], ramp[segment + 1], scaledValue - float(segment));
+}
+
+//numMasks visibility masks with every bit set, in scratch of the calling thread: it grows to the largest light count once
+//and every packet or tile after that reuses it without going to the heap. Valid until the thread's next call
+static uint64_t* GetVisibilityMasks(size_t numMasks)
+{
+	thread_local std::vector<uint64_t> visibilityMasks{};
+	visibilityMasks.assign(numMasks, ~uint64_t{});
+	return visibilityMasks.data();
+}
+
 //#define ASYNC
 #define PARALLEL_FOR
 Renderer::Renderer(SDL_Window* pWindow) :
@@ -23,6 +51,36 @@ Renderer::Renderer(SDL_Window* pWindow) :
 	//Initialize
 	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
 	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+
+	//The conversion kernels only write 8 bit channels into 32 bit pixels
+	const SDL_PixelFormat* pFormat{ m_pBuffer->format };
+	assert(pFormat->BytesPerPixel == 4 && pFormat->Rloss == 0 && pFormat->Gloss == 0 && pFormat->Bloss == 0);
+	m_PixelFormat = { pFormat->Rshift, pFormat->Gshift, pFormat->Bshift, pFormat->Amask };
+
+	const size_t numPixels{ size_t(m_Width) * m_Height };
+	m_RedBuffer.resize(numPixels);
+	m_GreenBuffer.resize(numPixels);
+	m_BlueBuffer.resize(numPixels);
+
+	m_NumTilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+	m_NumTilesY = (m_Height + m_TileSize - 1) / m_TileSize;
+}
+
+Renderer::Renderer(int width, int height) :
+	m_PixelFormat{ 16, 8, 0, 0xFF000000 },
+	m_OffscreenPixels(size_t(width) * height),
+	m_Width(width),
+	m_Height(height)
+{
+	m_pBufferPixels = m_OffscreenPixels.data();
+
+	const size_t numPixels{ size_t(m_Width) * m_Height };
+	m_RedBuffer.resize(numPixels);
+	m_GreenBuffer.resize(numPixels);
+	m_BlueBuffer.resize(numPixels);
+
+	m_NumTilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+	m_NumTilesY = (m_Height + m_TileSize - 1) / m_TileSize;
 }
 
 void Renderer::Render(Scene* pScene)
@@ -33,10 +91,60 @@ void Renderer::Render(Scene* pScene)
 	const float aspectRatio{ float(m_Width) / float(m_Height) };
 	const float fov{ tanf(camera.fovAngle * TO_RADIANS / 2.0f) };
 
-	auto& materials = pScene->GetMaterials();
+	auto& materials = pScene->GetMaterialTable();
 	auto& lights = pScene->GetLights();
 
+	//Same order as LightingMode, shadows make no difference for the heatmap
+	static constexpr RenderFrameFunction renderFrameFunctions[][2]{
+		{ &Renderer::RenderFrame<LightingMode::ObservedArea, false>, &Renderer::RenderFrame<LightingMode::ObservedArea, true> },
+		{ &Renderer::RenderFrame<LightingMode::Radiance, false>, &Renderer::RenderFrame<LightingMode::Radiance, true> },
+		{ &Renderer::RenderFrame<LightingMode::BRDF, false>, &Renderer::RenderFrame<LightingMode::BRDF, true> },
+		{ &Renderer::RenderFrame<LightingMode::Combined, false>, &Renderer::RenderFrame<LightingMode::Combined, true> },
+		{ &Renderer::RenderFrame<LightingMode::Heatmap, false>, &Renderer::RenderFrame<LightingMode::Heatmap, false> }
+	};
+	(this->*renderFrameFunctions[int(m_CurrentLightingMode)][m_ShadowsEnabled])(pScene, fov, aspectRatio, camera, lights, materials);
+
+#if defined(RAY_STATS)
+	//All workers are done, gather their counters
+	RayStats::MergeFrame();
+#endif
+
+	{
+		Tracer::ScopedEvent traceEvent{ "ConvertColors" };
+		Kernels::Get().convertColors(m_RedBuffer.data(), m_GreenBuffer.data(), m_BlueBuffer.data(), m_pBufferPixels, m_RedBuffer.size(), m_PixelFormat);
+	}
+
+	if (m_CurrentLightingMode == LightingMode::Heatmap)
+		DrawHeatmapLegend();
+
+	//@END
+	//Update SDL Surface
+	if (!m_pWindow)
+		return;
+	Timer::ScopedZone zone{ TimerZone::SurfacePresent };
+	SDL_UpdateWindowSurface(m_pWindow);
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void dae::Renderer::RenderFrame(Scene* pScene, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials)
+{
+	//The heatmap needs the traversal cost of every single ray
+	if constexpr (lightingMode != LightingMode::Heatmap)
+	{
+		if (m_WavefrontEnabled)
+		{
+			RenderWavefront<lightingMode, shadowsEnabled>(pScene, fov, aspectRatio, camera, lights, materials);
+			return;
+		}
+	}
+	RenderTiles<lightingMode, shadowsEnabled>(pScene, fov, aspectRatio, camera, lights, materials);
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void dae::Renderer::RenderTiles(Scene* pScene, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials)
+{
 	const uint32_t numPixels = m_Width * m_Height;
+	const uint32_t numTiles = m_NumTilesX * m_NumTilesY;
 
 #if defined(ASYNC)
 	const uint32_t numCores = std::thread::hardware_concurrency();
@@ -57,10 +165,11 @@ void Renderer::Render(Scene* pScene)
 		async_futures.push_back(std::async(std::launch::async, [=, this]
 			{
 				//Render all pixels for this task (currPixelIndex > currPixelIndex + taskSize)
+				Tracer::ScopedEvent traceEvent{ "Pixels", "first", int32_t(currPixelIndex), "count", int32_t(taskSize) };
 				const uint32_t pixelIndexEnd = currPixelIndex + taskSize;
 				for (uint32_t pixelIndex{ currPixelIndex }; pixelIndex < pixelIndexEnd; ++pixelIndex)
 				{
-					RenderPixel(pScene, pixelIndex, fov, aspectRatio, camera, lights, materials);
+					RenderPixel<lightingMode, shadowsEnabled>(pScene, pixelIndex, fov, aspectRatio, camera, lights, materials);
 				}
 			}));
 		currPixelIndex += taskSize;
@@ -73,28 +182,298 @@ void Renderer::Render(Scene* pScene)
 	}
 
 #elif defined(PARALLEL_FOR)
-	concurrency::parallel_for(0u, numPixels, [=, this](int i)
+	concurrency::parallel_for(0u, numTiles, [=, this](int i)
 		{
-			RenderPixel(pScene, i, fov, aspectRatio, camera, lights, materials);
+			RenderTile<lightingMode, shadowsEnabled>(pScene, i, fov, aspectRatio, camera, lights, materials);
 		});
 #else
 	//Synchronous exec
-	for (uint32_t i{ 0 }; i < numPixels; ++i)
+	for (uint32_t i{ 0 }; i < numTiles; ++i)
 	{
-		RenderPixel(pScene, i, fov, aspectRatio, camera, lights, materials);
+		RenderTile<lightingMode, shadowsEnabled>(pScene, i, fov, aspectRatio, camera, lights, materials);
 	}
 #endif
+}
 
-	//@END
-	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void dae::Renderer::RenderTile(Scene* pScene, uint32_t tileIndex, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials)
+{
+	const int tileX = int(tileIndex) % m_NumTilesX;
+	const int tileY = int(tileIndex) / m_NumTilesX;
+	Tracer::ScopedEvent traceEvent{ "Tile", "x", tileX, "y", tileY };
+
+	//Edge tiles are cut off at the border of the screen
+	const int beginX{ tileX * m_TileSize };
+	const int beginY{ tileY * m_TileSize };
+	const int endX{ std::min(beginX + m_TileSize, m_Width) };
+	const int endY{ std::min(beginY + m_TileSize, m_Height) };
+
+	//The heatmap needs the traversal cost of every single ray
+	if constexpr (lightingMode != LightingMode::Heatmap)
+	{
+		if (m_DeferredShadingEnabled)
+		{
+			RenderDeferredTile<lightingMode, shadowsEnabled>(pScene, tileIndex, beginX, beginY, endX, endY, fov, aspectRatio, camera, lights, materials);
+			return;
+		}
+
+		if (m_PacketsEnabled)
+		{
+			for (int packetY{ beginY }; packetY < endY; packetY += RayPacket::width)
+			{
+				for (int packetX{ beginX }; packetX < endX; packetX += RayPacket::width)
+				{
+					RenderPacket<lightingMode, shadowsEnabled>(pScene, packetX, packetY, std::min(endX - packetX, RayPacket::width), std::min(endY - packetY, RayPacket::width),
+						fov, aspectRatio, camera, lights, materials);
+				}
+			}
+			return;
+		}
+	}
+
+	for (int py{ beginY }; py < endY; ++py)
+	{
+		for (int px{ beginX }; px < endX; ++px)
+		{
+			RenderPixel<lightingMode, shadowsEnabled>(pScene, uint32_t(py * m_Width + px), fov, aspectRatio, camera, lights, materials);
+		}
+	}
 }
 
-void dae::Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material*>& materials)
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void dae::Renderer::RenderPacket(Scene* pScene, int beginX, int beginY, int numColumns, int numRows, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials)
 {
-	const int px = int(pixelIndex) % m_Width;
-	const int py = int(pixelIndex) / m_Width;
+	Timer::ZoneLaps zoneLaps{ uint32_t(beginY * m_Width + beginX) / RayPacket::width };
+
+	const RayPacket packet{ GetPrimaryRayPacket(beginX, beginY, numColumns, numRows, fov, aspectRatio, camera) };
+	HitRecord closestHits[RayPacket::size]{};
+	pScene->GetClosestHits(packet, closestHits);
+	zoneLaps.Lap(TimerZone::PrimaryRays);
+
+	//Shadow rays of all hits towards the same light are traced together, bit i is set when lane i sees the light
+	uint64_t* const pVisibilityMasks{ GetVisibilityMasks(lights.size()) };
+	if constexpr (shadowsEnabled)
+	{
+		for (size_t lightIdx{}; lightIdx < lights.size(); ++lightIdx)
+		{
+			ShadowRayPacket shadowPacket{};
+			for (int lane{}; lane < RayPacket::size; ++lane)
+			{
+				if (!closestHits[lane].didHit) continue;
+
+				RAY_STATS_INC(shadowRays);
+				shadowPacket.isActive[lane] = true;
+				shadowPacket.SetRay(lane, LightUtils::GetShadowRay(lights[lightIdx], closestHits[lane]));
+			}
+			shadowPacket.UpdateBounds();
+
+			bool isOccluded[ShadowRayPacket::size]{};
+			pScene->DoesHit(shadowPacket, isOccluded);
+
+			for (int lane{}; lane < RayPacket::size; ++lane)
+			{
+				if (isOccluded[lane])
+					pVisibilityMasks[lightIdx] &= ~(uint64_t{ 1 } << lane);
+			}
+		}
+		zoneLaps.Lap(TimerZone::ShadowRays);
+	}
+
+	for (int y{}; y < numRows; ++y)
+	{
+		for (int x{}; x < numColumns; ++x)
+		{
+			RAY_STATS_INC(primaryRays);
+
+			const int px{ beginX + x };
+			const int py{ beginY + y };
+			const int lane{ y * RayPacket::width + x };
+			Timer::ZoneLaps pixelZoneLaps{ uint32_t(py * m_Width + px) };
+			ShadePixel<lightingMode, shadowsEnabled>(pScene, px, py, closestHits[lane], {}, pixelZoneLaps, camera, lights, materials, pVisibilityMasks, lane);
+		}
+	}
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void dae::Renderer::RenderDeferredTile(Scene* pScene, uint32_t tileIndex, int beginX, int beginY, int endX, int endY, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials)
+{
+	static_assert(m_TileSize * m_TileSize <= TileGBuffer::size, "A tile doesn't fit in the G-buffer");
+	Timer::ZoneLaps zoneLaps{ tileIndex };
+
+	//Geometry pass: the closest hit of every pixel goes in the G-buffer, misses are done right away
+	TileGBuffer gBuffer;
+	for (int packetY{ beginY }; packetY < endY; packetY += RayPacket::width)
+	{
+		for (int packetX{ beginX }; packetX < endX; packetX += RayPacket::width)
+		{
+			const int numColumns{ std::min(endX - packetX, RayPacket::width) };
+			const int numRows{ std::min(endY - packetY, RayPacket::width) };
+
+			const RayPacket packet{ GetPrimaryRayPacket(packetX, packetY, numColumns, numRows, fov, aspectRatio, camera) };
+			HitRecord closestHits[RayPacket::size]{};
+			pScene->GetClosestHits(packet, closestHits);
+
+			for (int y{}; y < numRows; ++y)
+			{
+				for (int x{}; x < numColumns; ++x)
+				{
+					RAY_STATS_INC(primaryRays);
+
+					const HitRecord& closestHit{ closestHits[y * RayPacket::width + x] };
+					const uint32_t pixelIndex{ uint32_t((packetY + y) * m_Width + packetX + x) };
+					if (closestHit.didHit)
+						gBuffer.AddHit(closestHit, pixelIndex);
+					else
+						WritePixel(pixelIndex, {});
+				}
+			}
+		}
+	}
+	zoneLaps.Lap(TimerZone::PrimaryRays);
+
+	//Shadow pass: every 64 hits towards the same light are traced as one packet, bit i of a mask is set when entry i sees the light
+	uint64_t* const pVisibilityMasks{ GetVisibilityMasks(lights.size() * TileGBuffer::numMaskWords) };
+	if constexpr (shadowsEnabled)
+	{
+		for (size_t lightIdx{}; lightIdx < lights.size(); ++lightIdx)
+		{
+			for (int firstEntryIdx{}; firstEntryIdx < gBuffer.numHits; firstEntryIdx += ShadowRayPacket::size)
+			{
+				const int numLanes{ std::min(gBuffer.numHits - firstEntryIdx, ShadowRayPacket::size) };
+
+				ShadowRayPacket shadowPacket{};
+				for (int lane{}; lane < numLanes; ++lane)
+				{
+					RAY_STATS_INC(shadowRays);
+					shadowPacket.isActive[lane] = true;
+					shadowPacket.SetRay(lane, LightUtils::GetShadowRay(lights[lightIdx], gBuffer.GetHit(firstEntryIdx + lane)));
+				}
+				shadowPacket.UpdateBounds();
+
+				bool isOccluded[ShadowRayPacket::size]{};
+				pScene->DoesHit(shadowPacket, isOccluded);
+
+				uint64_t& visibilityMask{ pVisibilityMasks[lightIdx * TileGBuffer::numMaskWords + firstEntryIdx / 64] };
+				for (int lane{}; lane < numLanes; ++lane)
+				{
+					if (isOccluded[lane])
+						visibilityMask &= ~(uint64_t{ 1 } << lane);
+				}
+			}
+		}
+		zoneLaps.Lap(TimerZone::ShadowRays);
+	}
+
+	//Shading pass: material by material, so the same material data and shading branch are used for a whole run of hits
+	uint16_t materialOffsets[TileGBuffer::maxMaterials + 1];
+	gBuffer.SortByMaterial(materialOffsets, int(materials.size()));
+	for (size_t materialIdx{}; materialIdx < materials.size(); ++materialIdx)
+	{
+		const MaterialData& material{ materials[materialIdx] };
+
+		//Modes that evaluate the BRDF do so for 8 hits at once
+		if constexpr (lightingMode == LightingMode::Combined || lightingMode == LightingMode::BRDF)
+		{
+			for (int sortedIdx{ materialOffsets[materialIdx] }; sortedIdx < materialOffsets[materialIdx + 1]; sortedIdx += Float8::width)
+			{
+				const int numEntries{ std::min(materialOffsets[materialIdx + 1] - sortedIdx, Float8::width) };
+				ShadeMaterialBatch<lightingMode>(gBuffer, &gBuffer.sortedEntries[sortedIdx], numEntries, material, pVisibilityMasks, camera, lights);
+			}
+			continue;
+		}
+
+		for (int sortedIdx{ materialOffsets[materialIdx] }; sortedIdx < materialOffsets[materialIdx + 1]; ++sortedIdx)
+		{
+			const int entryIdx{ gBuffer.sortedEntries[sortedIdx] };
+			const HitRecord closestHit{ gBuffer.GetHit(entryIdx) };
+
+			ColorRGB finalColor{};
+			for (size_t lightIdx{}; lightIdx < lights.size(); ++lightIdx)
+			{
+				if (((pVisibilityMasks[lightIdx * TileGBuffer::numMaskWords + entryIdx / 64] >> (entryIdx % 64)) & 1) == 0)
+					continue;
+
+				const Ray lightRay{ LightUtils::GetShadowRay(lights[lightIdx], closestHit) };
+				ColorRGB contribution{};
+				if (GetLightContribution<lightingMode>(closestHit, lights[lightIdx], lightRay.direction, camera, material, contribution))
+					finalColor += contribution;
+			}
+			WritePixel(gBuffer.pixelIndices[entryIdx], finalColor);
+		}
+	}
+	zoneLaps.Lap(TimerZone::Shading);
+}
+
+template<Renderer::LightingMode lightingMode>
+void dae::Renderer::ShadeMaterialBatch(const TileGBuffer& gBuffer, const uint16_t* pEntries, int numEntries, const MaterialData& material, const uint64_t* pVisibilityMasks, const Camera& camera, const std::vector<Light>& lights)
+{
+	//Lanes past numEntries repeat the last entry so every lane holds valid input
+	HitRecord closestHits[Float8::width];
+	//Per component, the layout KernelTable::shade takes
+	float normals[3 * Float8::width];
+	float viewDirections[3 * Float8::width];
+	for (int lane{}; lane < Float8::width; ++lane)
+	{
+		closestHits[lane] = gBuffer.GetHit(pEntries[std::min(lane, numEntries - 1)]);
+		normals[lane] = closestHits[lane].normal.x;
+		normals[Float8::width + lane] = closestHits[lane].normal.y;
+		normals[2 * Float8::width + lane] = closestHits[lane].normal.z;
+		viewDirections[lane] = -camera.forward.x;
+		viewDirections[Float8::width + lane] = -camera.forward.y;
+		viewDirections[2 * Float8::width + lane] = -camera.forward.z;
+	}
+
+	ColorRGB finalColors[Float8::width]{};
+	for (size_t lightIdx{}; lightIdx < lights.size(); ++lightIdx)
+	{
+		const Light& light{ lights[lightIdx] };
+
+		bool isVisible[Float8::width]{};
+		bool isAnyVisible{};
+		Vector3 lightDirections[Float8::width];
+		float lightComponents[3 * Float8::width];
+		for (int lane{}; lane < Float8::width; ++lane)
+		{
+			const int entryIdx{ pEntries[std::min(lane, numEntries - 1)] };
+			isVisible[lane] = lane < numEntries && ((pVisibilityMasks[lightIdx * TileGBuffer::numMaskWords + entryIdx / 64] >> (entryIdx % 64)) & 1);
+			isAnyVisible |= isVisible[lane];
+
+			lightDirections[lane] = LightUtils::GetShadowRay(light, closestHits[lane]).direction;
+			lightComponents[lane] = lightDirections[lane].x;
+			lightComponents[Float8::width + lane] = lightDirections[lane].y;
+			lightComponents[2 * Float8::width + lane] = lightDirections[lane].z;
+		}
+		if (!isAnyVisible)
+			continue;
+
+		float brdfs[3 * Float8::width];
+		Kernels::Get().shade(material, normals, lightComponents, viewDirections, brdfs);
+
+		for (int lane{}; lane < numEntries; ++lane)
+		{
+			if (!isVisible[lane]) continue;
+
+			const ColorRGB brdf{ brdfs[lane], brdfs[Float8::width + lane], brdfs[2 * Float8::width + lane] };
+			if constexpr (lightingMode == LightingMode::Combined)
+			{
+				const float observedArea{ Vector3::Dot(closestHits[lane].normal, lightDirections[lane]) };
+				if (observedArea < 0)
+					continue;
+				finalColors[lane] += LightUtils::GetRadiance(light, closestHits[lane].origin) * brdf * observedArea;
+			}
+			else
+			{
+				finalColors[lane] += brdf;
+			}
+		}
+	}
+
+	for (int lane{}; lane < numEntries; ++lane)
+		WritePixel(gBuffer.pixelIndices[pEntries[lane]], finalColors[lane]);
+}
 
+Vector3 dae::Renderer::GetPrimaryRayDirection(int px, int py, float fov, float aspectRatio, const Camera& camera) const
+{
 	const float pxc{ px + 0.5f };
 	const float pyc{ py + 0.5f };
 
@@ -107,83 +486,355 @@ void dae::Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, f
 	rayDirection = camera.cameraToWorld.TransformVector(rayDirection);
 	rayDirection.Normalize();
 
+	return rayDirection;
+}
 
-	const Ray viewRay{ camera.origin,rayDirection };
+RayPacket dae::Renderer::GetPrimaryRayPacket(int beginX, int beginY, int numColumns, int numRows, float fov, float aspectRatio, const Camera& camera) const
+{
+	RayPacket packet{};
+	packet.origin = camera.origin;
+	for (int y{}; y < RayPacket::width; ++y)
+	{
+		for (int x{}; x < RayPacket::width; ++x)
+		{
+			//Inactive lanes repeat the last active ray so every lane holds a valid direction
+			const int lane{ y * RayPacket::width + x };
+			packet.isActive[lane] = x < numColumns && y < numRows;
+			packet.SetDirection(lane, GetPrimaryRayDirection(beginX + std::min(x, numColumns - 1), beginY + std::min(y, numRows - 1), fov, aspectRatio, camera));
+		}
+	}
+	packet.UpdateFrustum(numColumns, numRows);
+	return packet;
+}
+
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void dae::Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials)
+{
+	Timer::ZoneLaps zoneLaps{ pixelIndex };
+
+	const int px = int(pixelIndex) % m_Width;
+	const int py = int(pixelIndex) / m_Width;
+
+	const Ray viewRay{ camera.origin,GetPrimaryRayDirection(px, py, fov, aspectRatio, camera) };
+	RAY_STATS_INC(primaryRays);
 
 	ColorRGB finalColor{};
 
 	HitRecord closestHit{};
 
-	pScene->GetClosestHit(viewRay, closestHit);
+	if constexpr (lightingMode == LightingMode::Heatmap)
+	{
+		//Color by the work needed to find the closest hit instead of by shading
+		TraversalCost cost{};
+		pScene->GetClosestHit(viewRay, closestHit, &cost);
+		finalColor = GetHeatmapColor(float(cost.nodesVisited + cost.triangleTests) / m_HeatmapMaxCost);
+	}
+	else
+	{
+		pScene->GetClosestHit(viewRay, closestHit);
+	}
+	zoneLaps.Lap(TimerZone::PrimaryRays);
 
+	ShadePixel<lightingMode, shadowsEnabled>(pScene, px, py, closestHit, finalColor, zoneLaps, camera, lights, materials);
+}
 
-	if (closestHit.didHit)
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void dae::Renderer::ShadePixel(Scene* pScene, int px, int py, const HitRecord& closestHit, ColorRGB finalColor, Timer::ZoneLaps& zoneLaps, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials,
+	const uint64_t* pVisibilityMasks, int lane)
+{
+	if (lightingMode != LightingMode::Heatmap && closestHit.didHit)
 	{
-		for (const auto& light : lights)
+		for (size_t lightIdx{}; lightIdx < lights.size(); ++lightIdx)
 		{
-			const Vector3 lightDir{ LightUtils::GetDirectionToLight(light, closestHit.origin + (closestHit.normal * 0.0001f)) };
-			const Vector3 normalizedLightDir{ lightDir.Normalized() };
+			const Light& light = lights[lightIdx];
+
+			//Everything since the previous lap (the previous light) was shading
+			zoneLaps.Lap(TimerZone::Shading);
 
 			//Vector pointing from closesthit.origin to light.origin
-			const Ray lightRay{ closestHit.origin + (closestHit.normal * 0.0001f),normalizedLightDir,0.0001f, lightDir.Magnitude() };
+			const Ray lightRay{ LightUtils::GetShadowRay(light, closestHit) };
+			const Vector3& normalizedLightDir{ lightRay.direction };
 
 
 			//if we want shadows,
-			if (m_ShadowsEnabled)
+			if constexpr (shadowsEnabled)
 			{
-				//check if lightRay is obstructed by anything 
-				if (pScene->DoesHit(lightRay))
+				//check if lightRay is obstructed by anything, packets already did that for all of their pixels at once
+				bool isShadowed{};
+				if (pVisibilityMasks)
+				{
+					isShadowed = ((pVisibilityMasks[lightIdx] >> lane) & 1) == 0;
+				}
+				else
+				{
+					RAY_STATS_INC(shadowRays);
+					isShadowed = pScene->DoesHit(lightRay);
+					zoneLaps.Lap(TimerZone::ShadowRays);
+				}
+				if (isShadowed)
 				{
 					//if so, don't bother with calculating lighting for this pixel
 					continue;
 				}
 			}
 
-			switch (m_CurrentLightingMode)
+			ColorRGB contribution{};
+			if (GetLightContribution<lightingMode>(closestHit, light, normalizedLightDir, camera, materials[closestHit.materialIndex], contribution))
+				finalColor += contribution;
+		}
+	}
+	//Update Color in Buffer
+	WritePixel(uint32_t(px + (py * m_Width)), finalColor);
+	zoneLaps.Lap(TimerZone::Shading);
+}
+
+template<Renderer::LightingMode lightingMode>
+bool dae::Renderer::GetLightContribution(const HitRecord& closestHit, const Light& light, const Vector3& normalizedLightDir, const Camera& camera, const MaterialData& material, ColorRGB& contribution) const
+{
+	if constexpr (lightingMode == LightingMode::Combined)
+	{
+		const float observedArea{ Vector3::Dot(closestHit.normal,normalizedLightDir) };
+		if (observedArea < 0)
+			return false;
+
+		contribution = LightUtils::GetRadiance(light, closestHit.origin)
+			* material.Shade(closestHit, normalizedLightDir, -camera.forward) * observedArea;
+	}
+	else if constexpr (lightingMode == LightingMode::ObservedArea)
+	{
+		const float observedArea{ Vector3::Dot(closestHit.normal,normalizedLightDir) };
+		if (observedArea < 0)
+			return false;
+		contribution = { observedArea, observedArea, observedArea };
+	}
+	else if constexpr (lightingMode == LightingMode::Radiance)
+	{
+		contribution = LightUtils::GetRadiance(light, closestHit.origin);
+	}
+	else if constexpr (lightingMode == LightingMode::BRDF)
+	{
+		contribution = material.Shade(closestHit, normalizedLightDir, -camera.forward);
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+void dae::Renderer::WritePixel(uint32_t pixelIndex, ColorRGB finalColor)
+{
+	m_RedBuffer[pixelIndex] = finalColor.r;
+	m_GreenBuffer[pixelIndex] = finalColor.g;
+	m_BlueBuffer[pixelIndex] = finalColor.b;
+}
+
+#pragma region Wavefront
+template<Renderer::LightingMode lightingMode, bool shadowsEnabled>
+void dae::Renderer::RenderWavefront(Scene* pScene, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials)
+{
+	const uint32_t numBlocksX = (m_Width + RayPacket::width - 1) / RayPacket::width;
+	const uint32_t numBlocks = numBlocksX * ((m_Height + RayPacket::width - 1) / RayPacket::width);
+	m_WavefrontQueues.Resize(size_t(numBlocks) * RayPacket::size, size_t(m_Width) * m_Height, lights.size());
+	m_WavefrontQueues.numHits = 0;
+
+	//Every stage runs over the whole screen before the next one starts
+	{
+		Tracer::ScopedEvent traceEvent{ "Generate" };
+		concurrency::parallel_for(0u, numBlocks, [=, this](uint32_t blockIdx)
 			{
-			case LightingMode::Combined:
+				GeneratePrimaryRays(blockIdx, numBlocksX, fov, aspectRatio, camera);
+			});
+	}
+	{
+		Tracer::ScopedEvent traceEvent{ "Extend" };
+		concurrency::parallel_for(0u, numBlocks, [=, this](uint32_t blockIdx)
 			{
-				const float observedArea{ Vector3::Dot(closestHit.normal,normalizedLightDir) };
-				if (observedArea < 0)
-					continue;
+				ExtendPrimaryRays(pScene, blockIdx, numBlocksX, camera);
+			});
+	}
 
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin)
-					* materials[closestHit.materialIndex]->Shade(closestHit, normalizedLightDir, -camera.forward) * observedArea;
-			}
-			break;
+	const uint32_t numHits{ m_WavefrontQueues.numHits };
+	if (m_RaySortingEnabled && !lights.empty())
+	{
+		Tracer::ScopedEvent traceEvent{ "Sort" };
+		SortHits(numHits, lights.front());
+	}
 
-			case LightingMode::ObservedArea:
+	const uint32_t numHitChunks{ (numHits + RayPacket::size - 1) / RayPacket::size };
+	const uint32_t numLights{ uint32_t(lights.size()) };
+	{
+		Tracer::ScopedEvent traceEvent{ "Shade" };
+		concurrency::parallel_for(0u, numHitChunks, [=, this, &lights, &materials](uint32_t chunkIdx)
 			{
-				const float observedArea{ Vector3::Dot(closestHit.normal,normalizedLightDir) };
-				if (observedArea < 0)
-					continue;
-				finalColor += {observedArea, observedArea, observedArea};
-			}
-			break;
-
-			case LightingMode::Radiance:
+				ShadeHits<lightingMode>(chunkIdx, numHits, camera, lights, materials);
+			});
+	}
+	if constexpr (shadowsEnabled)
+	{
+		Tracer::ScopedEvent traceEvent{ "Connect" };
+		concurrency::parallel_for(0u, numHitChunks * numLights, [=, this, &lights](uint32_t chunkIdx)
 			{
-				finalColor += LightUtils::GetRadiance(light, closestHit.origin);
-			}
-			break;
-
-			case LightingMode::BRDF:
+				ConnectShadowRays(pScene, chunkIdx % numHitChunks, numHits, chunkIdx / numHitChunks, lights);
+			});
+	}
+	{
+		Tracer::ScopedEvent traceEvent{ "Accumulate" };
+		concurrency::parallel_for(0u, numHitChunks, [=, this](uint32_t chunkIdx)
 			{
-				finalColor += materials[closestHit.materialIndex]->Shade(closestHit, normalizedLightDir, -camera.forward);
-			}
-			break;
+				AccumulateHits(chunkIdx, numHits, numLights);
+			});
+	}
+}
 
-			}
+void dae::Renderer::GeneratePrimaryRays(uint32_t blockIdx, uint32_t numBlocksX, float fov, float aspectRatio, const Camera& camera)
+{
+	const int beginX{ int(blockIdx % numBlocksX) * RayPacket::width };
+	const int beginY{ int(blockIdx / numBlocksX) * RayPacket::width };
+
+	for (int y{}; y < RayPacket::width; ++y)
+	{
+		for (int x{}; x < RayPacket::width; ++x)
+		{
+			//Rays of a partial block repeat the last pixel on the screen, but don't belong to any pixel
+			const int px{ std::min(beginX + x, m_Width - 1) };
+			const int py{ std::min(beginY + y, m_Height - 1) };
+			const bool isOnScreen{ beginX + x < m_Width && beginY + y < m_Height };
+
+			const uint32_t rayIdx{ blockIdx * RayPacket::size + uint32_t(y * RayPacket::width + x) };
+			const Vector3 direction{ GetPrimaryRayDirection(px, py, fov, aspectRatio, camera) };
+			m_WavefrontQueues.directionX[rayIdx] = direction.x;
+			m_WavefrontQueues.directionY[rayIdx] = direction.y;
+			m_WavefrontQueues.directionZ[rayIdx] = direction.z;
+			m_WavefrontQueues.pixelIndices[rayIdx] = isOnScreen ? uint32_t(py * m_Width + px) : WavefrontQueues::invalidPixel;
 		}
 	}
-	//Update Color in Buffer
-	finalColor.MaxToOne();
+}
+
+void dae::Renderer::ExtendPrimaryRays(Scene* pScene, uint32_t blockIdx, uint32_t numBlocksX, const Camera& camera)
+{
+	Timer::ScopedZone zone{ TimerZone::PrimaryRays };
+
+	const int beginX{ int(blockIdx % numBlocksX) * RayPacket::width };
+	const int beginY{ int(blockIdx / numBlocksX) * RayPacket::width };
+	const uint32_t firstRayIdx{ blockIdx * RayPacket::size };
+
+	RayPacket packet{};
+	packet.origin = camera.origin;
+	for (int lane{}; lane < RayPacket::size; ++lane)
+	{
+		const uint32_t rayIdx{ firstRayIdx + lane };
+		packet.isActive[lane] = m_WavefrontQueues.pixelIndices[rayIdx] != WavefrontQueues::invalidPixel;
+		packet.SetDirection(lane, { m_WavefrontQueues.directionX[rayIdx], m_WavefrontQueues.directionY[rayIdx], m_WavefrontQueues.directionZ[rayIdx] });
+	}
+	packet.UpdateFrustum(std::min(m_Width - beginX, RayPacket::width), std::min(m_Height - beginY, RayPacket::width));
+
+	HitRecord closestHits[RayPacket::size]{};
+	pScene->GetClosestHits(packet, closestHits);
+
+	//Claim room for all hits of the block at once, misses are done right away
+	uint32_t numBlockHits{};
+	for (int lane{}; lane < RayPacket::size; ++lane)
+	{
+		numBlockHits += packet.isActive[lane] && closestHits[lane].didHit;
+	}
+	uint32_t hitIdx{ m_WavefrontQueues.numHits.fetch_add(numBlockHits) };
+
+	for (int lane{}; lane < RayPacket::size; ++lane)
+	{
+		if (!packet.isActive[lane]) continue;
+		RAY_STATS_INC(primaryRays);
+
+		const uint32_t pixelIndex{ m_WavefrontQueues.pixelIndices[firstRayIdx + lane] };
+		if (closestHits[lane].didHit)
+			m_WavefrontQueues.SetHit(hitIdx++, closestHits[lane], pixelIndex);
+		else
+			WritePixel(pixelIndex, {});
+	}
+}
+
+void dae::Renderer::SortHits(uint32_t numHits, const Light& light)
+{
+	Timer::ScopedZone zone{ TimerZone::ShadowRays };
+
+	m_WavefrontQueues.sortRays.resize(numHits);
+	for (uint32_t hitIdx{}; hitIdx < numHits; ++hitIdx)
+		m_WavefrontQueues.sortRays[hitIdx] = LightUtils::GetShadowRay(light, m_WavefrontQueues.GetHit(hitIdx));
+
+	RaySorting::GetSortedOrder(m_WavefrontQueues.sortRays, m_WavefrontQueues.sortOrder);
+	m_WavefrontQueues.ReorderHits();
+}
+
+template<Renderer::LightingMode lightingMode>
+void dae::Renderer::ShadeHits(uint32_t chunkIdx, uint32_t numHits, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials)
+{
+	Timer::ScopedZone zone{ TimerZone::Shading };
+
+	const uint32_t endHitIdx{ std::min(numHits, (chunkIdx + 1) * RayPacket::size) };
+	for (uint32_t hitIdx{ chunkIdx * RayPacket::size }; hitIdx < endHitIdx; ++hitIdx)
+	{
+		const HitRecord closestHit{ m_WavefrontQueues.GetHit(hitIdx) };
+		for (size_t lightIdx{}; lightIdx < lights.size(); ++lightIdx)
+		{
+			const size_t slot{ lightIdx * numHits + hitIdx };
+			const Ray lightRay{ LightUtils::GetShadowRay(lights[lightIdx], closestHit) };
+
+			ColorRGB contribution{};
+			m_WavefrontQueues.isLit[slot] = GetLightContribution<lightingMode>(closestHit, lights[lightIdx], lightRay.direction, camera, materials[closestHit.materialIndex], contribution);
+			m_WavefrontQueues.contributionR[slot] = contribution.r;
+			m_WavefrontQueues.contributionG[slot] = contribution.g;
+			m_WavefrontQueues.contributionB[slot] = contribution.b;
+		}
+	}
+}
+
+void dae::Renderer::ConnectShadowRays(Scene* pScene, uint32_t chunkIdx, uint32_t numHits, uint32_t lightIdx, const std::vector<Light>& lights)
+{
+	Timer::ScopedZone zone{ TimerZone::ShadowRays };
 
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
+	//Lights that don't contribute anything don't need a shadow ray
+	ShadowRayPacket packet{};
+	const uint32_t firstHitIdx{ chunkIdx * RayPacket::size };
+	for (int lane{}; lane < ShadowRayPacket::size; ++lane)
+	{
+		const uint32_t hitIdx{ firstHitIdx + lane };
+		if (hitIdx >= numHits || !m_WavefrontQueues.isLit[size_t(lightIdx) * numHits + hitIdx]) continue;
+
+		RAY_STATS_INC(shadowRays);
+		packet.isActive[lane] = true;
+		packet.SetRay(lane, LightUtils::GetShadowRay(lights[lightIdx], m_WavefrontQueues.GetHit(hitIdx)));
+	}
+	packet.UpdateBounds();
+
+	bool isOccluded[ShadowRayPacket::size]{};
+	pScene->DoesHit(packet, isOccluded);
+
+	for (int lane{}; lane < ShadowRayPacket::size; ++lane)
+	{
+		if (isOccluded[lane])
+			m_WavefrontQueues.isLit[size_t(lightIdx) * numHits + firstHitIdx + lane] = false;
+	}
+}
+
+void dae::Renderer::AccumulateHits(uint32_t chunkIdx, uint32_t numHits, uint32_t numLights)
+{
+	Timer::ScopedZone zone{ TimerZone::Shading };
+
+	const uint32_t endHitIdx{ std::min(numHits, (chunkIdx + 1) * RayPacket::size) };
+	for (uint32_t hitIdx{ chunkIdx * RayPacket::size }; hitIdx < endHitIdx; ++hitIdx)
+	{
+		//Same order as the megakernel adds the lights in, so both give the exact same colors
+		ColorRGB finalColor{};
+		for (uint32_t lightIdx{}; lightIdx < numLights; ++lightIdx)
+		{
+			const size_t slot{ size_t(lightIdx) * numHits + hitIdx };
+			if (m_WavefrontQueues.isLit[slot])
+				finalColor += ColorRGB{ m_WavefrontQueues.contributionR[slot], m_WavefrontQueues.contributionG[slot], m_WavefrontQueues.contributionB[slot] };
+		}
+		WritePixel(m_WavefrontQueues.hitPixelIndices[hitIdx], finalColor);
+	}
 }
+#pragma endregion
 
 bool Renderer::SaveBufferToImage() const
 {
@@ -193,7 +844,56 @@ bool Renderer::SaveBufferToImage() const
 void dae::Renderer::CycleLightingMode()
 {
 
-	m_CurrentLightingMode = LightingMode((int(m_CurrentLightingMode) + 1) % 4);
+	m_CurrentLightingMode = LightingMode((int(m_CurrentLightingMode) + 1) % 5);
+
+	if (m_CurrentLightingMode == LightingMode::Heatmap)
+		std::cout << "Heatmap: BVH nodes + triangles per pixel, blue = 0 > red = " << m_HeatmapMaxCost << " or more\n";
+}
+
+void dae::Renderer::ToggleWavefront()
+{
+	m_WavefrontEnabled = !m_WavefrontEnabled;
+	std::cout << "Render path: " << (m_WavefrontEnabled ? "WAVEFRONT" : "MEGAKERNEL") << '\n';
+}
+
+void dae::Renderer::ToggleRaySorting()
+{
+	m_RaySortingEnabled = !m_RaySortingEnabled;
+	std::cout << "Wavefront ray sorting: " << (m_RaySortingEnabled ? "ON" : "OFF") << '\n';
+}
+
+void dae::Renderer::ToggleDeferredShading()
+{
+	m_DeferredShadingEnabled = !m_DeferredShadingEnabled;
+	std::cout << "Deferred shading: " << (m_DeferredShadingEnabled ? "ON" : "OFF") << '\n';
+}
+
+void dae::Renderer::TogglePackets()
+{
+	m_PacketsEnabled = !m_PacketsEnabled;
+	std::cout << "Primary ray packets: " << (m_PacketsEnabled ? "ON" : "OFF") << '\n';
+}
+
+void dae::Renderer::DrawHeatmapLegend()
+{
+	//Color ramp in the bottom left corner, framed in black
+	const int margin{ 10 };
+	const int legendWidth{ std::min(256, m_Width - 2 * margin) };
+	const int legendHeight{ 12 };
+	const int top{ m_Height - margin - legendHeight };
 
+	for (int py{ top - 1 }; py <= top + legendHeight; ++py)
+	{
+		for (int px{ margin - 1 }; px <= margin + legendWidth; ++px)
+		{
+			const bool isBorder{ py < top || py == top + legendHeight || px < margin || px == margin + legendWidth };
+			const ColorRGB color{ isBorder ? colors::Black : GetHeatmapColor(float(px - margin) / float(legendWidth - 1)) };
+
+			m_pBufferPixels[px + (py * m_Width)] = m_PixelFormat.Pack(
+				static_cast<uint8_t>(color.r * 255),
+				static_cast<uint8_t>(color.g * 255),
+				static_cast<uint8_t>(color.b * 255));
+		}
+	}
 }
 
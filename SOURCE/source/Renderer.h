@@ -2,20 +2,38 @@
 
 #include <cstdint>
 #include <vector>
+
+#include "Math.h"
+#include "Timer.h"
+#include "GBuffer.h"
+#include "Kernels.h"
+#include "WavefrontQueues.h"
 struct SDL_Window;
 struct SDL_Surface;
 
 namespace dae
 {
 	class Scene;
-	class Material;
+	struct MaterialData;
 	struct Camera;
 	struct Light;
+	struct HitRecord;
 	
 	class Renderer final
 	{
 	public:
+		enum class LightingMode
+		{
+			ObservedArea,
+			Radiance,
+			BRDF,
+			Combined,
+			Heatmap //BVH nodes visited + triangles tested per primary ray
+		};
+
 		Renderer(SDL_Window* pWindow);
+		//Renders into its own pixels instead of a window surface, GetPixels has the frame after Render (RenderCheck)
+		Renderer(int width, int height);
 		~Renderer() = default;
 
 		Renderer(const Renderer&) = delete;
@@ -25,29 +43,99 @@ namespace dae
 
 		void Render(Scene* pScene);
 
-		void RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material*>& materials);
-
 		bool SaveBufferToImage() const;
 		void CycleLightingMode();
 		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; }
+		void TogglePackets();
+		void ToggleWavefront();
+		void ToggleRaySorting();
+		void ToggleDeferredShading();
+		void SetLightingMode(LightingMode lightingMode) { m_CurrentLightingMode = lightingMode; }
+
+		//width * height pixels in GetPixelFormat, row by row
+		const uint32_t* GetPixels() const { return m_pBufferPixels; }
+		const PixelFormat& GetPixelFormat() const { return m_PixelFormat; }
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
 
 	private:
 		SDL_Window* m_pWindow{};
 
 		SDL_Surface* m_pBuffer{};
 		uint32_t* m_pBufferPixels{};
+		PixelFormat m_PixelFormat{};
+		//m_pBufferPixels of a renderer without a window
+		std::vector<uint32_t> m_OffscreenPixels{};
+
+		//Colors the render loops write, one array per channel, converted to m_pBufferPixels once the frame is done
+		std::vector<float> m_RedBuffer{};
+		std::vector<float> m_GreenBuffer{};
+		std::vector<float> m_BlueBuffer{};
 
 		int m_Width{};
 		int m_Height{};
 
-		enum class LightingMode
-		{
-			ObservedArea,
-			Radiance,
-			BRDF,
-			Combined
-		};
+		//Pixels are handed out to the workers in square tiles, row by row
+		static constexpr int m_TileSize{ 16 };
+		int m_NumTilesX{};
+		int m_NumTilesY{};
+
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
 		bool m_ShadowsEnabled{ true };
+		//Primary rays are traced as 8x8 packets instead of one by one
+		bool m_PacketsEnabled{ true };
+		//Renders in separate passes over the whole screen (generate > extend > shade > connect > accumulate) instead of a pixel at a time
+		bool m_WavefrontEnabled{ false };
+		//Wavefront only: the hits get sorted on origin + shadow ray direction (RaySorting) before their shadow rays are traced
+		bool m_RaySortingEnabled{ false };
+		//Tiles fill a G-buffer first and shade it material by material (always traces packets)
+		bool m_DeferredShadingEnabled{ false };
+		WavefrontQueues m_WavefrontQueues{};
+
+		//Traversal cost that maps to the hottest heatmap color
+		float m_HeatmapMaxCost{ 128.f };
+
+		//Every lighting mode + shadow flag combination gets its own copy of the render loop, Render picks one per frame
+		//so no pixel has to check either of them again
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderFrame(Scene* pScene, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials);
+		using RenderFrameFunction = void (Renderer::*)(Scene*, float, float, const Camera&, const std::vector<Light>&, const std::vector<MaterialData>&);
+
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderTiles(Scene* pScene, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials);
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderTile(Scene* pScene, uint32_t tileIndex, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials);
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderPacket(Scene* pScene, int beginX, int beginY, int numColumns, int numRows, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials);
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderDeferredTile(Scene* pScene, uint32_t tileIndex, int beginX, int beginY, int endX, int endY, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials);
+		//Shades up to Float8::width G-buffer entries that share a material, their BRDFs are evaluated with SIMD
+		template<LightingMode lightingMode>
+		void ShadeMaterialBatch(const TileGBuffer& gBuffer, const uint16_t* pEntries, int numEntries, const MaterialData& material, const uint64_t* pVisibilityMasks, const Camera& camera, const std::vector<Light>& lights);
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials);
+		Vector3 GetPrimaryRayDirection(int px, int py, float fov, float aspectRatio, const Camera& camera) const;
+		RayPacket GetPrimaryRayPacket(int beginX, int beginY, int numColumns, int numRows, float fov, float aspectRatio, const Camera& camera) const;
+		//pVisibilityMasks holds a mask per light (bit lane set = lit) when the shadow rays were already traced, nullptr traces them here
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void ShadePixel(Scene* pScene, int px, int py, const HitRecord& closestHit, ColorRGB finalColor, Timer::ZoneLaps& zoneLaps, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials,
+			const uint64_t* pVisibilityMasks = nullptr, int lane = 0);
+		//False when the light adds nothing for the lighting mode (facing away)
+		template<LightingMode lightingMode>
+		bool GetLightContribution(const HitRecord& closestHit, const Light& light, const Vector3& normalizedLightDir, const Camera& camera, const MaterialData& material, ColorRGB& contribution) const;
+		void WritePixel(uint32_t pixelIndex, ColorRGB finalColor);
+
+		template<LightingMode lightingMode, bool shadowsEnabled>
+		void RenderWavefront(Scene* pScene, float fov, float aspectRatio, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials);
+		void GeneratePrimaryRays(uint32_t blockIdx, uint32_t numBlocksX, float fov, float aspectRatio, const Camera& camera);
+		void ExtendPrimaryRays(Scene* pScene, uint32_t blockIdx, uint32_t numBlocksX, const Camera& camera);
+		//Keyed on the shadow ray towards light, the other lights' rays start from the same origins
+		void SortHits(uint32_t numHits, const Light& light);
+		template<LightingMode lightingMode>
+		void ShadeHits(uint32_t chunkIdx, uint32_t numHits, const Camera& camera, const std::vector<Light>& lights, const std::vector<MaterialData>& materials);
+		void ConnectShadowRays(Scene* pScene, uint32_t chunkIdx, uint32_t numHits, uint32_t lightIdx, const std::vector<Light>& lights);
+		void AccumulateHits(uint32_t chunkIdx, uint32_t numHits, uint32_t numLights);
+
+		void DrawHeatmapLegend();
 	};
 }
@@ -0,0 +1,483 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+
+//Instruction set Float4 maps to, picked from what the compiler targets:
+//SSE on x86/x64, NEON on 64-bit ARM, a plain 4 float struct everywhere else (still correct, just not vectorized)
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define SIMD_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE
+#include <immintrin.h>
+#else
+#define SIMD_SCALAR
+#include <bit>
+#include <cmath>
+#endif
+
+//The kernels behind the runtime dispatch (Kernels.h) use instruction sets above the one the compiler targets,
+//GCC and Clang only allow their intrinsics in functions that enable them, MSVC allows every intrinsic anywhere
+#if defined(SIMD_SSE) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512bw,avx512dq,avx2,bmi,bmi2,popcnt")))
+#else
+#define SIMD_TARGET_SSE42
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#endif
+
+namespace dae
+{
+#if defined(SIMD_SSE)
+	using Float4Register = __m128;
+#elif defined(SIMD_NEON)
+	using Float4Register = float32x4_t;
+#else
+	struct Float4Register
+	{
+		float lanes[4];
+	};
+#endif
+
+	//4 floats processed by a single SSE/NEON instruction, comparisons return a mask with all bits of a lane set when true
+	struct Float4
+	{
+		static constexpr int width{ 4 };
+
+		Float4Register v;
+
+		Float4() = default;
+		Float4(Float4Register _v) : v(_v) {}
+		explicit Float4(float f);
+
+		static Float4 Load(const float* pData);
+		void Store(float* pData) const;
+	};
+
+#if defined(SIMD_SSE)
+	inline Float4::Float4(float f) : v(_mm_set1_ps(f)) {}
+	inline Float4 Float4::Load(const float* pData) { return _mm_loadu_ps(pData); }
+	inline void Float4::Store(float* pData) const { _mm_storeu_ps(pData, v); }
+
+	inline Float4 operator+(const Float4& a, const Float4& b) { return _mm_add_ps(a.v, b.v); }
+	inline Float4 operator-(const Float4& a, const Float4& b) { return _mm_sub_ps(a.v, b.v); }
+	inline Float4 operator*(const Float4& a, const Float4& b) { return _mm_mul_ps(a.v, b.v); }
+	inline Float4 operator/(const Float4& a, const Float4& b) { return _mm_div_ps(a.v, b.v); }
+
+	inline Float4 operator<(const Float4& a, const Float4& b) { return _mm_cmplt_ps(a.v, b.v); }
+	inline Float4 operator<=(const Float4& a, const Float4& b) { return _mm_cmple_ps(a.v, b.v); }
+	inline Float4 operator>(const Float4& a, const Float4& b) { return _mm_cmpgt_ps(a.v, b.v); }
+	inline Float4 operator>=(const Float4& a, const Float4& b) { return _mm_cmpge_ps(a.v, b.v); }
+	inline Float4 operator==(const Float4& a, const Float4& b) { return _mm_cmpeq_ps(a.v, b.v); }
+
+	inline Float4 operator&(const Float4& a, const Float4& b) { return _mm_and_ps(a.v, b.v); }
+	inline Float4 operator|(const Float4& a, const Float4& b) { return _mm_or_ps(a.v, b.v); }
+
+	inline Float4 Sqrt(const Float4& a) { return _mm_sqrt_ps(a.v); }
+	//a < b ? a : b per lane, b when either is NaN (on every backend)
+	inline Float4 Min(const Float4& a, const Float4& b) { return _mm_min_ps(a.v, b.v); }
+	//a > b ? a : b per lane, b when either is NaN (on every backend)
+	inline Float4 Max(const Float4& a, const Float4& b) { return _mm_max_ps(a.v, b.v); }
+
+	//Per lane mask ? a : b
+	inline Float4 Select(const Float4& mask, const Float4& a, const Float4& b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+
+	//One bit per lane, lane 0 in the lowest bit
+	inline int MoveMask(const Float4& mask) { return _mm_movemask_ps(mask.v); }
+
+	inline float GetFirstLane(const Float4& a) { return _mm_cvtss_f32(a.v); }
+
+	//Hardware estimates, 12 bits
+	inline Float4 ReciprocalEstimate(const Float4& x) { return _mm_rcp_ps(x.v); }
+	inline Float4 InvSqrtEstimate(const Float4& x) { return _mm_rsqrt_ps(x.v); }
+
+	//x rounded to the nearest integer (as float) and 2^that integer, x within [-126, 127]
+	inline void SplitExponent(const Float4& x, Float4& integerPart, Float4& power)
+	{
+		const __m128i integer{ _mm_cvtps_epi32(x.v) };
+		integerPart = _mm_cvtepi32_ps(integer);
+		power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(integer, _mm_set1_epi32(127)), 23));
+	}
+
+	//x = mantissa * 2^exponent with mantissa in [1, 2), x > 0
+	inline void SplitMantissa(const Float4& x, Float4& exponent, Float4& mantissa)
+	{
+		const __m128i bits{ _mm_castps_si128(x.v) };
+		exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+		mantissa = _mm_or_ps(_mm_castsi128_ps(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF))), _mm_set1_ps(1.f));
+	}
+#elif defined(SIMD_NEON)
+	inline Float4::Float4(float f) : v(vdupq_n_f32(f)) {}
+	inline Float4 Float4::Load(const float* pData) { return vld1q_f32(pData); }
+	inline void Float4::Store(float* pData) const { vst1q_f32(pData, v); }
+
+	inline Float4 operator+(const Float4& a, const Float4& b) { return vaddq_f32(a.v, b.v); }
+	inline Float4 operator-(const Float4& a, const Float4& b) { return vsubq_f32(a.v, b.v); }
+	inline Float4 operator*(const Float4& a, const Float4& b) { return vmulq_f32(a.v, b.v); }
+	inline Float4 operator/(const Float4& a, const Float4& b) { return vdivq_f32(a.v, b.v); }
+
+	inline Float4 operator<(const Float4& a, const Float4& b) { return vreinterpretq_f32_u32(vcltq_f32(a.v, b.v)); }
+	inline Float4 operator<=(const Float4& a, const Float4& b) { return vreinterpretq_f32_u32(vcleq_f32(a.v, b.v)); }
+	inline Float4 operator>(const Float4& a, const Float4& b) { return vreinterpretq_f32_u32(vcgtq_f32(a.v, b.v)); }
+	inline Float4 operator>=(const Float4& a, const Float4& b) { return vreinterpretq_f32_u32(vcgeq_f32(a.v, b.v)); }
+	inline Float4 operator==(const Float4& a, const Float4& b) { return vreinterpretq_f32_u32(vceqq_f32(a.v, b.v)); }
+
+	inline Float4 operator&(const Float4& a, const Float4& b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v))); }
+	inline Float4 operator|(const Float4& a, const Float4& b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v))); }
+
+	inline Float4 Sqrt(const Float4& a) { return vsqrtq_f32(a.v); }
+	//vminq/vmaxq return NaN for NaN inputs, select instead so the slab tests behave like on SSE
+	inline Float4 Min(const Float4& a, const Float4& b) { return vbslq_f32(vcltq_f32(a.v, b.v), a.v, b.v); }
+	inline Float4 Max(const Float4& a, const Float4& b) { return vbslq_f32(vcgtq_f32(a.v, b.v), a.v, b.v); }
+
+	inline Float4 Select(const Float4& mask, const Float4& a, const Float4& b) { return vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v); }
+
+	inline int MoveMask(const Float4& mask)
+	{
+		static constexpr int32_t shifts[4]{ 0, 1, 2, 3 };
+		const uint32x4_t signBits{ vshrq_n_u32(vreinterpretq_u32_f32(mask.v), 31) };
+		return int(vaddvq_u32(vshlq_u32(signBits, vld1q_s32(shifts))));
+	}
+
+	inline float GetFirstLane(const Float4& a) { return vgetq_lane_f32(a.v, 0); }
+
+	//The hardware estimates are 8 bits on ARM, one refinement step brings them to the SSE precision
+	inline Float4 ReciprocalEstimate(const Float4& x)
+	{
+		const float32x4_t estimate{ vrecpeq_f32(x.v) };
+		return vmulq_f32(vrecpsq_f32(x.v, estimate), estimate);
+	}
+
+	inline Float4 InvSqrtEstimate(const Float4& x)
+	{
+		const float32x4_t estimate{ vrsqrteq_f32(x.v) };
+		return vmulq_f32(vrsqrtsq_f32(vmulq_f32(x.v, estimate), estimate), estimate);
+	}
+
+	inline void SplitExponent(const Float4& x, Float4& integerPart, Float4& power)
+	{
+		const int32x4_t integer{ vcvtnq_s32_f32(x.v) };
+		integerPart = vcvtq_f32_s32(integer);
+		power = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(integer, vdupq_n_s32(127)), 23));
+	}
+
+	inline void SplitMantissa(const Float4& x, Float4& exponent, Float4& mantissa)
+	{
+		const uint32x4_t bits{ vreinterpretq_u32_f32(x.v) };
+		exponent = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+		mantissa = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vreinterpretq_u32_f32(vdupq_n_f32(1.f))));
+	}
+#else
+	inline Float4::Float4(float f) : v{ f, f, f, f } {}
+	inline Float4 Float4::Load(const float* pData) { return Float4Register{ pData[0], pData[1], pData[2], pData[3] }; }
+	inline void Float4::Store(float* pData) const { for (int lane{}; lane < width; ++lane) pData[lane] = v.lanes[lane]; }
+
+	//Applies a scalar operation to every lane
+	template<typename Operation>
+	inline Float4 Map(const Float4& a, const Float4& b, Operation&& operation)
+	{
+		Float4 result;
+		for (int lane{}; lane < Float4::width; ++lane)
+			result.v.lanes[lane] = operation(a.v.lanes[lane], b.v.lanes[lane]);
+		return result;
+	}
+
+	inline float ToMask(bool isSet) { return std::bit_cast<float>(isSet ? 0xFFFFFFFFu : 0u); }
+	inline uint32_t ToBits(float f) { return std::bit_cast<uint32_t>(f); }
+
+	inline Float4 operator+(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return x + y; }); }
+	inline Float4 operator-(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return x - y; }); }
+	inline Float4 operator*(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return x * y; }); }
+	inline Float4 operator/(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return x / y; }); }
+
+	inline Float4 operator<(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return ToMask(x < y); }); }
+	inline Float4 operator<=(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return ToMask(x <= y); }); }
+	inline Float4 operator>(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return ToMask(x > y); }); }
+	inline Float4 operator>=(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return ToMask(x >= y); }); }
+	inline Float4 operator==(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return ToMask(x == y); }); }
+
+	inline Float4 operator&(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return std::bit_cast<float>(ToBits(x) & ToBits(y)); }); }
+	inline Float4 operator|(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return std::bit_cast<float>(ToBits(x) | ToBits(y)); }); }
+
+	inline Float4 Sqrt(const Float4& a) { return Map(a, a, [](float x, float) { return sqrtf(x); }); }
+	inline Float4 Min(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return x < y ? x : y; }); }
+	inline Float4 Max(const Float4& a, const Float4& b) { return Map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+
+	inline Float4 Select(const Float4& mask, const Float4& a, const Float4& b) { return (mask & a) | Map(mask, b, [](float m, float y) { return std::bit_cast<float>(~ToBits(m) & ToBits(y)); }); }
+
+	inline int MoveMask(const Float4& mask)
+	{
+		int bits{};
+		for (int lane{}; lane < Float4::width; ++lane)
+			bits |= int(ToBits(mask.v.lanes[lane]) >> 31) << lane;
+		return bits;
+	}
+
+	inline float GetFirstLane(const Float4& a) { return a.v.lanes[0]; }
+
+	//No estimate instructions, exact
+	inline Float4 ReciprocalEstimate(const Float4& x) { return Float4{ 1.f } / x; }
+	inline Float4 InvSqrtEstimate(const Float4& x) { return Float4{ 1.f } / Sqrt(x); }
+
+	inline void SplitExponent(const Float4& x, Float4& integerPart, Float4& power)
+	{
+		for (int lane{}; lane < Float4::width; ++lane)
+		{
+			const int32_t integer{ int32_t(nearbyintf(x.v.lanes[lane])) };
+			integerPart.v.lanes[lane] = float(integer);
+			power.v.lanes[lane] = std::bit_cast<float>(uint32_t(integer + 127) << 23);
+		}
+	}
+
+	inline void SplitMantissa(const Float4& x, Float4& exponent, Float4& mantissa)
+	{
+		for (int lane{}; lane < Float4::width; ++lane)
+		{
+			const uint32_t bits{ ToBits(x.v.lanes[lane]) };
+			exponent.v.lanes[lane] = float(int32_t(bits >> 23) - 127);
+			mantissa.v.lanes[lane] = std::bit_cast<float>((bits & 0x007FFFFF) | 0x3F800000u);
+		}
+	}
+#endif
+
+	//1/x from the hardware estimate refined with a Newton step, relative error below 3e-7
+	inline Float4 Reciprocal(const Float4& x)
+	{
+		const Float4 estimate{ ReciprocalEstimate(x) };
+		return estimate * (Float4{ 2.f } - x * estimate);
+	}
+
+	//1/sqrt(x) from the hardware estimate refined with a Newton step, relative error below 5e-7
+	inline Float4 InvSqrt(const Float4& x)
+	{
+		const Float4 estimate{ InvSqrtEstimate(x) };
+		return estimate * (Float4{ 1.5f } - Float4{ 0.5f } * x * estimate * estimate);
+	}
+
+	//2^x, 5th order polynomial on the fractional part, relative error below 2e-7 for x in [-126, 128]
+	inline Float4 Exp2(const Float4& x)
+	{
+		const Float4 clamped{ Min(Max(x, Float4{ -126.99999f }), Float4{ 128.f }) };
+		Float4 integerPart;
+		Float4 power;
+		SplitExponent(clamped - Float4{ 0.5f }, integerPart, power);
+		const Float4 fraction{ clamped - integerPart };
+
+		Float4 polynomial{ 1.8775767e-3f };
+		polynomial = polynomial * fraction + Float4{ 8.9893397e-3f };
+		polynomial = polynomial * fraction + Float4{ 5.5826318e-2f };
+		polynomial = polynomial * fraction + Float4{ 2.4015361e-1f };
+		polynomial = polynomial * fraction + Float4{ 6.9315308e-1f };
+		polynomial = polynomial * fraction + Float4{ 9.9999994e-1f };
+		return power * polynomial;
+	}
+
+	//log2(x) for x > 0, exponent bits + 6th order polynomial on the mantissa, absolute error below 1e-5
+	inline Float4 Log2(const Float4& x)
+	{
+		Float4 exponent;
+		Float4 mantissa;
+		SplitMantissa(x, exponent, mantissa);
+
+		Float4 polynomial{ -3.4436006e-2f };
+		polynomial = polynomial * mantissa + Float4{ 3.1821337e-1f };
+		polynomial = polynomial * mantissa + Float4{ -1.2315303f };
+		polynomial = polynomial * mantissa + Float4{ 2.5988452f };
+		polynomial = polynomial * mantissa + Float4{ -3.3241990f };
+		polynomial = polynomial * mantissa + Float4{ 3.1157899f };
+		return polynomial * (mantissa - Float4{ 1.f }) + exponent;
+	}
+
+	//x^y for x >= 0 through Exp2(y * Log2(x)), 0 where x is 0
+	inline Float4 Pow(const Float4& x, const Float4& y)
+	{
+		return Select(x > Float4{ 0.f }, Exp2(y * Log2(x)), Float4{ 0.f });
+	}
+
+#if defined(SIMD_SSE)
+	//8 floats in a single AVX register, whatever the compiler targets
+	//Only call it from code that runs on AVX2 CPUs: the AVX2 build (it is Float8 there) or the AVX2 kernels of Kernels.h
+	struct Float8AVX2
+	{
+		static constexpr int width{ 8 };
+
+		__m256 v;
+
+		Float8AVX2() = default;
+		SIMD_TARGET_AVX2 Float8AVX2(__m256 _v) : v(_v) {}
+		SIMD_TARGET_AVX2 explicit Float8AVX2(float f) : v(_mm256_set1_ps(f)) {}
+
+		SIMD_TARGET_AVX2 static Float8AVX2 Load(const float* pData) { return _mm256_loadu_ps(pData); }
+		SIMD_TARGET_AVX2 void Store(float* pData) const { _mm256_storeu_ps(pData, v); }
+	};
+
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator+(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_add_ps(a.v, b.v); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator-(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_sub_ps(a.v, b.v); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator*(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_mul_ps(a.v, b.v); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator/(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_div_ps(a.v, b.v); }
+
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator<(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator<=(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator>(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator>=(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator==(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator&(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_and_ps(a.v, b.v); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 operator|(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_or_ps(a.v, b.v); }
+
+	SIMD_TARGET_AVX2 inline Float8AVX2 Sqrt(const Float8AVX2& a) { return _mm256_sqrt_ps(a.v); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 Min(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_min_ps(a.v, b.v); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 Max(const Float8AVX2& a, const Float8AVX2& b) { return _mm256_max_ps(a.v, b.v); }
+	SIMD_TARGET_AVX2 inline Float8AVX2 Select(const Float8AVX2& mask, const Float8AVX2& a, const Float8AVX2& b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+	SIMD_TARGET_AVX2 inline int MoveMask(const Float8AVX2& mask) { return _mm256_movemask_ps(mask.v); }
+
+	SIMD_TARGET_AVX2 inline Float8AVX2 Reciprocal(const Float8AVX2& x)
+	{
+		const Float8AVX2 estimate{ _mm256_rcp_ps(x.v) };
+		return estimate * (Float8AVX2{ 2.f } - x * estimate);
+	}
+
+	SIMD_TARGET_AVX2 inline Float8AVX2 Exp2(const Float8AVX2& x)
+	{
+		const __m256 clamped{ _mm256_min_ps(_mm256_max_ps(x.v, _mm256_set1_ps(-126.99999f)), _mm256_set1_ps(128.f)) };
+		const __m256i integerPart{ _mm256_cvtps_epi32(_mm256_sub_ps(clamped, _mm256_set1_ps(0.5f))) };
+		const Float8AVX2 fraction{ _mm256_sub_ps(clamped, _mm256_cvtepi32_ps(integerPart)) };
+		const Float8AVX2 power{ _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(integerPart, _mm256_set1_epi32(127)), 23)) };
+
+		Float8AVX2 polynomial{ 1.8775767e-3f };
+		polynomial = polynomial * fraction + Float8AVX2{ 8.9893397e-3f };
+		polynomial = polynomial * fraction + Float8AVX2{ 5.5826318e-2f };
+		polynomial = polynomial * fraction + Float8AVX2{ 2.4015361e-1f };
+		polynomial = polynomial * fraction + Float8AVX2{ 6.9315308e-1f };
+		polynomial = polynomial * fraction + Float8AVX2{ 9.9999994e-1f };
+		return power * polynomial;
+	}
+
+	SIMD_TARGET_AVX2 inline Float8AVX2 Log2(const Float8AVX2& x)
+	{
+		const __m256i bits{ _mm256_castps_si256(x.v) };
+		const Float8AVX2 exponent{ _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127))) };
+		const Float8AVX2 mantissa{ _mm256_or_ps(_mm256_castsi256_ps(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF))), _mm256_set1_ps(1.f)) };
+
+		Float8AVX2 polynomial{ -3.4436006e-2f };
+		polynomial = polynomial * mantissa + Float8AVX2{ 3.1821337e-1f };
+		polynomial = polynomial * mantissa + Float8AVX2{ -1.2315303f };
+		polynomial = polynomial * mantissa + Float8AVX2{ 2.5988452f };
+		polynomial = polynomial * mantissa + Float8AVX2{ -3.3241990f };
+		polynomial = polynomial * mantissa + Float8AVX2{ 3.1157899f };
+		return polynomial * (mantissa - Float8AVX2{ 1.f }) + exponent;
+	}
+
+	SIMD_TARGET_AVX2 inline Float8AVX2 Pow(const Float8AVX2& x, const Float8AVX2& y)
+	{
+		return Select(x > Float8AVX2{ 0.f }, Exp2(y * Log2(x)), Float8AVX2{ 0.f });
+	}
+
+	//One bit per lane in an AVX-512 mask register, what Float16AVX512 comparisons return
+	struct Mask16
+	{
+		__mmask16 bits;
+	};
+
+	SIMD_TARGET_AVX512 inline Mask16 operator&(const Mask16& a, const Mask16& b) { return { __mmask16(a.bits & b.bits) }; }
+	SIMD_TARGET_AVX512 inline Mask16 operator|(const Mask16& a, const Mask16& b) { return { __mmask16(a.bits | b.bits) }; }
+	SIMD_TARGET_AVX512 inline int MoveMask(const Mask16& mask) { return int(mask.bits); }
+
+	//16 floats in an AVX-512 register, only for the packet kernels of Kernels.h (AVX-512 CPUs only)
+	//Comparisons write a mask register instead of a vector, every lane still gets the same bits as with Float4
+	struct Float16AVX512
+	{
+		static constexpr int width{ 16 };
+
+		__m512 v;
+
+		Float16AVX512() = default;
+		SIMD_TARGET_AVX512 Float16AVX512(__m512 _v) : v(_v) {}
+		SIMD_TARGET_AVX512 explicit Float16AVX512(float f) : v(_mm512_set1_ps(f)) {}
+
+		SIMD_TARGET_AVX512 static Float16AVX512 Load(const float* pData) { return _mm512_loadu_ps(pData); }
+		SIMD_TARGET_AVX512 void Store(float* pData) const { _mm512_storeu_ps(pData, v); }
+	};
+
+	SIMD_TARGET_AVX512 inline Float16AVX512 operator+(const Float16AVX512& a, const Float16AVX512& b) { return _mm512_add_ps(a.v, b.v); }
+	SIMD_TARGET_AVX512 inline Float16AVX512 operator-(const Float16AVX512& a, const Float16AVX512& b) { return _mm512_sub_ps(a.v, b.v); }
+	SIMD_TARGET_AVX512 inline Float16AVX512 operator*(const Float16AVX512& a, const Float16AVX512& b) { return _mm512_mul_ps(a.v, b.v); }
+	SIMD_TARGET_AVX512 inline Float16AVX512 operator/(const Float16AVX512& a, const Float16AVX512& b) { return _mm512_div_ps(a.v, b.v); }
+
+	SIMD_TARGET_AVX512 inline Mask16 operator<(const Float16AVX512& a, const Float16AVX512& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ) }; }
+	SIMD_TARGET_AVX512 inline Mask16 operator<=(const Float16AVX512& a, const Float16AVX512& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ) }; }
+	SIMD_TARGET_AVX512 inline Mask16 operator>(const Float16AVX512& a, const Float16AVX512& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ) }; }
+	SIMD_TARGET_AVX512 inline Mask16 operator>=(const Float16AVX512& a, const Float16AVX512& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ) }; }
+	SIMD_TARGET_AVX512 inline Mask16 operator==(const Float16AVX512& a, const Float16AVX512& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ) }; }
+
+	SIMD_TARGET_AVX512 inline Float16AVX512 Sqrt(const Float16AVX512& a) { return _mm512_sqrt_ps(a.v); }
+	SIMD_TARGET_AVX512 inline Float16AVX512 Min(const Float16AVX512& a, const Float16AVX512& b) { return _mm512_min_ps(a.v, b.v); }
+	SIMD_TARGET_AVX512 inline Float16AVX512 Max(const Float16AVX512& a, const Float16AVX512& b) { return _mm512_max_ps(a.v, b.v); }
+	SIMD_TARGET_AVX512 inline Float16AVX512 Select(const Mask16& mask, const Float16AVX512& a, const Float16AVX512& b) { return _mm512_mask_blend_ps(mask.bits, b.v, a.v); }
+
+	//rcp14 is more accurate than rcp, estimate with the AVX instruction on both halves so the result matches the other widths
+	SIMD_TARGET_AVX512 inline Float16AVX512 Reciprocal(const Float16AVX512& x)
+	{
+		const __m256 lowEstimate{ _mm256_rcp_ps(_mm512_castps512_ps256(x.v)) };
+		const __m256 highEstimate{ _mm256_rcp_ps(_mm512_extractf32x8_ps(x.v, 1)) };
+		const Float16AVX512 estimate{ _mm512_insertf32x8(_mm512_castps256_ps512(lowEstimate), highEstimate, 1) };
+		return estimate * (Float16AVX512{ 2.f } - x * estimate);
+	}
+#endif
+
+#if defined(__AVX2__)
+	//8 floats per operation, a single AVX register when the compiler targets AVX2
+	using Float8 = Float8AVX2;
+#else
+	//8 floats per operation, two Float4 registers when the compiler doesn't target AVX2
+	struct Float8
+	{
+		static constexpr int width{ 8 };
+
+		Float4 low;
+		Float4 high;
+
+		Float8() = default;
+		Float8(const Float4& _low, const Float4& _high) : low(_low), high(_high) {}
+		explicit Float8(float f) : low(f), high(f) {}
+
+		static Float8 Load(const float* pData) { return { Float4::Load(pData), Float4::Load(pData + Float4::width) }; }
+		void Store(float* pData) const { low.Store(pData); high.Store(pData + Float4::width); }
+	};
+
+	inline Float8 operator+(const Float8& a, const Float8& b) { return { a.low + b.low, a.high + b.high }; }
+	inline Float8 operator-(const Float8& a, const Float8& b) { return { a.low - b.low, a.high - b.high }; }
+	inline Float8 operator*(const Float8& a, const Float8& b) { return { a.low * b.low, a.high * b.high }; }
+	inline Float8 operator/(const Float8& a, const Float8& b) { return { a.low / b.low, a.high / b.high }; }
+
+	inline Float8 operator<(const Float8& a, const Float8& b) { return { a.low < b.low, a.high < b.high }; }
+	inline Float8 operator<=(const Float8& a, const Float8& b) { return { a.low <= b.low, a.high <= b.high }; }
+	inline Float8 operator>(const Float8& a, const Float8& b) { return { a.low > b.low, a.high > b.high }; }
+	inline Float8 operator>=(const Float8& a, const Float8& b) { return { a.low >= b.low, a.high >= b.high }; }
+	inline Float8 operator==(const Float8& a, const Float8& b) { return { a.low == b.low, a.high == b.high }; }
+
+	inline Float8 operator&(const Float8& a, const Float8& b) { return { a.low & b.low, a.high & b.high }; }
+	inline Float8 operator|(const Float8& a, const Float8& b) { return { a.low | b.low, a.high | b.high }; }
+
+	inline Float8 Sqrt(const Float8& a) { return { Sqrt(a.low), Sqrt(a.high) }; }
+	inline Float8 Min(const Float8& a, const Float8& b) { return { Min(a.low, b.low), Min(a.high, b.high) }; }
+	inline Float8 Max(const Float8& a, const Float8& b) { return { Max(a.low, b.low), Max(a.high, b.high) }; }
+	inline Float8 Select(const Float8& mask, const Float8& a, const Float8& b) { return { Select(mask.low, a.low, b.low), Select(mask.high, a.high, b.high) }; }
+	inline int MoveMask(const Float8& mask) { return MoveMask(mask.low) | MoveMask(mask.high) << Float4::width; }
+
+	inline Float8 Reciprocal(const Float8& x) { return { Reciprocal(x.low), Reciprocal(x.high) }; }
+	inline Float8 Exp2(const Float8& x) { return { Exp2(x.low), Exp2(x.high) }; }
+	inline Float8 Log2(const Float8& x) { return { Log2(x.low), Log2(x.high) }; }
+
+	inline Float8 Pow(const Float8& x, const Float8& y)
+	{
+		return Select(x > Float8{ 0.f }, Exp2(y * Log2(x)), Float8{ 0.f });
+	}
+#endif
+
+	//What comparisons of a SIMD type return: the type itself with all bits of a true lane set, Mask16 for Float16AVX512
+	template<typename FloatN>
+	using MaskOf = decltype(std::declval<FloatN>() < std::declval<FloatN>());
+}
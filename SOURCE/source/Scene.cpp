@@ -1,6 +1,11 @@
 #include "Scene.h"
 #include "Utils.h"
 #include "Material.h"
+#include "Kernels.h"
+#include "AssetCache.h"
+
+#include <iterator>
+#include <random>
 
 namespace dae {
 
@@ -9,6 +14,7 @@ namespace dae {
 	Scene::Scene() :
 		m_Materials({ new Material_SolidColor({1,0,0}) })
 	{
+		m_MaterialTable.push_back(m_Materials.front()->GetData());
 		m_SphereGeometries.reserve(32);
 		m_PlaneGeometries.reserve(32);
 		m_TriangleMeshGeometries.reserve(32);
@@ -26,19 +32,20 @@ namespace dae {
 		m_Materials.clear();
 	}
 
-	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit)
+	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit, TraversalCost* pCost)
 	{
 		HitRecord temp{};
 		float smallestT{ ray.max };
 		for (auto& mesh : m_TriangleMeshGeometries)
 		{
-			if (GeometryUtils::HitTest_TriangleMesh(mesh, ray, temp))
+			if (GeometryUtils::HitTest_TriangleMesh(mesh, ray, temp, false, pCost))
 			{
 				smallestT = temp.t;
 				if (closestHit.t > smallestT)
 					closestHit = temp;
 			}
 		}
+		GeometryUtils::HitTest_Instances(m_Instances, m_InstancedMeshes, ray, closestHit, false, pCost);
 		for (const auto& plane : m_PlaneGeometries)
 		{
 			if (GeometryUtils::HitTest_Plane(plane, ray, temp))
@@ -59,32 +66,121 @@ namespace dae {
 					closestHit = temp;
 			}
 		}
-	
-
 
+		if (closestHit.didHit)
+			RAY_STATS_INC(hits);
 	}
 
+	//The packet tests run the variants of the CPU's instruction set (Kernels.h)
+	void Scene::GetClosestHits(const RayPacket& packet, HitRecord* pClosestHits)
+	{
+		const KernelTable& kernels{ Kernels::Get() };
+		for (auto& mesh : m_TriangleMeshGeometries)
+		{
+			kernels.hitTestTriangleMesh(mesh, packet, pClosestHits);
+		}
+		//Every instance has its own object space rays, the lanes go through the top level BVH one by one
+		if (m_Instances.nodesUsed > 0)
+		{
+			for (int lane{}; lane < RayPacket::size; ++lane)
+			{
+				if (packet.isActive[lane])
+					GeometryUtils::HitTest_Instances(m_Instances, m_InstancedMeshes, packet.GetRay(lane), pClosestHits[lane]);
+			}
+		}
+
+		//Inactive lanes can never get closer than -FLT_MAX
+		float closestT[RayPacket::size];
+		for (int lane{}; lane < RayPacket::size; ++lane)
+		{
+			closestT[lane] = packet.isActive[lane] ? pClosestHits[lane].t : -FLT_MAX;
+		}
+
+		for (const auto& plane : m_PlaneGeometries)
+		{
+			kernels.hitTestPlane(plane, packet, closestT, pClosestHits);
+		}
+		for (const auto& sphere : m_SphereGeometries)
+		{
+			kernels.hitTestSphere(sphere, packet, closestT, pClosestHits);
+		}
+
+#if defined(RAY_STATS)
+		for (int lane{}; lane < RayPacket::size; ++lane)
+		{
+			if (pClosestHits[lane].didHit)
+				RAY_STATS_INC(hits);
+		}
+#endif
+	}
 
 	bool Scene::DoesHit(const Ray& ray)
 	{
 		for (const auto& sphere : m_SphereGeometries)
 		{
 			if (GeometryUtils::HitTest_Sphere(sphere, ray))
+			{
+				RAY_STATS_INC(hits);
 				return true;
+			}
 		}
 		for (const auto& plane : m_PlaneGeometries)
 		{
 			if (GeometryUtils::HitTest_Plane(plane, ray))
+			{
+				RAY_STATS_INC(hits);
 				return true;
+			}
 		}
 		for (auto& mesh : m_TriangleMeshGeometries)
 		{
 			if (GeometryUtils::HitTest_TriangleMesh(mesh, ray))
+			{
+				RAY_STATS_INC(hits);
 				return true;
+			}
+		}
+		if (GeometryUtils::HitTest_Instances(m_Instances, m_InstancedMeshes, ray))
+		{
+			RAY_STATS_INC(hits);
+			return true;
 		}
 		return false;
 	}
 
+	void Scene::DoesHit(const ShadowRayPacket& packet, bool* pIsOccluded)
+	{
+		const KernelTable& kernels{ Kernels::Get() };
+		for (const auto& sphere : m_SphereGeometries)
+		{
+			kernels.occlusionTestSphere(sphere, packet, pIsOccluded);
+		}
+		for (const auto& plane : m_PlaneGeometries)
+		{
+			kernels.occlusionTestPlane(plane, packet, pIsOccluded);
+		}
+		for (auto& mesh : m_TriangleMeshGeometries)
+		{
+			kernels.occlusionTestTriangleMesh(mesh, packet, pIsOccluded);
+		}
+		if (m_Instances.nodesUsed > 0)
+		{
+			for (int lane{}; lane < ShadowRayPacket::size; ++lane)
+			{
+				if (packet.isActive[lane] && !pIsOccluded[lane])
+					pIsOccluded[lane] = GeometryUtils::HitTest_Instances(m_Instances, m_InstancedMeshes, packet.GetRay(lane));
+			}
+		}
+
+#if defined(RAY_STATS)
+		for (int lane{}; lane < ShadowRayPacket::size; ++lane)
+		{
+			if (pIsOccluded[lane])
+				RAY_STATS_INC(hits);
+		}
+#endif
+	}
+
 #pragma region Scene Helpers
 	Sphere* Scene::AddSphere(const Vector3& origin, float radius, unsigned char materialIndex)
 	{
@@ -114,11 +210,55 @@ namespace dae {
 		m.cullMode = cullMode;
 		m.materialIndex = materialIndex;
 	
-		m_TriangleMeshGeometries.emplace_back(m);
+		m_TriangleMeshGeometries.emplace_back(std::move(m));
 		return &m_TriangleMeshGeometries.back();
 		
 	}
 
+	TriangleMesh* Scene::AddTriangleMesh(const std::string& filename, TriangleCullMode cullMode, unsigned char materialIndex)
+	{
+		TriangleMesh m{};
+		if (!AssetCache::LoadMesh(filename, m))
+			return nullptr;
+		m.cullMode = cullMode;
+		m.materialIndex = materialIndex;
+
+		m_TriangleMeshGeometries.emplace_back(std::move(m));
+		return &m_TriangleMeshGeometries.back();
+	}
+
+	int Scene::AddInstancedMesh(const std::string& filename, TriangleCullMode cullMode, unsigned char materialIndex)
+	{
+		TriangleMesh m{};
+		if (!AssetCache::LoadMesh(filename, m))
+			return -1;
+		m.cullMode = cullMode;
+		m.materialIndex = materialIndex;
+
+		//The identity transform: the triangles are the object space ones and the BVH is the shared one of the asset
+		m.UpdateTransforms();
+		m.FillTriangleList();
+		m.BuildBVH();
+
+		m_InstancedMeshes.emplace_back(std::move(m));
+		return static_cast<int>(m_InstancedMeshes.size() - 1);
+	}
+
+	void Scene::AddMeshInstance(int meshIdx, const Matrix& transform)
+	{
+		m_Instances.AddInstance(static_cast<uint32_t>(meshIdx), m_InstancedMeshes[meshIdx], transform);
+	}
+
+	void Scene::AddMeshInstance(int meshIdx, const Matrix& transform, unsigned char materialIndex)
+	{
+		m_Instances.AddInstance(static_cast<uint32_t>(meshIdx), m_InstancedMeshes[meshIdx], transform, materialIndex);
+	}
+
+	void Scene::BuildInstances()
+	{
+		m_Instances.Build();
+	}
+
 	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
 	{
 		Light l;
@@ -146,6 +286,7 @@ namespace dae {
 	unsigned char Scene::AddMaterial(Material* pMaterial)
 	{
 		m_Materials.push_back(pMaterial);
+		m_MaterialTable.push_back(pMaterial->GetData());
 		return static_cast<unsigned char>(m_Materials.size() - 1);
 	}
 #pragma endregion
@@ -296,19 +437,10 @@ namespace dae {
 		AddPlane({ -5.0f,.0f,.0f }, { 1.f,0.f,0.f }, matLambert_GrayBlue); //Left
 
 
-		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/lowpoly_bunny2.obj"
-			, pMesh->positions
-			, pMesh->normals
-			, pMesh->indices);
-
-		pMesh->transformedPositions.reserve(pMesh->positions.size());
-		pMesh->transformedNormals.reserve(pMesh->normals.size());
-
+		pMesh = AddTriangleMesh("Resources/lowpoly_bunny2.obj", TriangleCullMode::BackFaceCulling, matLambert_White);
 
 		pMesh->Scale({ 2.f,2.f,2.f });
 		pMesh->UpdateTransforms();
-		pMesh->UpdateAABB();
 
 		pMesh->FillTriangleList();
 		pMesh->BuildBVH();
@@ -325,9 +457,15 @@ namespace dae {
 
 		const auto yawAngle = (cos(pTimer->GetTotal()) + 1.f) / 2.f * PI_2;
 		pMesh->RotateY(yawAngle);
-		pMesh->UpdateTransforms();
-		pMesh->UpdateTriangleList();
-
+		{
+			Timer::ScopedZone zone{ TimerZone::VertexTransform };
+			pMesh->UpdateTransforms();
+			pMesh->UpdateTriangleList();
+		}
+		{
+			Timer::ScopedZone zone{ TimerZone::BVHRefit };
+			pMesh->RefitBVH();
+		}
 	}
 
 	void Scene_W4_ReferenceScene::Initialize()
@@ -409,9 +547,15 @@ namespace dae {
 		for (const auto m : m_Meshes)
 		{
 			m->RotateY(yawAngle);
-			m->UpdateTransforms();
-			m->UpdateTriangleList();
-
+			{
+				Timer::ScopedZone zone{ TimerZone::VertexTransform };
+				m->UpdateTransforms();
+				m->UpdateTriangleList();
+			}
+			{
+				Timer::ScopedZone zone{ TimerZone::BVHRefit };
+				m->RefitBVH();
+			}
 		}
 	}
 
@@ -431,18 +575,11 @@ namespace dae {
 		
 
 
-		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_Magenta);
-		Utils::ParseOBJ("Resources/Test.obj"
-			, pMesh->positions
-			, pMesh->normals
-			, pMesh->indices);
+		pMesh = AddTriangleMesh("Resources/Test.obj", TriangleCullMode::BackFaceCulling, matLambert_Magenta);
 
-		pMesh->transformedPositions.reserve(pMesh->positions.size());
-		pMesh->transformedNormals.reserve(pMesh->normals.size());
 		pMesh->Scale({ 1.f,1.f,1.f });
 		pMesh->Translate({ 0,3.f,0.f });
 		pMesh->UpdateTransforms();
-		pMesh->UpdateAABB();
 		pMesh->FillTriangleList();
 		pMesh->BuildBVH();
 
@@ -461,10 +598,61 @@ namespace dae {
 
 		pMesh->RotateY(yawAngle);
 		pMesh->Translate({0, 3 + sinf(yawAngle),0});
-		pMesh->UpdateTransforms();
-		pMesh->UpdateTriangleList();
+		{
+			Timer::ScopedZone zone{ TimerZone::VertexTransform };
+			pMesh->UpdateTransforms();
+			pMesh->UpdateTriangleList();
+		}
+		{
+			Timer::ScopedZone zone{ TimerZone::BVHRefit };
+			pMesh->RefitBVH();
+		}
 	}
 
 
+	void Scene_W4_InstancingScene::Initialize()
+	{
+		sceneName = "Instancing Scene";
+		m_Camera.origin = { 0.f,6.f,-12.f };
+		m_Camera.fovAngle = 45.f;
+		m_Camera.totalPitch = -.25f;
+
+		const unsigned char bunnyMaterials[]{
+			AddMaterial(new Material_Lambert({ .9f,.9f,.9f }, 1.f)),
+			AddMaterial(new Material_Lambert({ .8f,.45f,.3f }, 1.f)),
+			AddMaterial(new Material_CookTorrence({ .972f,.960f,.915f }, 1.f, .4f)),
+			AddMaterial(new Material_CookTorrence({ .3f,.5f,.8f }, .0f, .6f)) };
+		const auto matLambert_Green = AddMaterial(new Material_Lambert({ .2f,.5f,.15f }, 1.f));
+
+		AddPlane({ 0.f,0.f,0.f }, { 0.f,1.f,0.f }, matLambert_Green); //Bottom
+
+		//1000 x 1000 bunnies, each with its own yaw and size and one of the materials
+		const int bunnyIdx{ AddInstancedMesh("Resources/lowpoly_bunny2.obj", TriangleCullMode::BackFaceCulling, bunnyMaterials[0]) };
+		if (bunnyIdx >= 0)
+		{
+			constexpr int numBunniesPerRow{ 1000 };
+			constexpr float spacing{ 2.f };
+			std::mt19937 generator{ 1337 };
+			std::uniform_real_distribution<float> yawDistribution{ 0.f, PI_2 };
+			std::uniform_real_distribution<float> scaleDistribution{ .6f, 1.2f };
+			std::uniform_int_distribution<int> materialDistribution{ 0, static_cast<int>(std::size(bunnyMaterials)) - 1 };
+			for (int row{}; row < numBunniesPerRow; ++row)
+			{
+				for (int column{}; column < numBunniesPerRow; ++column)
+				{
+					const float scale{ scaleDistribution(generator) };
+					const Vector3 position{ (column - numBunniesPerRow / 2) * spacing, 0.f, row * spacing };
+					const Matrix transform{ Matrix::CreateScale(scale, scale, scale) * Matrix::CreateRotationY(yawDistribution(generator)) * Matrix::CreateTranslation(position) };
+					AddMeshInstance(bunnyIdx, transform, bunnyMaterials[materialDistribution(generator)]);
+				}
+			}
+			BuildInstances();
+		}
+
+		//Light
+		AddPointLight({ -20.f,40.f,30.f }, 2500.f, { 1.f,.9f,.8f });
+		AddPointLight({ 0.f,8.f,-5.f }, 80.f, { .34f,.47f,.68f });
+	}
+
 #pragma endregion
 }
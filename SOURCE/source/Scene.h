@@ -5,6 +5,7 @@
 #include "Math.h"
 #include "DataTypes.h"
 #include "Camera.h"
+#include "Material.h"
 
 namespace dae
 {
@@ -34,13 +35,19 @@ namespace dae
 		}
 
 		Camera& GetCamera() { return m_Camera; }
-		void GetClosestHit(const Ray& ray, HitRecord& closestHit);
+		void GetClosestHit(const Ray& ray, HitRecord& closestHit, TraversalCost* pCost = nullptr);
+		//Closest hit of every active lane of a coherent packet, same results as GetClosestHit per ray
+		void GetClosestHits(const RayPacket& packet, HitRecord* pClosestHits);
 		bool DoesHit(const Ray& ray);
+		//Sets pIsOccluded for every active lane whose shadow ray is blocked, same results as DoesHit per ray
+		void DoesHit(const ShadowRayPacket& packet, bool* pIsOccluded);
 
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
 		const std::vector<Light>& GetLights() const { return m_Lights; }
 		const std::vector<Material*> GetMaterials() const { return m_Materials; }
+		//Flat copy of every material, in the same order (see MaterialData)
+		const std::vector<MaterialData>& GetMaterialTable() const { return m_MaterialTable; }
 
 	protected:
 		std::string	sceneName;
@@ -48,8 +55,12 @@ namespace dae
 		std::vector<Plane> m_PlaneGeometries{};
 		std::vector<Sphere> m_SphereGeometries{};
 		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
+		//Object space meshes placed through m_Instances
+		std::vector<TriangleMesh> m_InstancedMeshes{};
+		InstanceBVH m_Instances{};
 		std::vector<Light> m_Lights{};
 		std::vector<Material*> m_Materials{};
+		std::vector<MaterialData> m_MaterialTable{};
 
 		//Temp (individual triangle testing)
 		//std::vector<Triangle> m_Triangles{};
@@ -59,6 +70,15 @@ namespace dae
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
 		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		//Mesh sharing the geometry and BVH of the file with every other mesh made from it (see AssetCache), nullptr when it can't be loaded
+		TriangleMesh* AddTriangleMesh(const std::string& filename, TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		//Mesh only placed through instances, it stays in object space, -1 when the file can't be loaded
+		int AddInstancedMesh(const std::string& filename, TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		//A placement of an instanced mesh, the transform like TriangleMesh's (scale * rotation * translation)
+		//Only a MeshInstance gets stored, call BuildInstances after the last one
+		void AddMeshInstance(int meshIdx, const Matrix& transform);
+		void AddMeshInstance(int meshIdx, const Matrix& transform, unsigned char materialIndex);
+		void BuildInstances();
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
@@ -173,5 +193,20 @@ namespace dae
 	private:
 		TriangleMesh* pMesh{nullptr};
 	};
+
+	//A field of a million bunnies: one shared bunny mesh + a MeshInstance per bunny under the top level BVH
+	class Scene_W4_InstancingScene final : public Scene
+	{
+	public:
+		Scene_W4_InstancingScene() = default;
+		~Scene_W4_InstancingScene() override = default;
+
+		Scene_W4_InstancingScene(const Scene_W4_InstancingScene&) = delete;
+		Scene_W4_InstancingScene(Scene_W4_InstancingScene&&) noexcept = delete;
+		Scene_W4_InstancingScene& operator=(const Scene_W4_InstancingScene&) = delete;
+		Scene_W4_InstancingScene& operator=(Scene_W4_InstancingScene&&) noexcept = delete;
+
+		void Initialize() override;
+	};
 	
 }
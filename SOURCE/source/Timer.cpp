@@ -3,12 +3,146 @@
 #include <iostream>
 #include <numeric>
 
+#include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <cstring>
 
 #include "SDL.h"
+#include "Tracer.h"
 using namespace dae;
 
+#pragma region Zones
+//Zone counters of a single thread, on their own cache line so workers never share one
+struct alignas(64) ThreadZoneCounts
+{
+	std::array<uint64_t, size_t(TimerZone::Count)> counts{};
+};
+
+static std::mutex g_ZoneRegistryMutex{};
+static std::vector<std::unique_ptr<ThreadZoneCounts>> g_ThreadZoneCounts{};
+
+static const char* g_ZoneNames[size_t(TimerZone::Count)]
+{
+	"Scene update",
+	"  Vertex transform",
+	"  BVH refit",
+	"Primary rays*",
+	"Shading*",
+	"Shadow rays*",
+	"Surface present",
+	"Screenshot save"
+};
+
+static uint64_t* GetThreadZoneCounts()
+{
+	thread_local uint64_t* pZoneCounts{ nullptr };
+	if (!pZoneCounts)
+	{
+		const std::lock_guard<std::mutex> lock{ g_ZoneRegistryMutex };
+		g_ThreadZoneCounts.push_back(std::make_unique<ThreadZoneCounts>());
+		pZoneCounts = g_ThreadZoneCounts.back()->counts.data();
+	}
+	return pZoneCounts;
+}
+
+Timer::ScopedZone::ScopedZone(TimerZone zone) :
+	m_Zone(zone),
+	m_StartCount(SDL_GetPerformanceCounter())
+{
+}
+
+Timer::ScopedZone::~ScopedZone()
+{
+	const uint64_t endCount{ SDL_GetPerformanceCounter() };
+	GetThreadZoneCounts()[size_t(m_Zone)] += endCount - m_StartCount;
+
+	//Stages show up in the trace as well, without the indentation used by PrintZones
+	if (Tracer::IsRecording())
+	{
+		const char* pName{ g_ZoneNames[size_t(m_Zone)] };
+		Tracer::Record(pName + strspn(pName, " "), m_StartCount, endCount);
+	}
+}
+
+#if defined(TIMER_PIXEL_ZONES)
+Timer::ZoneLaps::ZoneLaps(uint32_t sequenceIdx)
+{
+	if (sequenceIdx % m_SampleRate == 0)
+	{
+		m_pZoneCounts = GetThreadZoneCounts();
+		m_LastCount = SDL_GetPerformanceCounter();
+	}
+}
+
+void Timer::ZoneLaps::Lap(TimerZone zone)
+{
+	if (!m_pZoneCounts)
+		return;
+
+	const uint64_t currentCount = SDL_GetPerformanceCounter();
+	m_pZoneCounts[size_t(zone)] += (currentCount - m_LastCount) * m_SampleRate;
+	m_LastCount = currentCount;
+}
+#endif
+
+void Timer::CommitZones()
+{
+	//Called between frames, no worker is writing to its counters
+	ZoneTimes& zoneTimes = m_ZoneHistory[m_ZoneHistoryIdx];
+	zoneTimes.fill(0.f);
+
+	const std::lock_guard<std::mutex> lock{ g_ZoneRegistryMutex };
+	for (const auto& pThreadZoneCounts : g_ThreadZoneCounts)
+	{
+		for (size_t zone{}; zone < zoneTimes.size(); ++zone)
+		{
+			zoneTimes[zone] += pThreadZoneCounts->counts[zone] * m_SecondsPerCount * 1000.f;
+		}
+		pThreadZoneCounts->counts.fill(0);
+	}
+	m_FrameHistory[m_ZoneHistoryIdx] = m_ElapsedTime * 1000.f;
+
+	m_ZoneHistoryIdx = (m_ZoneHistoryIdx + 1) % m_NumZoneFrames;
+	m_ZoneHistoryCount = std::min(m_ZoneHistoryCount + 1, m_NumZoneFrames);
+}
+
+void Timer::PrintZones(std::ostream& stream) const
+{
+	stream << "**FRAME ZONES** (last " << m_ZoneHistoryCount << " frames, ms, * = summed over worker threads, sampled per pixel)\n";
+	stream << std::left << std::setw(20) << "ZONE" << std::right
+		<< std::setw(10) << "MIN" << std::setw(10) << "AVG" << std::setw(10) << "MAX" << '\n';
+	if (m_ZoneHistoryCount == 0)
+		return;
+
+	const auto printRow = [&](const char* name, auto getTime)
+		{
+			float low{ FLT_MAX };
+			float high{ 0.f };
+			float sum{ 0.f };
+			for (int frame{ 0 }; frame < m_ZoneHistoryCount; ++frame)
+			{
+				const float time{ getTime(frame) };
+				low = std::min(low, time);
+				high = std::max(high, time);
+				sum += time;
+			}
+
+			stream << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(3)
+				<< std::setw(10) << low << std::setw(10) << sum / float(m_ZoneHistoryCount) << std::setw(10) << high << '\n';
+		};
+
+	for (size_t zone{}; zone < size_t(TimerZone::Count); ++zone)
+	{
+		printRow(g_ZoneNames[zone], [&](int frame) { return m_ZoneHistory[frame][zone]; });
+	}
+	printRow("Frame", [&](int frame) { return m_FrameHistory[frame]; });
+	stream << std::defaultfloat;
+}
+#pragma endregion
+
 Timer::Timer()
 {
 	const uint64_t countsPerSecond = SDL_GetPerformanceFrequency();
@@ -90,6 +224,8 @@ void Timer::Update()
 
 	m_TotalTime = (float)(((m_CurrentTime - m_PausedTime) - m_BaseTime) * m_SecondsPerCount);
 
+	CommitZones();
+
 	//FPS LOGIC
 	m_FPSTimer += m_ElapsedTime;
 	++m_FPSCount;
@@ -1,14 +1,69 @@
 #pragma once
 
 //Standard includes
+#include <array>
 #include <cstdint>
+#include <iosfwd>
 #include <vector>
 
+//Comment out to remove the per pixel timestamps (primary rays, shading and shadow rays zones) from the render loop
+#define TIMER_PIXEL_ZONES
+
 namespace dae
 {
+	//Named stages of a frame, nested zones are inclusive (SceneUpdate contains VertexTransform and BVHRefit)
+	enum class TimerZone
+	{
+		SceneUpdate,
+		VertexTransform,
+		BVHRefit,
+		PrimaryRays, //summed over all worker threads
+		Shading, //summed over all worker threads
+		ShadowRays, //summed over all worker threads
+		SurfacePresent,
+		ScreenshotSave,
+		Count
+	};
+
 	class Timer
 	{
 	public:
+		//Times the enclosing scope into a zone, can be used on any thread
+		class ScopedZone final
+		{
+		public:
+			explicit ScopedZone(TimerZone zone);
+			~ScopedZone();
+
+			ScopedZone(const ScopedZone&) = delete;
+			ScopedZone(ScopedZone&&) noexcept = delete;
+			ScopedZone& operator=(const ScopedZone&) = delete;
+			ScopedZone& operator=(ScopedZone&&) noexcept = delete;
+
+		private:
+			TimerZone m_Zone;
+			uint64_t m_StartCount;
+		};
+
+		//Splits a sequence of work into back to back zones, one counter read per Lap
+		//Only one in m_SampleRate sequences is timed (and weighted up), that keeps the counter reads out of most pixels
+		class ZoneLaps final
+		{
+		public:
+#if defined(TIMER_PIXEL_ZONES)
+			explicit ZoneLaps(uint32_t sequenceIdx);
+			void Lap(TimerZone zone);
+
+		private:
+			static constexpr uint32_t m_SampleRate{ 8 };
+			uint64_t* m_pZoneCounts{ nullptr };
+			uint64_t m_LastCount{ 0 };
+#else
+			explicit ZoneLaps(uint32_t) {}
+			void Lap(TimerZone) {}
+#endif
+		};
+
 		Timer();
 		virtual ~Timer() = default;
 
@@ -30,6 +85,9 @@ namespace dae
 		float GetTotal() const { return m_TotalTime; };
 		bool IsRunning() const { return !m_IsStopped; };
 
+		//Min/avg/max of every zone over the last m_NumZoneFrames frames
+		void PrintZones(std::ostream& stream) const;
+
 	private:
 		uint64_t m_BaseTime = 0;
 		uint64_t m_PausedTime = 0;
@@ -57,5 +115,14 @@ namespace dae
 		int m_BenchmarkFrames{ 0 };
 		int m_BenchmarkCurrFrame{ 0 };
 		std::vector<float> m_Benchmarks{};
+
+		static constexpr int m_NumZoneFrames{ 120 };
+		using ZoneTimes = std::array<float, size_t(TimerZone::Count)>;
+		std::vector<ZoneTimes> m_ZoneHistory = std::vector<ZoneTimes>(m_NumZoneFrames); //ring buffer of milliseconds per zone
+		std::vector<float> m_FrameHistory = std::vector<float>(m_NumZoneFrames); //ring buffer of milliseconds per frame
+		int m_ZoneHistoryIdx{ 0 };
+		int m_ZoneHistoryCount{ 0 };
+
+		void CommitZones();
 	};
 }
@@ -0,0 +1,164 @@
+#include "Tracer.h"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SDL.h"
+
+namespace dae
+{
+	namespace Tracer
+	{
+		struct Event
+		{
+			const char* name;
+			const char* arg0Name;
+			const char* arg1Name;
+			int32_t arg0;
+			int32_t arg1;
+			uint64_t startCount;
+			uint64_t endCount;
+		};
+
+		//Only ever written by its own thread, read by the main thread between frames
+		struct alignas(64) ThreadBuffer
+		{
+			int threadIdx{};
+			bool isMainThread{};
+			size_t numDropped{};
+			std::vector<Event> events{};
+		};
+
+		//Events a thread can record before new ones get dropped
+		static constexpr size_t g_ThreadBufferCapacity{ 1 << 16 };
+
+		std::atomic<bool> g_IsRecording{ false };
+		static int g_NumFramesLeft{ 0 };
+		static uint64_t g_StartCount{ 0 };
+		static std::thread::id g_MainThreadId{};
+
+		static std::mutex g_RegistryMutex{};
+		static std::vector<std::unique_ptr<ThreadBuffer>> g_ThreadBuffers{};
+
+		static ThreadBuffer* RegisterThread()
+		{
+			const std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+
+			g_ThreadBuffers.push_back(std::make_unique<ThreadBuffer>());
+			ThreadBuffer* pBuffer = g_ThreadBuffers.back().get();
+			pBuffer->threadIdx = static_cast<int>(g_ThreadBuffers.size()) - 1;
+			pBuffer->isMainThread = std::this_thread::get_id() == g_MainThreadId;
+			pBuffer->events.reserve(g_ThreadBufferCapacity);
+
+			return pBuffer;
+		}
+
+		static void WriteJson(const char* filePath)
+		{
+			const double microsecondsPerCount{ 1e6 / double(SDL_GetPerformanceFrequency()) };
+
+			std::ofstream fileStream(filePath);
+			fileStream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+			bool isFirst{ true };
+			size_t numEvents{};
+			size_t numDropped{};
+			for (const auto& pBuffer : g_ThreadBuffers)
+			{
+				//Metadata event that names the track of this thread
+				fileStream << (isFirst ? "" : ",\n")
+					<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << pBuffer->threadIdx
+					<< ",\"args\":{\"name\":\"";
+				if (pBuffer->isMainThread)
+					fileStream << "Main";
+				else
+					fileStream << "Worker " << pBuffer->threadIdx;
+				fileStream << "\"}}";
+				isFirst = false;
+
+				for (const Event& event : pBuffer->events)
+				{
+					fileStream << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"raytracer\",\"ph\":\"X\",\"pid\":1,\"tid\":" << pBuffer->threadIdx
+						<< ",\"ts\":" << double(event.startCount - g_StartCount) * microsecondsPerCount
+						<< ",\"dur\":" << double(event.endCount - event.startCount) * microsecondsPerCount;
+
+					if (event.arg0Name)
+					{
+						fileStream << ",\"args\":{\"" << event.arg0Name << "\":" << event.arg0;
+						if (event.arg1Name)
+							fileStream << ",\"" << event.arg1Name << "\":" << event.arg1;
+						fileStream << '}';
+					}
+					fileStream << '}';
+				}
+
+				numEvents += pBuffer->events.size();
+				numDropped += pBuffer->numDropped;
+			}
+			fileStream << "\n]}\n";
+			fileStream.close();
+
+			std::cout << "Trace saved to " << filePath << " (" << numEvents << " events";
+			if (numDropped > 0)
+				std::cout << ", " << numDropped << " dropped";
+			std::cout << ")\n";
+		}
+
+		uint64_t GetCounter()
+		{
+			return SDL_GetPerformanceCounter();
+		}
+
+		void Record(const char* name, uint64_t startCount, uint64_t endCount, const char* arg0Name, int32_t arg0, const char* arg1Name, int32_t arg1)
+		{
+			thread_local ThreadBuffer* pBuffer{ RegisterThread() };
+
+			if (pBuffer->events.size() == g_ThreadBufferCapacity)
+			{
+				++pBuffer->numDropped;
+				return;
+			}
+			pBuffer->events.push_back({ name, arg0Name, arg1Name, arg0, arg1, startCount, endCount });
+		}
+
+		void StartRecording(int numFrames)
+		{
+			if (IsRecording())
+			{
+				std::cout << "(Trace already recording)\n";
+				return;
+			}
+
+			for (const auto& pBuffer : g_ThreadBuffers)
+			{
+				pBuffer->events.clear();
+				pBuffer->numDropped = 0;
+			}
+
+			g_NumFramesLeft = numFrames;
+			g_MainThreadId = std::this_thread::get_id();
+			g_StartCount = GetCounter();
+			g_IsRecording.store(true, std::memory_order_relaxed);
+
+			std::cout << "**TRACE STARTED** (" << numFrames << " frames)\n";
+		}
+
+		void EndFrame(const char* filePath)
+		{
+			if (!IsRecording())
+				return;
+
+			if (--g_NumFramesLeft > 0)
+				return;
+
+			g_IsRecording.store(false, std::memory_order_relaxed);
+
+			const std::lock_guard<std::mutex> lock{ g_RegistryMutex };
+			WriteJson(filePath);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace dae
+{
+	//Opt-in recorder of Chrome trace events, open the file in chrome://tracing or https://ui.perfetto.dev
+	//Every thread appends to its own preallocated buffer, so recording never takes a lock or shares a cache line
+	namespace Tracer
+	{
+		//Records the next numFrames frames
+		void StartRecording(int numFrames = 10);
+
+		//Call once per frame on the main thread (workers idle), writes the file after the last recorded frame
+		void EndFrame(const char* filePath = "trace.json");
+
+		extern std::atomic<bool> g_IsRecording;
+		inline bool IsRecording() { return g_IsRecording.load(std::memory_order_relaxed); }
+
+		uint64_t GetCounter();
+		void Record(const char* name, uint64_t startCount, uint64_t endCount,
+			const char* arg0Name = nullptr, int32_t arg0 = 0, const char* arg1Name = nullptr, int32_t arg1 = 0);
+
+		//Records the enclosing scope as a complete event on the calling thread
+		class ScopedEvent final
+		{
+		public:
+			explicit ScopedEvent(const char* name, const char* arg0Name = nullptr, int32_t arg0 = 0, const char* arg1Name = nullptr, int32_t arg1 = 0) :
+				m_Name(name), m_Arg0Name(arg0Name), m_Arg1Name(arg1Name), m_Arg0(arg0), m_Arg1(arg1),
+				m_StartCount(IsRecording() ? GetCounter() : 0)
+			{
+			}
+
+			~ScopedEvent()
+			{
+				if (m_StartCount != 0 && IsRecording())
+					Record(m_Name, m_StartCount, GetCounter(), m_Arg0Name, m_Arg0, m_Arg1Name, m_Arg1);
+			}
+
+			ScopedEvent(const ScopedEvent&) = delete;
+			ScopedEvent(ScopedEvent&&) noexcept = delete;
+			ScopedEvent& operator=(const ScopedEvent&) = delete;
+			ScopedEvent& operator=(ScopedEvent&&) noexcept = delete;
+
+		private:
+			const char* m_Name;
+			const char* m_Arg0Name;
+			const char* m_Arg1Name;
+			int32_t m_Arg0;
+			int32_t m_Arg1;
+			uint64_t m_StartCount;
+		};
+	}
+}
@@ -1,8 +1,13 @@
 #pragma once
+#include <bit>
 #include <cassert>
-#include <fstream>
 #include "Math.h"
 #include "DataTypes.h"
+#include "MeshCleanup.h"
+#include "OBJLoader.h"
+#include "RayStats.h"
+#include "SIMD.h"
+#include "FastMath.h"
 
 namespace dae
 {
@@ -33,8 +38,13 @@ namespace dae
 				{
 					q = -0.5f * (b - sqrt(discriminant));
 				}
+#if defined(FAST_MATH)
+				t0 = q * FastMath::Reciprocal(a);
+				t1 = c * FastMath::Reciprocal(q);
+#else
 				t0 = q / a;
 				t1 = c / q;
+#endif
 
 			}
 			else
@@ -89,16 +99,19 @@ namespace dae
 			{
 				return false;
 			}
-			if (t > epsilon && ignoreHitRecord == false)
+			if (t <= epsilon)
+			{
+				return false;
+			}
+			if (ignoreHitRecord == false)
 			{
 				hitRecord.normal = plane.normal;
 				hitRecord.didHit = true;
 				hitRecord.materialIndex = plane.materialIndex;
 				hitRecord.origin = ray.origin + (ray.direction * t);
 				hitRecord.t = t;
-				return true;
 			}
-
+			return true;
 		}
 
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
@@ -111,6 +124,8 @@ namespace dae
 		//TRIANGLE HIT-TESTS
 		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
+			RAY_STATS_INC(triangleTests);
+
 			//const float epsilon{ FLT_EPSILON };
 			//const Vector3 center{ (triangle.v0 + triangle.v1 + triangle.v2) * 0.3333333f }; //center of the triangle
 			//const Vector3 v{ ray.direction };
@@ -243,6 +258,8 @@ namespace dae
 #pragma region TriangeMesh HitTest
 		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
 		{
+			RAY_STATS_INC(slabTests);
+
 			float tx1 = (mesh.transformedMinAABB.x - ray.origin.x) / ray.direction.x;
 			float tx2 = (mesh.transformedMaxAABB.x - ray.origin.x) / ray.direction.x;
 
@@ -265,6 +282,7 @@ namespace dae
 		}
 		inline bool SlabTest_BVH(const Ray& ray, const Vector3& bmin, const Vector3& bmax)
 		{
+			RAY_STATS_INC(slabTests);
 			float tx1 = (bmin.x - ray.origin.x) / ray.direction.x, tx2 = (bmax.x - ray.origin.x) / ray.direction.x;
 			float tmin = std::min(tx1, tx2), tmax = std::max(tx1, tx2);
 			float ty1 = (bmin.y - ray.origin.y) / ray.direction.y, ty2 = (bmax.y - ray.origin.y) / ray.direction.y;
@@ -274,19 +292,27 @@ namespace dae
 			return tmax >= tmin && tmax > 0;
 		}
 
-		inline bool HitTest_BVH(TriangleMesh& mesh, const Ray& ray, const unsigned int nodeIdx, HitRecord& temp, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline bool HitTest_BVH(TriangleMesh& mesh, const Ray& ray, const unsigned int nodeIdx, HitRecord& temp, HitRecord& hitRecord, bool ignoreHitRecord = false, TraversalCost* pCost = nullptr)
 		{
-			BVHNode& node = mesh.bvhNodePool[nodeIdx];
+			RAY_STATS_INC(nodesVisited);
+			if (pCost)
+				++pCost->nodesVisited;
+
+			const BVHNode& node = mesh.GetBVHNodes()[nodeIdx];
 			//If the node's AABB is not hit, return
 			if (!SlabTest_BVH(ray, node.aabbMin, node.aabbMax)) return false;
 
 			// Check if node has triangles ( IsLeaf() { return triCount > 0; } )
 			if (node.IsLeaf())
 			{
+				if (pCost)
+					pCost->triangleTests += node.triCount;
+
+				Triangle decoded{};
 				for (int i{}; i < (int)node.triCount; ++i)
 				{
 
-					if (HitTest_Triangle(mesh.triangles[mesh.triIdx[node.firstTriIdx + i]], ray, temp))
+					if (HitTest_Triangle(mesh.GetTriangle(mesh.GetTriIdx()[node.firstTriIdx + i], decoded), ray, temp))
 					{
 						if (ignoreHitRecord)
 							return true;
@@ -298,13 +324,13 @@ namespace dae
 			}
 			else
 			{
-				HitTest_BVH(mesh, ray, node.leftNode, temp, hitRecord);
-				HitTest_BVH(mesh, ray, node.leftNode + 1, temp, hitRecord);
+				HitTest_BVH(mesh, ray, node.leftNode, temp, hitRecord, false, pCost);
+				HitTest_BVH(mesh, ray, node.leftNode + 1, temp, hitRecord, false, pCost);
 			}
 			return hitRecord.didHit;
 
 		}
-		inline bool HitTest_TriangleMesh(TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline bool HitTest_TriangleMesh(TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false, TraversalCost* pCost = nullptr)
 		{
 			//temporary hitrecord to store triangle hits
 			HitRecord temp{};
@@ -314,7 +340,7 @@ namespace dae
 				return false;
 			}
 
-			return HitTest_BVH(mesh, ray, mesh.rootNodeIdx, temp, hitRecord, ignoreHitRecord);
+			return HitTest_BVH(mesh, ray, mesh.rootNodeIdx, temp, hitRecord, ignoreHitRecord, pCost);
 
 
 		}
@@ -329,6 +355,688 @@ namespace dae
 
 
 
+#pragma endregion
+#pragma region RayPacket HitTest
+		//The packet kernels are templates over the SIMD type so Kernels.h can compile them for every instruction set,
+		//FloatN::width lanes per iteration (Float4 when called directly), every width gives the same results
+		//Active lanes are passed around as one bit per lane
+		static_assert(RayPacket::size == 64, "lane masks are 64 bit");
+
+		//Deeper than a midpoint split BVH gets before the float precision stops the splitting (about 24 halvings per axis)
+		//A deeper BVH (a mesh file from elsewhere) doesn't overflow the stacks, the packet walks trace its rays on their own
+		//below this depth and InstanceBVH::Build stops splitting before it
+		constexpr int maxTraversalDepth{ 128 };
+		static_assert(InstanceBVH::maxDepth < maxTraversalDepth, "the instance traversal stack holds at most one entry per level + 1");
+
+		inline uint64_t GetLaneMask(const bool* isSet)
+		{
+			uint64_t mask{};
+			for (int lane{}; lane < RayPacket::size; ++lane)
+				mask |= uint64_t(isSet[lane]) << lane;
+			return mask;
+		}
+
+		//The FloatN::width bits of lane and up
+		template<typename FloatN>
+		inline int GetLaneBits(uint64_t mask, int lane)
+		{
+			return int((mask >> lane) & ((uint64_t(1) << FloatN::width) - 1));
+		}
+
+		//Node still to be visited and the lanes that entered its parent
+		struct PacketTraversalEntry
+		{
+			unsigned int nodeIdx;
+			uint64_t activeLanes;
+		};
+
+		//Closest hit of every lane while a packet walks through a mesh, the hit records get filled in at the end
+		struct PacketHits
+		{
+			float closestT[RayPacket::size];
+			//Triangle whose hit still has to be written to the record, -1 if the record is up to date
+			int closestTriangle[RayPacket::size];
+		};
+
+		//False when the box lies completely outside one of the planes of the packet's frustum
+		inline bool FrustumTest_BVH(const RayPacket& packet, const Vector3& bmin, const Vector3& bmax)
+		{
+			for (const Vector3& normal : packet.frustumNormals)
+			{
+				//Corner of the box that lies furthest along the normal
+				const Vector3 corner{ normal.x >= 0.f ? bmax.x : bmin.x, normal.y >= 0.f ? bmax.y : bmin.y, normal.z >= 0.f ? bmax.z : bmin.z };
+				if (Vector3::Dot(normal, corner - packet.origin) < 0.f)
+					return false;
+			}
+			return true;
+		}
+
+		//Slab test of all lanes at once, returns the active lanes that enter the box before their closest hit
+		//Min(b, a) and Max(b, a) are std::min(a, b) and std::max(a, b), NaNs included, so the lanes agree with the single ray test
+		template<typename FloatN = Float4>
+		inline uint64_t SlabTest_BVH(const RayPacket& packet, const PacketHits& hits, uint64_t activeLanes, const Vector3& bmin, const Vector3& bmax)
+		{
+			RAY_STATS_INC(slabTests);
+
+			const FloatN minX{ bmin.x - packet.origin.x }, maxX{ bmax.x - packet.origin.x };
+			const FloatN minY{ bmin.y - packet.origin.y }, maxY{ bmax.y - packet.origin.y };
+			const FloatN minZ{ bmin.z - packet.origin.z }, maxZ{ bmax.z - packet.origin.z };
+			const FloatN zero{ 0.f };
+
+			uint64_t hitLanes{};
+			for (int lane{}; lane < RayPacket::size; lane += FloatN::width)
+			{
+				const int laneBits{ GetLaneBits<FloatN>(activeLanes, lane) };
+				if (laneBits == 0) continue;
+
+				const FloatN inverseDirectionX{ FloatN::Load(packet.inverseDirectionX + lane) };
+				const FloatN tx1{ minX * inverseDirectionX }, tx2{ maxX * inverseDirectionX };
+				FloatN tmin{ Min(tx2, tx1) }, tmax{ Max(tx2, tx1) };
+				const FloatN inverseDirectionY{ FloatN::Load(packet.inverseDirectionY + lane) };
+				const FloatN ty1{ minY * inverseDirectionY }, ty2{ maxY * inverseDirectionY };
+				tmin = Max(Min(ty2, ty1), tmin), tmax = Min(Max(ty2, ty1), tmax);
+				const FloatN inverseDirectionZ{ FloatN::Load(packet.inverseDirectionZ + lane) };
+				const FloatN tz1{ minZ * inverseDirectionZ }, tz2{ maxZ * inverseDirectionZ };
+				tmin = Max(Min(tz2, tz1), tmin), tmax = Min(Max(tz2, tz1), tmax);
+
+				const int hitBits{ MoveMask((tmax >= tmin) & (tmax > zero) & (tmin <= FloatN::Load(hits.closestT + lane))) };
+				hitLanes |= uint64_t(hitBits & laneBits) << lane;
+			}
+			return hitLanes;
+		}
+
+		//Same test as the single ray version, the origin is shared so everything that only depends on it is done once
+		template<typename FloatN = Float4>
+		inline void HitTest_Triangle(const Triangle& triangle, int triangleIdx, const RayPacket& packet, uint64_t activeLanes, PacketHits& hits)
+		{
+			RAY_STATS_INC(triangleTests);
+
+			const Vector3 edge1 = triangle.v1 - triangle.v0;
+			const Vector3 edge2 = triangle.v2 - triangle.v0;
+			const Vector3 tVec = packet.origin - triangle.v0;
+			const Vector3 qVec = Vector3::Cross(tVec, edge1);
+
+			const FloatN edge1X{ edge1.x }, edge1Y{ edge1.y }, edge1Z{ edge1.z };
+			const FloatN edge2X{ edge2.x }, edge2Y{ edge2.y }, edge2Z{ edge2.z };
+			const FloatN tVecX{ tVec.x }, tVecY{ tVec.y }, tVecZ{ tVec.z };
+			const FloatN qVecX{ qVec.x }, qVecY{ qVec.y }, qVecZ{ qVec.z };
+			const FloatN edge2DotQ{ Vector3::Dot(edge2, qVec) };
+
+			const FloatN zero{ 0.f };
+			const FloatN one{ 1.f };
+			const FloatN epsilon{ FLT_EPSILON };
+			const FloatN negativeEpsilon{ -FLT_EPSILON };
+			const FloatN rayMin{ packet.min };
+			const FloatN rayMax{ packet.max };
+
+			const bool cullsFrontFaces{ triangle.cullMode == TriangleCullMode::FrontFaceCulling };
+			const bool cullsBackFaces{ triangle.cullMode == TriangleCullMode::BackFaceCulling };
+
+			for (int lane{}; lane < RayPacket::size; lane += FloatN::width)
+			{
+				const int laneBits{ GetLaneBits<FloatN>(activeLanes, lane) };
+				if (laneBits == 0) continue;
+
+				const FloatN dx{ FloatN::Load(packet.directionX + lane) };
+				const FloatN dy{ FloatN::Load(packet.directionY + lane) };
+				const FloatN dz{ FloatN::Load(packet.directionZ + lane) };
+
+				const FloatN px{ dy * edge2Z - dz * edge2Y };
+				const FloatN py{ dz * edge2X - dx * edge2Z };
+				const FloatN pz{ dx * edge2Y - dy * edge2X };
+
+				const FloatN det{ (edge1X * px) + (edge1Y * py) + (edge1Z * pz) };
+				const FloatN invDet{ one / det };
+				const FloatN u{ invDet * ((tVecX * px) + (tVecY * py) + (tVecZ * pz)) };
+				const FloatN v{ invDet * ((dx * qVecX) + (dy * qVecY) + (dz * qVecZ)) };
+				const FloatN t{ invDet * edge2DotQ };
+
+				//A NaN determinant already fails here instead of at the u test (its u is NaN too), same result
+				MaskOf<FloatN> isHit{ (det <= negativeEpsilon) | (det >= epsilon) };
+				if (cullsFrontFaces) isHit = isHit & (det <= zero);
+				if (cullsBackFaces) isHit = isHit & (det >= zero);
+				isHit = isHit & (u >= zero) & (u <= one) & (v >= zero) & (u + v <= one)
+					& (t >= rayMin) & (t <= rayMax) & (t < FloatN::Load(hits.closestT + lane));
+
+				int hitBits{ MoveMask(isHit) & laneBits };
+				if (hitBits == 0) continue;
+
+				float tValues[FloatN::width];
+				t.Store(tValues);
+				for (; hitBits != 0; hitBits &= hitBits - 1)
+				{
+					const int i{ std::countr_zero(unsigned(hitBits)) };
+					hits.closestT[lane + i] = tValues[i];
+					hits.closestTriangle[lane + i] = triangleIdx;
+				}
+			}
+		}
+
+		//Closest hit per lane, only overwrites the records of lanes that find a closer hit in this mesh
+		//Walks the BVH with a stack instead of recursing so a dispatched variant compiles into a single function
+		template<typename FloatN = Float4>
+		inline void HitTest_TriangleMesh(TriangleMesh& mesh, const RayPacket& packet, HitRecord* pHitRecords)
+		{
+			PacketHits hits;
+			for (int lane{}; lane < RayPacket::size; ++lane)
+			{
+				hits.closestT[lane] = pHitRecords[lane].t;
+				hits.closestTriangle[lane] = -1;
+			}
+
+			const BVHNode* pNodes{ mesh.GetBVHNodes() };
+			const int* pTriIdx{ mesh.GetTriIdx() };
+			//Scratch for the triangles of a quantized mesh
+			Triangle decoded{};
+
+			//The right child goes below the left one, so the nodes are visited in the same order as a recursive walk
+			PacketTraversalEntry stack[maxTraversalDepth];
+			int stackSize{};
+			stack[stackSize++] = { mesh.rootNodeIdx, GetLaneMask(packet.isActive) };
+			while (stackSize > 0)
+			{
+				const PacketTraversalEntry entry{ stack[--stackSize] };
+				RAY_STATS_INC(nodesVisited);
+
+				const BVHNode& node = pNodes[entry.nodeIdx];
+				if (!FrustumTest_BVH(packet, node.aabbMin, node.aabbMax)) continue;
+
+				const uint64_t hitsNode{ SlabTest_BVH<FloatN>(packet, hits, entry.activeLanes, node.aabbMin, node.aabbMax) };
+				if (hitsNode == 0) continue;
+
+				//The packet has diverged, the few rays left are cheaper to trace on their own
+				//Same when the stack is full, the single ray walk recurses instead
+				if (std::popcount(hitsNode) < RayPacket::minCoherentRays || (!node.IsLeaf() && stackSize + 2 > maxTraversalDepth))
+				{
+					HitRecord temp{};
+					for (uint64_t lanes{ hitsNode }; lanes != 0; lanes &= lanes - 1)
+					{
+						const int lane{ std::countr_zero(lanes) };
+
+						HitRecord laneHit{};
+						laneHit.t = hits.closestT[lane];
+						HitTest_BVH(mesh, packet.GetRay(lane), entry.nodeIdx, temp, laneHit);
+						if (laneHit.t < hits.closestT[lane])
+						{
+							pHitRecords[lane] = laneHit;
+							hits.closestT[lane] = laneHit.t;
+							hits.closestTriangle[lane] = -1;
+						}
+					}
+					continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					for (int i{}; i < (int)node.triCount; ++i)
+					{
+						const int triangleIdx{ pTriIdx[node.firstTriIdx + i] };
+						HitTest_Triangle<FloatN>(mesh.GetTriangle(triangleIdx, decoded), triangleIdx, packet, hitsNode, hits);
+					}
+				}
+				else
+				{
+					stack[stackSize++] = { node.leftNode + 1, hitsNode };
+					stack[stackSize++] = { node.leftNode, hitsNode };
+				}
+			}
+
+			for (int lane{}; lane < RayPacket::size; ++lane)
+			{
+				if (hits.closestTriangle[lane] < 0) continue;
+
+				const Triangle& triangle = mesh.GetTriangle(hits.closestTriangle[lane], decoded);
+				const float t{ hits.closestT[lane] };
+
+				HitRecord& hitRecord = pHitRecords[lane];
+				hitRecord.normal = triangle.cullMode != TriangleCullMode::BackFaceCulling ? -triangle.normal : triangle.normal;
+				hitRecord.didHit = true;
+				hitRecord.materialIndex = triangle.materialIndex;
+				hitRecord.origin = packet.origin + (packet.GetDirection(lane) * t);
+				hitRecord.t = t;
+			}
+		}
+
+		//Closest root in front of the ray origin of a*t^2 + b*t + c, the returned mask is set for lanes that have one
+		template<typename FloatN>
+		inline MaskOf<FloatN> GetSphereT(const FloatN& a, const FloatN& b, const FloatN& c, FloatN& t)
+		{
+			const FloatN zero{ 0.f };
+			const FloatN discriminant{ (b * b) - (FloatN{ 4.0f } * a * c) };
+
+			//Numerically stable roots, a single root when the ray grazes the sphere
+			const FloatN root{ Sqrt(Max(discriminant, zero)) };
+			const FloatN q{ Select(b > zero, FloatN{ -0.5f } * (b + root), FloatN{ -0.5f } * (b - root)) };
+#if defined(FAST_MATH)
+			const FloatN t0{ q * Reciprocal(a) };
+			const FloatN t1{ Select(discriminant == zero, t0, c * Reciprocal(q)) };
+#else
+			const FloatN t0{ q / a };
+			const FloatN t1{ Select(discriminant == zero, t0, c / q) };
+#endif
+
+			const FloatN tNear{ Min(t1, t0) };
+			const FloatN tFar{ Max(t1, t0) };
+			t = Select(tNear < zero, tFar, tNear);
+
+			return (discriminant >= zero) & (t >= zero);
+		}
+
+		//Same math as the single ray test
+		//A lane only takes the hit when it is closer than its closestT (keep inactive lanes at -FLT_MAX)
+		template<typename FloatN = Float4>
+		inline void HitTest_Sphere(const Sphere& sphere, const RayPacket& packet, float* closestT, HitRecord* pHitRecords)
+		{
+			//Everything that only depends on the shared origin
+			const Vector3 sphereToRay = packet.origin - sphere.origin;
+			const FloatN sphereToRayX{ sphereToRay.x };
+			const FloatN sphereToRayY{ sphereToRay.y };
+			const FloatN sphereToRayZ{ sphereToRay.z };
+			const FloatN c{ Vector3::Dot(sphereToRay, sphereToRay) - Square(sphere.radius) };
+
+			const FloatN rayMin{ packet.min };
+			const FloatN rayMax{ packet.max };
+
+			for (int lane{}; lane < RayPacket::size; lane += FloatN::width)
+			{
+				const FloatN dx{ FloatN::Load(packet.directionX + lane) };
+				const FloatN dy{ FloatN::Load(packet.directionY + lane) };
+				const FloatN dz{ FloatN::Load(packet.directionZ + lane) };
+
+				const FloatN a{ (dx * dx) + (dy * dy) + (dz * dz) };
+				const FloatN b{ FloatN{ 2.0f } * ((dx * sphereToRayX) + (dy * sphereToRayY) + (dz * sphereToRayZ)) };
+
+				FloatN t;
+				const MaskOf<FloatN> hasRoot{ GetSphereT(a, b, c, t) };
+				const MaskOf<FloatN> isHit{ hasRoot & (t >= rayMin) & (t <= rayMax) & (t < FloatN::Load(closestT + lane)) };
+				int hitMask{ MoveMask(isHit) };
+				if (hitMask == 0) continue;
+
+				float tValues[FloatN::width];
+				t.Store(tValues);
+				for (int i{}; hitMask != 0; ++i, hitMask >>= 1)
+				{
+					if ((hitMask & 1) == 0) continue;
+
+					HitRecord& hitRecord = pHitRecords[lane + i];
+					hitRecord.origin = packet.origin + packet.GetDirection(lane + i) * tValues[i];
+					hitRecord.didHit = true;
+					hitRecord.t = tValues[i];
+					hitRecord.materialIndex = sphere.materialIndex;
+					hitRecord.normal = Vector3{ (hitRecord.origin - sphere.origin).Normalized() };
+					closestT[lane + i] = tValues[i];
+				}
+			}
+		}
+
+		//See HitTest_Sphere
+		template<typename FloatN = Float4>
+		inline void HitTest_Plane(const Plane& plane, const RayPacket& packet, float* closestT, HitRecord* pHitRecords)
+		{
+			const FloatN nominator{ Vector3::Dot((plane.origin - packet.origin),plane.normal) };
+			const FloatN normalX{ plane.normal.x };
+			const FloatN normalY{ plane.normal.y };
+			const FloatN normalZ{ plane.normal.z };
+
+			const FloatN epsilon{ FLT_EPSILON };
+			const FloatN rayMin{ packet.min };
+			const FloatN rayMax{ packet.max };
+
+			for (int lane{}; lane < RayPacket::size; lane += FloatN::width)
+			{
+				const FloatN denominator{ (FloatN::Load(packet.directionX + lane) * normalX)
+					+ (FloatN::Load(packet.directionY + lane) * normalY)
+					+ (FloatN::Load(packet.directionZ + lane) * normalZ) };
+				const FloatN t{ nominator / denominator };
+
+				const MaskOf<FloatN> isHit{ (t >= rayMin) & (t <= rayMax) & (t > epsilon) & (t < FloatN::Load(closestT + lane)) };
+				int hitMask{ MoveMask(isHit) };
+				if (hitMask == 0) continue;
+
+				float tValues[FloatN::width];
+				t.Store(tValues);
+				for (int i{}; hitMask != 0; ++i, hitMask >>= 1)
+				{
+					if ((hitMask & 1) == 0) continue;
+
+					HitRecord& hitRecord = pHitRecords[lane + i];
+					hitRecord.normal = plane.normal;
+					hitRecord.didHit = true;
+					hitRecord.materialIndex = plane.materialIndex;
+					hitRecord.origin = packet.origin + (packet.GetDirection(lane + i) * tValues[i]);
+					hitRecord.t = tValues[i];
+					closestT[lane + i] = tValues[i];
+				}
+			}
+		}
+		//SHADOW PACKET HIT-TESTS (any hit, a lane that is occluded once stays occluded and isn't tested anymore)
+		//False when the box doesn't overlap the box around all ray segments of the packet
+		inline bool OverlapTest_BVH(const ShadowRayPacket& packet, const Vector3& bmin, const Vector3& bmax)
+		{
+			return bmin.x <= packet.boundsMax.x && bmax.x >= packet.boundsMin.x
+				&& bmin.y <= packet.boundsMax.y && bmax.y >= packet.boundsMin.y
+				&& bmin.z <= packet.boundsMax.z && bmax.z >= packet.boundsMin.z;
+		}
+
+		template<typename FloatN = Float4>
+		inline uint64_t SlabTest_BVH(const ShadowRayPacket& packet, uint64_t activeLanes, const Vector3& bmin, const Vector3& bmax)
+		{
+			RAY_STATS_INC(slabTests);
+
+			const FloatN minX{ bmin.x }, maxX{ bmax.x };
+			const FloatN minY{ bmin.y }, maxY{ bmax.y };
+			const FloatN minZ{ bmin.z }, maxZ{ bmax.z };
+			const FloatN zero{ 0.f };
+
+			uint64_t hitLanes{};
+			for (int lane{}; lane < ShadowRayPacket::size; lane += FloatN::width)
+			{
+				const int laneBits{ GetLaneBits<FloatN>(activeLanes, lane) };
+				if (laneBits == 0) continue;
+
+				const FloatN originX{ FloatN::Load(packet.originX + lane) }, inverseDirectionX{ FloatN::Load(packet.inverseDirectionX + lane) };
+				const FloatN tx1{ (minX - originX) * inverseDirectionX }, tx2{ (maxX - originX) * inverseDirectionX };
+				FloatN tmin{ Min(tx2, tx1) }, tmax{ Max(tx2, tx1) };
+				const FloatN originY{ FloatN::Load(packet.originY + lane) }, inverseDirectionY{ FloatN::Load(packet.inverseDirectionY + lane) };
+				const FloatN ty1{ (minY - originY) * inverseDirectionY }, ty2{ (maxY - originY) * inverseDirectionY };
+				tmin = Max(Min(ty2, ty1), tmin), tmax = Min(Max(ty2, ty1), tmax);
+				const FloatN originZ{ FloatN::Load(packet.originZ + lane) }, inverseDirectionZ{ FloatN::Load(packet.inverseDirectionZ + lane) };
+				const FloatN tz1{ (minZ - originZ) * inverseDirectionZ }, tz2{ (maxZ - originZ) * inverseDirectionZ };
+				tmin = Max(Min(tz2, tz1), tmin), tmax = Min(Max(tz2, tz1), tmax);
+
+				const int hitBits{ MoveMask((tmax >= tmin) & (tmax > zero) & (tmin <= FloatN::Load(packet.max + lane))) };
+				hitLanes |= uint64_t(hitBits & laneBits) << lane;
+			}
+			return hitLanes;
+		}
+
+		//Returns the active lanes the triangle occludes
+		template<typename FloatN = Float4>
+		inline uint64_t HitTest_Triangle(const Triangle& triangle, const ShadowRayPacket& packet, uint64_t activeLanes)
+		{
+			RAY_STATS_INC(triangleTests);
+
+			const Vector3 edge1 = triangle.v1 - triangle.v0;
+			const Vector3 edge2 = triangle.v2 - triangle.v0;
+
+			const FloatN edge1X{ edge1.x }, edge1Y{ edge1.y }, edge1Z{ edge1.z };
+			const FloatN edge2X{ edge2.x }, edge2Y{ edge2.y }, edge2Z{ edge2.z };
+			const FloatN v0X{ triangle.v0.x }, v0Y{ triangle.v0.y }, v0Z{ triangle.v0.z };
+
+			const FloatN zero{ 0.f };
+			const FloatN one{ 1.f };
+			const FloatN epsilon{ FLT_EPSILON };
+			const FloatN negativeEpsilon{ -FLT_EPSILON };
+			const FloatN rayMin{ packet.min };
+
+			const bool cullsFrontFaces{ triangle.cullMode == TriangleCullMode::FrontFaceCulling };
+			const bool cullsBackFaces{ triangle.cullMode == TriangleCullMode::BackFaceCulling };
+
+			uint64_t hitLanes{};
+			for (int lane{}; lane < ShadowRayPacket::size; lane += FloatN::width)
+			{
+				const int laneBits{ GetLaneBits<FloatN>(activeLanes, lane) };
+				if (laneBits == 0) continue;
+
+				const FloatN dx{ FloatN::Load(packet.directionX + lane) };
+				const FloatN dy{ FloatN::Load(packet.directionY + lane) };
+				const FloatN dz{ FloatN::Load(packet.directionZ + lane) };
+
+				const FloatN px{ dy * edge2Z - dz * edge2Y };
+				const FloatN py{ dz * edge2X - dx * edge2Z };
+				const FloatN pz{ dx * edge2Y - dy * edge2X };
+				const FloatN det{ (edge1X * px) + (edge1Y * py) + (edge1Z * pz) };
+				const FloatN invDet{ one / det };
+
+				const FloatN tx{ FloatN::Load(packet.originX + lane) - v0X };
+				const FloatN ty{ FloatN::Load(packet.originY + lane) - v0Y };
+				const FloatN tz{ FloatN::Load(packet.originZ + lane) - v0Z };
+				const FloatN u{ invDet * ((tx * px) + (ty * py) + (tz * pz)) };
+
+				const FloatN qx{ ty * edge1Z - tz * edge1Y };
+				const FloatN qy{ tz * edge1X - tx * edge1Z };
+				const FloatN qz{ tx * edge1Y - ty * edge1X };
+				const FloatN v{ invDet * ((dx * qx) + (dy * qy) + (dz * qz)) };
+				const FloatN t{ invDet * ((edge2X * qx) + (edge2Y * qy) + (edge2Z * qz)) };
+
+				MaskOf<FloatN> isHit{ (det <= negativeEpsilon) | (det >= epsilon) };
+				if (cullsFrontFaces) isHit = isHit & (det <= zero);
+				if (cullsBackFaces) isHit = isHit & (det >= zero);
+				isHit = isHit & (u >= zero) & (u <= one) & (v >= zero) & (u + v <= one)
+					& (t >= rayMin) & (t <= FloatN::Load(packet.max + lane));
+
+				hitLanes |= uint64_t(MoveMask(isHit) & laneBits) << lane;
+			}
+			return hitLanes;
+		}
+
+		//Sets isOccluded for the lanes the mesh blocks, walks the BVH with a stack like the closest hit version
+		template<typename FloatN = Float4>
+		inline void HitTest_TriangleMesh(TriangleMesh& mesh, const ShadowRayPacket& packet, bool* isOccluded)
+		{
+			uint64_t occludedLanes{ GetLaneMask(isOccluded) };
+
+			const BVHNode* pNodes{ mesh.GetBVHNodes() };
+			const int* pTriIdx{ mesh.GetTriIdx() };
+			//Scratch for the triangles of a quantized mesh
+			Triangle decoded{};
+			PacketTraversalEntry stack[maxTraversalDepth];
+			int stackSize{};
+			stack[stackSize++] = { mesh.rootNodeIdx, GetLaneMask(packet.isActive) };
+			while (stackSize > 0)
+			{
+				const PacketTraversalEntry entry{ stack[--stackSize] };
+				RAY_STATS_INC(nodesVisited);
+
+				const BVHNode& node = pNodes[entry.nodeIdx];
+				if (!OverlapTest_BVH(packet, node.aabbMin, node.aabbMax)) continue;
+
+				const uint64_t hitsNode{ SlabTest_BVH<FloatN>(packet, entry.activeLanes & ~occludedLanes, node.aabbMin, node.aabbMax) };
+				if (hitsNode == 0) continue;
+
+				//The packet has diverged, the few rays left are cheaper to trace on their own
+				//Same when the stack is full, the single ray walk recurses instead
+				if (std::popcount(hitsNode) < RayPacket::minCoherentRays || (!node.IsLeaf() && stackSize + 2 > maxTraversalDepth))
+				{
+					HitRecord temp{};
+					for (uint64_t lanes{ hitsNode }; lanes != 0; lanes &= lanes - 1)
+					{
+						const int lane{ std::countr_zero(lanes) };
+
+						HitRecord laneHit{};
+						if (HitTest_BVH(mesh, packet.GetRay(lane), entry.nodeIdx, temp, laneHit, true))
+							occludedLanes |= uint64_t(1) << lane;
+					}
+					continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					uint64_t testedLanes{ hitsNode };
+					for (int i{}; i < (int)node.triCount; ++i)
+					{
+						occludedLanes |= HitTest_Triangle<FloatN>(mesh.GetTriangle(pTriIdx[node.firstTriIdx + i], decoded), packet, testedLanes);
+						testedLanes &= ~occludedLanes;
+					}
+				}
+				else
+				{
+					stack[stackSize++] = { node.leftNode + 1, hitsNode };
+					stack[stackSize++] = { node.leftNode, hitsNode };
+				}
+			}
+
+			for (int lane{}; lane < ShadowRayPacket::size; ++lane)
+				isOccluded[lane] = (occludedLanes >> lane) & 1;
+		}
+
+		template<typename FloatN = Float4>
+		inline void HitTest_Sphere(const Sphere& sphere, const ShadowRayPacket& packet, bool* isOccluded)
+		{
+			const FloatN sphereX{ sphere.origin.x };
+			const FloatN sphereY{ sphere.origin.y };
+			const FloatN sphereZ{ sphere.origin.z };
+			const FloatN radiusSquared{ Square(sphere.radius) };
+			const FloatN rayMin{ packet.min };
+
+			for (int lane{}; lane < ShadowRayPacket::size; lane += FloatN::width)
+			{
+				const FloatN dx{ FloatN::Load(packet.directionX + lane) };
+				const FloatN dy{ FloatN::Load(packet.directionY + lane) };
+				const FloatN dz{ FloatN::Load(packet.directionZ + lane) };
+				const FloatN sphereToRayX{ FloatN::Load(packet.originX + lane) - sphereX };
+				const FloatN sphereToRayY{ FloatN::Load(packet.originY + lane) - sphereY };
+				const FloatN sphereToRayZ{ FloatN::Load(packet.originZ + lane) - sphereZ };
+
+				const FloatN a{ (dx * dx) + (dy * dy) + (dz * dz) };
+				const FloatN b{ FloatN{ 2.0f } * ((dx * sphereToRayX) + (dy * sphereToRayY) + (dz * sphereToRayZ)) };
+				const FloatN c{ ((sphereToRayX * sphereToRayX) + (sphereToRayY * sphereToRayY) + (sphereToRayZ * sphereToRayZ)) - radiusSquared };
+
+				FloatN t;
+				const MaskOf<FloatN> hasRoot{ GetSphereT(a, b, c, t) };
+				int hitMask{ MoveMask(hasRoot & (t >= rayMin) & (t <= FloatN::Load(packet.max + lane))) };
+				for (int i{}; hitMask != 0; ++i, hitMask >>= 1)
+				{
+					if ((hitMask & 1) != 0 && packet.isActive[lane + i])
+						isOccluded[lane + i] = true;
+				}
+			}
+		}
+
+		template<typename FloatN = Float4>
+		inline void HitTest_Plane(const Plane& plane, const ShadowRayPacket& packet, bool* isOccluded)
+		{
+			const FloatN planeX{ plane.origin.x };
+			const FloatN planeY{ plane.origin.y };
+			const FloatN planeZ{ plane.origin.z };
+			const FloatN normalX{ plane.normal.x };
+			const FloatN normalY{ plane.normal.y };
+			const FloatN normalZ{ plane.normal.z };
+
+			const FloatN epsilon{ FLT_EPSILON };
+			const FloatN rayMin{ packet.min };
+
+			for (int lane{}; lane < ShadowRayPacket::size; lane += FloatN::width)
+			{
+				const FloatN nominator{ ((planeX - FloatN::Load(packet.originX + lane)) * normalX)
+					+ ((planeY - FloatN::Load(packet.originY + lane)) * normalY)
+					+ ((planeZ - FloatN::Load(packet.originZ + lane)) * normalZ) };
+				const FloatN denominator{ (FloatN::Load(packet.directionX + lane) * normalX)
+					+ (FloatN::Load(packet.directionY + lane) * normalY)
+					+ (FloatN::Load(packet.directionZ + lane) * normalZ) };
+				const FloatN t{ nominator / denominator };
+
+				int hitMask{ MoveMask((t >= rayMin) & (t <= FloatN::Load(packet.max + lane)) & (t > epsilon)) };
+				for (int i{}; hitMask != 0; ++i, hitMask >>= 1)
+				{
+					if ((hitMask & 1) != 0 && packet.isActive[lane + i])
+						isOccluded[lane + i] = true;
+				}
+			}
+		}
+#pragma endregion
+#pragma region Instances HitTest
+		//Where the ray enters the box, FLT_MAX when it misses it or only gets there after maxT
+		inline float SlabDistance_BVH(const Ray& ray, const Vector3& bmin, const Vector3& bmax, float maxT)
+		{
+			RAY_STATS_INC(slabTests);
+			float tx1 = (bmin.x - ray.origin.x) / ray.direction.x, tx2 = (bmax.x - ray.origin.x) / ray.direction.x;
+			float tmin = std::min(tx1, tx2), tmax = std::max(tx1, tx2);
+			float ty1 = (bmin.y - ray.origin.y) / ray.direction.y, ty2 = (bmax.y - ray.origin.y) / ray.direction.y;
+			tmin = std::max(tmin, std::min(ty1, ty2)), tmax = std::min(tmax, std::max(ty1, ty2));
+			float tz1 = (bmin.z - ray.origin.z) / ray.direction.z, tz2 = (bmax.z - ray.origin.z) / ray.direction.z;
+			tmin = std::max(tmin, std::min(tz1, tz2)), tmax = std::min(tmax, std::max(tz1, tz2));
+			return tmax >= tmin && tmax > 0 && tmin <= maxT ? tmin : FLT_MAX;
+		}
+
+		//Closest hit over every instance of the top level BVH, only taken when closer than hitRecord.t and ray.max (like HitTest_BVH)
+		//The nearer child is visited first and nodes starting beyond the closest hit so far are skipped, every instance that
+		//gets reached traces the ray in the object space of its mesh through the mesh's own BVH
+		//ignoreHitRecord: any hit will do, returns on the first one (shadow rays)
+		inline bool HitTest_Instances(InstanceBVH& instanceBVH, std::span<TriangleMesh> meshes, const Ray& ray, HitRecord& hitRecord,
+			bool ignoreHitRecord = false, TraversalCost* pCost = nullptr)
+		{
+			if (instanceBVH.nodesUsed == 0)
+				return false;
+			const BVHNode& root = instanceBVH.bvhNodePool[instanceBVH.rootNodeIdx];
+			const float rootDistance{ SlabDistance_BVH(ray, root.aabbMin, root.aabbMax, std::min(hitRecord.t, ray.max)) };
+			if (rootDistance == FLT_MAX)
+				return false;
+
+			struct TraversalEntry
+			{
+				unsigned int nodeIdx;
+				float distance;
+			};
+			TraversalEntry stack[maxTraversalDepth];
+			int stackSize{};
+			stack[stackSize++] = { instanceBVH.rootNodeIdx, rootDistance };
+
+			bool didHit{};
+			HitRecord temp{};
+			while (stackSize > 0)
+			{
+				const TraversalEntry entry{ stack[--stackSize] };
+				const float maxT{ std::min(hitRecord.t, ray.max) };
+				if (entry.distance > maxT) continue;
+
+				RAY_STATS_INC(nodesVisited);
+				if (pCost)
+					++pCost->nodesVisited;
+
+				const BVHNode& node = instanceBVH.bvhNodePool[entry.nodeIdx];
+				if (node.IsLeaf())
+				{
+					for (unsigned int i{ node.firstTriIdx }; i < node.firstTriIdx + node.triCount; ++i)
+					{
+						const MeshInstance& instance{ instanceBVH.instances[i] };
+						TriangleMesh& mesh{ meshes[instance.meshIdx] };
+						const Ray objectRay{ instance.ToObjectSpace(ray) };
+
+						if (ignoreHitRecord)
+						{
+							HitRecord anyHit{};
+							if (HitTest_BVH(mesh, objectRay, mesh.rootNodeIdx, temp, anyHit, true, pCost))
+								return true;
+							continue;
+						}
+
+						const float closestT{ hitRecord.t };
+						HitTest_BVH(mesh, objectRay, mesh.rootNodeIdx, temp, hitRecord, false, pCost);
+						if (hitRecord.t < closestT)
+						{
+							//The mesh reported the hit in its object space
+							hitRecord.origin = ray.origin + (ray.direction * hitRecord.t);
+							hitRecord.normal = instance.NormalToWorld(hitRecord.normal);
+							if (instance.overridesMaterial)
+								hitRecord.materialIndex = instance.materialIndex;
+							didHit = true;
+						}
+					}
+					continue;
+				}
+
+				const float leftDistance{ SlabDistance_BVH(ray, instanceBVH.bvhNodePool[node.leftNode].aabbMin, instanceBVH.bvhNodePool[node.leftNode].aabbMax, maxT) };
+				const float rightDistance{ SlabDistance_BVH(ray, instanceBVH.bvhNodePool[node.leftNode + 1].aabbMin, instanceBVH.bvhNodePool[node.leftNode + 1].aabbMax, maxT) };
+
+				//The nearer child goes on top
+				assert(stackSize + 2 <= maxTraversalDepth);
+				const bool isLeftNearer{ leftDistance <= rightDistance };
+				const TraversalEntry nearEntry{ isLeftNearer ? node.leftNode : node.leftNode + 1, isLeftNearer ? leftDistance : rightDistance };
+				const TraversalEntry farEntry{ isLeftNearer ? node.leftNode + 1 : node.leftNode, isLeftNearer ? rightDistance : leftDistance };
+				if (farEntry.distance != FLT_MAX)
+					stack[stackSize++] = farEntry;
+				if (nearEntry.distance != FLT_MAX)
+					stack[stackSize++] = nearEntry;
+			}
+			return didHit;
+		}
+
+		inline bool HitTest_Instances(InstanceBVH& instanceBVH, std::span<TriangleMesh> meshes, const Ray& ray)
+		{
+			HitRecord temp{};
+			return HitTest_Instances(instanceBVH, meshes, ray, temp, true);
+		}
 #pragma endregion
 	}
 
@@ -351,6 +1059,15 @@ namespace dae
 
 		}
 
+		//Ray from just above the hit point towards the light, ending at the light
+		inline Ray GetShadowRay(const Light& light, const HitRecord& hitRecord)
+		{
+			const Vector3 origin{ hitRecord.origin + (hitRecord.normal * 0.0001f) };
+			const Vector3 lightDir{ GetDirectionToLight(light, origin) };
+
+			return Ray{ origin, lightDir.Normalized(), 0.0001f, lightDir.Magnitude() };
+		}
+
 		inline ColorRGB GetRadiance(const Light& light, const Vector3& target)
 		{
 			const Vector3 pointToShade{ light.origin - target };
@@ -370,72 +1087,31 @@ namespace dae
 
 	namespace Utils
 	{
-		//Just parses vertices and indices
+		//Positions and triangle indices of every face (polygons get fan triangulated, see OBJLoader), normals are computed per triangle
+		//The mesh goes through MeshCleanup first, so no degenerate triangle ends up with a NaN normal
+		//The vectors get replaced, false when the file can't be read or doesn't parse
 #pragma warning(push)
 #pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices,
+			const MeshCleanup::Options& cleanupOptions = {})
 		{
-			std::ifstream file(filename);
-			if (!file)
+			OBJData data{};
+			if (!OBJLoader::Load(filename, data))
 				return false;
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
-			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
-				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
-				}
-				else if (sCommand == "f")
-				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
-
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
-				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
-
-				if (file.eof())
-					break;
-			}
+			positions = std::move(data.positions);
+			indices.resize(data.vertices.size());
+			for (size_t index{}; index < data.vertices.size(); ++index)
+				indices[index] = data.vertices[index].position;
+			MeshCleanup::Clean(positions, indices, cleanupOptions);
 
 			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
+			normals.resize(indices.size() / 3);
+			for (size_t index{}; index < indices.size(); index += 3)
 			{
-				uint32_t i0 = indices[index];
-				uint32_t i1 = indices[index + 1];
-				uint32_t i2 = indices[index + 2];
-
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
-
-				if (isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normal.Normalize();
-				if (isnan(normal.x))
-				{
-					int k = 0;
-				}
-
-				normals.push_back(normal);
+				const Vector3 edgeV0V1{ positions[indices[index + 1]] - positions[indices[index]] };
+				const Vector3 edgeV0V2{ positions[indices[index + 2]] - positions[indices[index]] };
+				normals[index / 3] = Vector3::Cross(edgeV0V1, edgeV0V2).Normalized();
 			}
 
 			return true;
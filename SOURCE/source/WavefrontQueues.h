@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Work passed from one wavefront stage to the next, stored per component (SoA)
+	//Sized for the whole screen once and only grown when a scene has more lights, never allocated per frame
+	struct WavefrontQueues
+	{
+		//Generate > Extend: a primary ray per pixel, ordered in 8x8 blocks so every RayPacket::size rays form a packet
+		std::vector<float> directionX{};
+		std::vector<float> directionY{};
+		std::vector<float> directionZ{};
+		//Pixel of every ray, invalidPixel for lanes of partial blocks
+		std::vector<uint32_t> pixelIndices{};
+
+		//Extend > Shade: only the rays that hit something
+		std::vector<float> hitOriginX{};
+		std::vector<float> hitOriginY{};
+		std::vector<float> hitOriginZ{};
+		std::vector<float> hitNormalX{};
+		std::vector<float> hitNormalY{};
+		std::vector<float> hitNormalZ{};
+		std::vector<float> hitT{};
+		std::vector<unsigned char> hitMaterialIndices{};
+		std::vector<uint32_t> hitPixelIndices{};
+		std::atomic<uint32_t> numHits{};
+
+		//Shade > Connect > Accumulate: a slot per light per hit, all hits of light 0 first (coherent shadow packets)
+		std::vector<float> contributionR{};
+		std::vector<float> contributionG{};
+		std::vector<float> contributionB{};
+		//Set when the light contributes, Connect clears it again when the shadow ray is blocked
+		std::vector<uint8_t> isLit{};
+
+		//Sort (opt-in, between Extend and Shade): the key of every hit and room to reorder the hit queues into
+		std::vector<Ray> sortRays{};
+		std::vector<uint32_t> sortOrder{};
+		std::vector<float> sortedFloats{};
+		std::vector<uint32_t> sortedPixelIndices{};
+		std::vector<unsigned char> sortedMaterialIndices{};
+
+		static constexpr uint32_t invalidPixel{ UINT32_MAX };
+
+		void Resize(size_t numRays, size_t numPixels, size_t numLights)
+		{
+			for (auto* pQueue : { &directionX, &directionY, &directionZ })
+				pQueue->resize(numRays);
+			pixelIndices.resize(numRays);
+
+			for (auto* pQueue : { &hitOriginX, &hitOriginY, &hitOriginZ, &hitNormalX, &hitNormalY, &hitNormalZ, &hitT })
+				pQueue->resize(numPixels);
+			hitMaterialIndices.resize(numPixels);
+			hitPixelIndices.resize(numPixels);
+			sortedFloats.resize(numPixels);
+			sortedPixelIndices.resize(numPixels);
+			sortedMaterialIndices.resize(numPixels);
+
+			const size_t numSlots{ numPixels * numLights };
+			if (isLit.size() < numSlots)
+			{
+				for (auto* pQueue : { &contributionR, &contributionG, &contributionB })
+					pQueue->resize(numSlots);
+				isLit.resize(numSlots);
+			}
+		}
+
+		//Puts the first sortOrder.size() hits in sortOrder, every queue swaps with a sorted copy of the same size
+		void ReorderHits()
+		{
+			const auto reorder = [this](auto& queue, auto& sortedQueue)
+				{
+					for (size_t i{}; i < sortOrder.size(); ++i)
+						sortedQueue[i] = queue[sortOrder[i]];
+					queue.swap(sortedQueue);
+				};
+			for (auto* pQueue : { &hitOriginX, &hitOriginY, &hitOriginZ, &hitNormalX, &hitNormalY, &hitNormalZ, &hitT })
+				reorder(*pQueue, sortedFloats);
+			reorder(hitMaterialIndices, sortedMaterialIndices);
+			reorder(hitPixelIndices, sortedPixelIndices);
+		}
+
+		HitRecord GetHit(uint32_t hitIdx) const
+		{
+			HitRecord hitRecord{};
+			hitRecord.origin = { hitOriginX[hitIdx], hitOriginY[hitIdx], hitOriginZ[hitIdx] };
+			hitRecord.normal = { hitNormalX[hitIdx], hitNormalY[hitIdx], hitNormalZ[hitIdx] };
+			hitRecord.t = hitT[hitIdx];
+			hitRecord.didHit = true;
+			hitRecord.materialIndex = hitMaterialIndices[hitIdx];
+			return hitRecord;
+		}
+
+		void SetHit(uint32_t hitIdx, const HitRecord& hitRecord, uint32_t pixelIndex)
+		{
+			hitOriginX[hitIdx] = hitRecord.origin.x;
+			hitOriginY[hitIdx] = hitRecord.origin.y;
+			hitOriginZ[hitIdx] = hitRecord.origin.z;
+			hitNormalX[hitIdx] = hitRecord.normal.x;
+			hitNormalY[hitIdx] = hitRecord.normal.y;
+			hitNormalZ[hitIdx] = hitRecord.normal.z;
+			hitT[hitIdx] = hitRecord.t;
+			hitMaterialIndices[hitIdx] = hitRecord.materialIndex;
+			hitPixelIndices[hitIdx] = pixelIndex;
+		}
+	};
+}
@@ -5,12 +5,18 @@
 #undef main
 
 //Standard includes
+#include <fstream>
 #include <iostream>
+#include <string_view>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "RayStats.h"
+#include "Tracer.h"
+#include "Kernels.h"
+#include "RenderCheck.h"
 
 using namespace dae;
 
@@ -20,11 +26,48 @@ void ShutDown(SDL_Window* pWindow)
 	SDL_Quit();
 }
 
+//--isa=<name> runs the kernels of a lower instruction set than the CPU supports (sse2, sse4.2, avx2, avx-512), to compare them
+void SelectKernels(int argc, char* args[])
+{
+	constexpr std::string_view isaOption{ "--isa=" };
+	for (int argIdx{ 1 }; argIdx < argc; ++argIdx)
+	{
+		const std::string_view arg{ args[argIdx] };
+		if (!arg.starts_with(isaOption))
+			continue;
+
+		const std::string_view name{ arg.substr(isaOption.size()) };
+		InstructionSet instructionSet{};
+		if (!CPUFeatures::ParseInstructionSet(name, instructionSet))
+			std::cout << "Unknown instruction set '" << name << "', ignoring " << arg << '\n';
+		else if (!Kernels::SelectInstructionSet(instructionSet))
+			std::cout << "This CPU doesn't support " << CPUFeatures::GetName(instructionSet) << ", ignoring " << arg << '\n';
+	}
+
+	const InstructionSet supportedInstructionSet{ CPUFeatures::GetSupportedInstructionSet() };
+	std::cout << "Kernels: " << CPUFeatures::GetName(Kernels::Get().instructionSet);
+	if (Kernels::Get().instructionSet != supportedInstructionSet)
+		std::cout << " (CPU supports " << CPUFeatures::GetName(supportedInstructionSet) << ')';
+	std::cout << '\n';
+}
+
+//--render-check renders every scene without a window and compares exact against fast math (see RenderCheck.h)
+bool IsRenderCheck(int argc, char* args[])
+{
+	for (int argIdx{ 1 }; argIdx < argc; ++argIdx)
+	{
+		if (std::string_view{ args[argIdx] } == "--render-check")
+			return true;
+	}
+	return false;
+}
+
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	SelectKernels(argc, args);
+
+	if (IsRenderCheck(argc, args))
+		return RenderCheck::Run(std::cout) ? 0 : 1;
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -51,6 +94,7 @@ int main(int argc, char* args[])
 	//const auto pScene = new Scene_W3();
 	//const auto pScene = new Scene_W4_BunnyScene();
 	//const auto pScene = new Scene_W4_ReferenceScene();
+	//const auto pScene = new Scene_W4_InstancingScene();
 	const auto pScene = new Scene_W4_ExtraScene();
 	pScene->Initialize();
 
@@ -77,17 +121,35 @@ int main(int argc, char* args[])
 					pRenderer->ToggleShadows();
 				if(e.key.keysym.scancode == SDL_SCANCODE_F3)
 					pRenderer->CycleLightingMode();
+				if(e.key.keysym.scancode == SDL_SCANCODE_F4)
+					pRenderer->TogglePackets();
+				if(e.key.keysym.scancode == SDL_SCANCODE_F5)
+					pRenderer->ToggleWavefront();
 				if(e.key.keysym.scancode == SDL_SCANCODE_F6)
 					pTimer->StartBenchmark();
+				if(e.key.keysym.scancode == SDL_SCANCODE_F7)
+					pTimer->PrintZones(std::cout);
+				if(e.key.keysym.scancode == SDL_SCANCODE_F8)
+					Tracer::StartRecording();
+				if(e.key.keysym.scancode == SDL_SCANCODE_F9)
+					pRenderer->ToggleDeferredShading();
+				if(e.key.keysym.scancode == SDL_SCANCODE_F10)
+					pRenderer->ToggleRaySorting();
 				break;
 			}
 		}
 
 		//--------- Update ---------
-		pScene->Update(pTimer);
+		{
+			Timer::ScopedZone zone{ TimerZone::SceneUpdate };
+			pScene->Update(pTimer);
+		}
 
 		//--------- Render ---------
-		pRenderer->Render(pScene);
+		{
+			Tracer::ScopedEvent traceEvent{ "Render" };
+			pRenderer->Render(pScene);
+		}
 		//--------- Timer ---------
 		pTimer->Update();
 		printTimer += pTimer->GetElapsed();
@@ -95,20 +157,32 @@ int main(int argc, char* args[])
 		{
 			printTimer = 0.f;
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+#if defined(RAY_STATS)
+			RayStats::Print(std::cout, RayStats::GetFrameCounters());
+#endif
 		}
 
 		//Save screenshot after full render
 		if (takeScreenshot)
 		{
+			Timer::ScopedZone zone{ TimerZone::ScreenshotSave };
 			if (!pRenderer->SaveBufferToImage())
 				std::cout << "Screenshot saved!" << std::endl;
 			else
 				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
 			takeScreenshot = false;
 		}
+
+		Tracer::EndFrame();
 	}
 	pTimer->Stop();
 
+	//Dump the frame breakdown of the last frames
+	pTimer->PrintZones(std::cout);
+	std::ofstream fileStream("frame_zones.txt");
+	pTimer->PrintZones(fileStream);
+	fileStream.close();
+
 	//Shutdown "framework"
 	delete pScene;
 	delete pRenderer;